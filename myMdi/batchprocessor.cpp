@@ -0,0 +1,290 @@
+﻿#include <cstring>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include "batchprocessor.h"
+#include "textfile.h"
+#include "tracer.h"
+
+namespace
+{
+	//QtConcurrent::blockingMapped需要带result_type的函数对象
+	struct ProcessFile
+	{
+		typedef BatchProcessor::FileResult result_type;
+		explicit ProcessFile(const BatchProcessor::Task &task) : task(task) {}
+		BatchProcessor::FileResult operator()(const QString &fileName) const
+		{
+			return BatchProcessor::processFile(task, fileName);
+		}
+		BatchProcessor::Task task;
+	};
+}
+
+BatchProcessor::BatchProcessor(const QStringList &arguments) :
+	jobs(0)
+{
+	//第一个参数是程序本身，--in之后的全部是文件
+	for (int i = 1; i < arguments.size() && argumentError.isEmpty(); ++i)
+	{
+		const QString &argument = arguments.at(i);
+		if (argument == "--batch")
+		{
+			continue;
+		}
+		else if (argument == "--replace" && i + 2 < arguments.size())
+		{
+			task.replace = true;
+			task.pattern = arguments.at(++i);
+			task.replacement = arguments.at(++i);
+		}
+		else if (argument == "--regex")
+		{
+			task.options.useRegex = true;
+		}
+		else if (argument == "--ignore-case")
+		{
+			task.options.caseSensitive = false;
+		}
+		else if (argument == "--lines" && i + 1 < arguments.size())
+		{
+			static const struct { const char * name; LineOperations::Operation operation; } operations[] = {
+				{ "sort", LineOperations::SortAscending }, { "sort-desc", LineOperations::SortDescending },
+				{ "sort-numeric", LineOperations::SortNumeric }, { "unique", LineOperations::RemoveDuplicates },
+				{ "keep", LineOperations::KeepMatching }, { "remove", LineOperations::RemoveMatching },
+				{ "reverse", LineOperations::Reverse } };
+			QString name = arguments.at(++i);
+			task.transform = false;
+			for (const auto &entry : operations)
+			{
+				if (name == entry.name)
+				{
+					task.transform = true;
+					task.operation = entry.operation;
+				}
+			}
+			if (!task.transform)
+				argumentError = QString("unknown line operation: %1").arg(name);
+		}
+		else if (argument == "--pattern" && i + 1 < arguments.size())
+		{
+			task.linePattern = arguments.at(++i);
+		}
+		else if (argument == "--dry-run")
+		{
+			task.dryRun = true;
+		}
+		else if (argument == "--jobs" && i + 1 < arguments.size())
+		{
+			jobs = arguments.at(++i).toInt();
+		}
+		else if (argument == "--in")
+		{
+			files = arguments.mid(i + 1);
+			break;
+		}
+		else
+		{
+			argumentError = QString("unknown argument: %1").arg(argument);
+		}
+	}
+
+	if (argumentError.isEmpty())
+	{
+		if (!task.replace && !task.transform)
+			argumentError = "nothing to do: use --replace or --lines";
+		else if (files.isEmpty())
+			argumentError = "no input files: use --in <files...>";
+		else if (task.transform && (task.operation == LineOperations::KeepMatching
+			|| task.operation == LineOperations::RemoveMatching) && task.linePattern.isEmpty())
+			argumentError = "--lines keep and remove need --pattern";
+	}
+}
+
+bool BatchProcessor::requested(int argc, char *argv[])
+{
+	//在创建任何QApplication之前判断，批处理模式不需要连接显示器
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--batch") == 0)
+			return true;
+	}
+	return false;
+}
+
+void BatchProcessor::usage()
+{
+	QTextStream(stderr) << "usage: myMdi --batch [--replace <pattern> <replacement>] [--regex] [--ignore-case]\n"
+		"                    [--lines sort|sort-desc|sort-numeric|unique|reverse|keep|remove] [--pattern <pattern>]\n"
+		"                    [--dry-run] [--jobs N] --in <files...>\n";
+}
+
+QString BatchProcessor::replaceText(const Task &task, const QString &text, int *count, QString *error)
+{
+	SearchEngine::ReplaceResult result = SearchEngine::replaceAll(text, task.pattern, task.replacement, task.options);
+	if (!result.error.isEmpty())
+	{
+		*error = result.error;
+		return text;
+	}
+	*count += result.count;
+	if (result.count == 0)
+	{
+		return text;
+	}
+	//结果只包含第一处到最后一处匹配之间的区间
+	return text.left(result.start) + result.text + text.mid(result.end);
+}
+
+bool BatchProcessor::isLineLocal(const Task &task)
+{
+	if (task.pattern.contains(QLatin1Char('\n')))
+	{
+		return false;
+	}
+	if (!task.options.useRegex)
+	{
+		return true;
+	}
+	//保守判断：\s、\n、\A、\z等字母转义，取反的字符集和(?...)写法都可能跨行，
+	//^和$在多行模式下只匹配行首行尾，\d、\w、\b、\B不会匹配换行
+	const QString &pattern = task.pattern;
+	for (int i = 0; i < pattern.size(); ++i)
+	{
+		QChar c = pattern.at(i);
+		if (c == QLatin1Char('\\'))
+		{
+			if (++i >= pattern.size())
+				return false;
+			QChar e = pattern.at(i);
+			if (e.isLetterOrNumber() && e != QLatin1Char('d') && e != QLatin1Char('w')
+				&& e != QLatin1Char('b') && e != QLatin1Char('B'))
+				return false;
+		}
+		else if (c == QLatin1Char('[') && i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('^'))
+		{
+			return false;
+		}
+		else if (c == QLatin1Char('(') && i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('?'))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+BatchProcessor::FileResult BatchProcessor::processFile(const Task &task, const QString &fileName)
+{
+	TRACE_SCOPE_CATEGORY("BatchProcessor::processFile", "batch");
+	FileResult result;
+	result.fileName = fileName;
+
+	TextFile::Reader reader;
+	if (!reader.open(fileName, &result.error))
+	{
+		return result;
+	}
+	TextFile::Writer writer;
+	if (!task.dryRun && !writer.open(fileName, reader.format(), &result.error))
+	{
+		return result;
+	}
+
+	bool changed = false;
+	if (task.transform || !isLineLocal(task))
+	{
+		//行操作需要看到全部的行，可能跨行匹配的模式也要在整个文件上替换
+		QString original;
+		while (!reader.atEnd())
+		{
+			original += reader.read(ChunkSize);
+		}
+		QString text = original;
+		if (task.replace)
+		{
+			text = replaceText(task, text, &result.replacements, &result.error);
+		}
+		if (task.transform && result.error.isEmpty())
+		{
+			LineOperations::Result lines = LineOperations::apply(text, task.operation, task.linePattern, task.options);
+			result.error = lines.error;
+			result.linesBefore = lines.linesBefore;
+			result.linesAfter = lines.linesAfter;
+			text = lines.text;
+		}
+		changed = text != original;
+		if (!task.dryRun && result.error.isEmpty() && changed && !writer.write(text))
+			result.error = "write failed";
+	}
+	else
+	{
+		//只替换时逐块处理，每块以完整的行结束，内存占用与文件大小无关
+		while (!reader.atEnd() && result.error.isEmpty())
+		{
+			QString input = reader.read(ChunkSize);
+			QString chunk = replaceText(task, input, &result.replacements, &result.error);
+			changed = changed || chunk != input;
+			if (!task.dryRun && result.error.isEmpty() && !writer.write(chunk))
+				result.error = "write failed";
+		}
+	}
+
+	if (task.dryRun)
+	{
+		return result;
+	}
+	//出错或者内容没有变化时不改写文件，保留原来的修改时间
+	if (!result.error.isEmpty() || !changed)
+	{
+		writer.cancel();
+		return result;
+	}
+	result.written = writer.commit(&result.error);
+	return result;
+}
+
+int BatchProcessor::run()
+{
+	if (!argumentError.isEmpty())
+	{
+		QTextStream(stderr) << argumentError << '\n';
+		usage();
+		return 2;
+	}
+	if (jobs > 0)
+	{
+		QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	QList<FileResult> results = QtConcurrent::blockingMapped<QList<FileResult> >(files, ProcessFile(task));
+
+	//按命令行中的顺序输出每个文件的结果
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	int failed = 0;
+	int replacements = 0;
+	int written = 0;
+	for (const FileResult &result : results)
+	{
+		if (!result.error.isEmpty())
+		{
+			err << result.fileName << ": " << result.error << '\n';
+			++failed;
+			continue;
+		}
+		out << result.fileName << ':';
+		if (task.replace)
+			out << ' ' << result.replacements << " replacements";
+		if (task.transform)
+			out << ' ' << result.linesBefore << " -> " << result.linesAfter << " lines";
+		out << (result.written ? "" : task.dryRun ? " (dry run)" : " (unchanged)") << '\n';
+		replacements += result.replacements;
+		written += result.written;
+	}
+	out << results.size() << " files, " << written << " written, " << replacements << " replacements, "
+		<< failed << " failed, " << timer.elapsed() << " ms\n";
+	return failed > 0 ? 1 : 0;
+}
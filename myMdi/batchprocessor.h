@@ -0,0 +1,63 @@
+﻿#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+#include <QStringList>
+#include "searchengine.h"
+#include "lineoperations.h"
+
+//命令行批处理：用 --batch 启动时只创建QCoreApplication，不需要显示器。
+//与编辑器使用同样的编码识别、换行符保留、查找替换和行操作，各个文件在线程池中并行处理：
+//  myMdi --batch --replace <模式> <替换为> [--regex] [--ignore-case]
+//        [--lines sort|sort-desc|sort-numeric|unique|reverse|keep|remove [--pattern <模式>]]
+//        [--dry-run] [--jobs N] --in <文件...>
+//只做替换且模式不会跨行匹配时按块流式读写，不把整个文件放进内存；
+//行操作和可能跨行匹配的模式读入整个文件，结果与编辑器中的全部替换一致
+class BatchProcessor
+{
+public:
+	explicit BatchProcessor(const QStringList &arguments);
+
+	int run();                                  //处理全部文件，返回进程的退出码
+
+	static bool requested(int argc, char *argv[]);
+
+	//处理一个文件的设置
+	struct Task
+	{
+		Task() : replace(false), transform(false), operation(LineOperations::SortAscending), dryRun(false) {}
+		bool replace;
+		QString pattern;
+		QString replacement;
+		SearchEngine::Options options;
+		bool transform;
+		LineOperations::Operation operation;
+		QString linePattern;                    //keep和remove使用的模式
+		bool dryRun;                            //只统计，不写回文件
+	};
+
+	//一个文件的处理结果
+	struct FileResult
+	{
+		FileResult() : replacements(0), linesBefore(0), linesAfter(0), written(false) {}
+		QString fileName;
+		int replacements;
+		int linesBefore;
+		int linesAfter;
+		bool written;                           //文件是否被改写
+		QString error;
+	};
+
+	static FileResult processFile(const Task &task, const QString &fileName);
+
+private:
+	enum { ChunkSize = 4 * 1024 * 1024 };       //流式替换每块的字节数
+	static QString replaceText(const Task &task, const QString &text, int *count, QString *error);
+	static bool isLineLocal(const Task &task);  //模式是否只在一行之内匹配，可以按块处理
+	static void usage();
+
+	Task task;
+	QStringList files;
+	int jobs;                                   //并行的线程数，0表示使用全部核心
+	QString argumentError;                      //参数错误，为空表示参数有效
+};
+
+#endif // BATCHPROCESSOR_H
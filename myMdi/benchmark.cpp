@@ -0,0 +1,312 @@
+﻿#include <algorithm>
+#include <QApplication>
+#include <QClipboard>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QFile>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include "benchmark.h"
+#include "mdichild.h"
+
+namespace
+{
+	const char * const asciiWords[] = { "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+		"return", "value", "index", "buffer", "layout", "editor", "window", "document" };
+	//语料按UTF-8写出，非ASCII的单词用u8前缀，不依赖编译器的源文件和执行字符集
+	const char * const utf8Words[] = { u8"café", u8"naïve", u8"über", u8"façade", u8"señor", u8"smörgåsbord",
+		u8"déjà", u8"crème", u8"jalapeño", u8"coöperate", u8"Ærø", u8"Łódź" };
+	const char * const cjkWords[] = { u8"编辑器", u8"文档", u8"窗口", u8"布局", u8"搜索", u8"替换", u8"光标",
+		u8"撤销", u8"粘贴", u8"保存", u8"加载", u8"滚动" };
+
+	quint32 nextRandom(quint32 &state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+}
+
+Benchmark::Benchmark(const QStringList &arguments) :
+	minIterations(3),
+	minTotalTime(1000)
+{
+	//--benchmark-sizes 1K,1M,1G  --benchmark-output results.json
+	int index = arguments.indexOf("--benchmark-sizes");
+	QString sizeList = index >= 0 && index + 1 < arguments.size() ? arguments.at(index + 1) : QString("1K,1M,16M");
+	for (const QString &size : sizeList.split(',', QString::SkipEmptyParts))
+	{
+		qint64 bytes = parseSize(size);
+		if (bytes > 0)
+			sizes.append(bytes);
+	}
+	index = arguments.indexOf("--benchmark-output");
+	if (index >= 0 && index + 1 < arguments.size())
+	{
+		outputFile = arguments.at(index + 1);
+	}
+}
+
+qint64 Benchmark::parseSize(const QString &text)
+{
+	QString number = text.trimmed().toUpper();
+	qint64 unit = 1;
+	if (number.endsWith('K'))
+		unit = 1024;
+	else if (number.endsWith('M'))
+		unit = 1024 * 1024;
+	else if (number.endsWith('G'))
+		unit = 1024 * 1024 * 1024;
+	if (unit > 1)
+		number.chop(1);
+	return number.toLongLong() * unit;
+}
+
+bool Benchmark::generate(Corpus &corpus)
+{
+	corpus.fileName = QDir(dir.path()).filePath(corpus.name + ".txt");
+	return generate(corpus.fileName, corpus.bytes, corpus.longLines, corpus.charset);
+}
+
+bool Benchmark::generate(const QString &fileName, qint64 bytes, bool longLines, Charset charset)
+{
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly))
+	{
+		return false;
+	}
+
+	//按块写出，不在内存中保存整份语料
+	const char * const * words = charset == Ascii ? asciiWords : charset == Utf8 ? utf8Words : cjkWords;
+	int wordCount = charset == Ascii ? int(sizeof(asciiWords) / sizeof(*asciiWords))
+		: charset == Utf8 ? int(sizeof(utf8Words) / sizeof(*utf8Words)) : int(sizeof(cjkWords) / sizeof(*cjkWords));
+	int lineLength = longLines ? 64 * 1024 : 60;
+	quint32 state = 2463534242u;
+	qint64 written = 0;
+	int column = 0;
+	QByteArray chunk;
+	while (written < bytes)
+	{
+		const char * word = words[nextRandom(state) % wordCount];
+		chunk.append(word);
+		column += int(qstrlen(word));
+		if (column >= lineLength)
+		{
+			chunk.append('\n');
+			column = 0;
+		}
+		else
+		{
+			chunk.append(' ');
+			++column;
+		}
+		if (chunk.size() >= 1024 * 1024 || written + chunk.size() >= bytes)
+		{
+			written += chunk.size();
+			if (file.write(chunk) != chunk.size())
+				return false;
+			chunk.clear();
+		}
+	}
+	//搜索用的标记放在末尾
+	return file.write("\nNEEDLE\n") > 0;
+}
+
+void Benchmark::measure(const QString &name, const Corpus &corpus, qint64 bytes, int operations,
+	std::function<void()> setup, std::function<bool()> body, std::function<void()> teardown)
+{
+	QVector<qint64> times;
+	qint64 total = 0;
+	bool ok = true;
+	QElapsedTimer timer;
+	while (ok && (times.size() < minIterations || total < minTotalTime * 1000000LL) && times.size() < 100)
+	{
+		if (setup)
+			setup();
+		timer.start();
+		ok = body();
+		qint64 elapsed = timer.nsecsElapsed();
+		if (teardown)
+			teardown();
+		times.append(elapsed);
+		total += elapsed;
+		//一次就超过总时间的大语料不再重复
+		if (elapsed > minTotalTime * 1000000LL)
+			break;
+	}
+	std::sort(times.begin(), times.end());
+
+	QJsonObject result;
+	result["name"] = name;
+	result["corpus"] = corpus.name;
+	result["bytes"] = bytes;
+	result["iterations"] = times.size();
+	if (!ok)
+	{
+		result["error"] = QString("operation failed");
+	}
+	else
+	{
+		double median = times.at(times.size() / 2) / 1e6;
+		result["min_ms"] = times.first() / 1e6;
+		result["median_ms"] = median;
+		result["mean_ms"] = total / 1e6 / times.size();
+		if (operations > 1)
+			result["per_operation_ms"] = median / operations;
+		if (bytes > 0 && median > 0)
+			result["mb_per_s"] = bytes / (1024.0 * 1024.0) / (median / 1000.0);
+	}
+	results.append(result);
+	QTextStream(stderr) << name << ' ' << corpus.name << ": " << (ok ? result["median_ms"].toDouble() : -1) << " ms\n";
+}
+
+void Benchmark::benchmarkCorpus(const Corpus &corpus)
+{
+	qint64 bytes = QFileInfo(corpus.fileName).size();
+	MdiChild * child = nullptr;
+	auto open = [&]()
+	{
+		child = new MdiChild;
+		child->resize(1000, 600);
+		child->show();
+	};
+	auto close = [&]()
+	{
+		//直接删除，不经过关闭时的保存提示
+		child->document()->setModified(false);
+		delete child;
+		child = nullptr;
+	};
+
+	measure("load", corpus, bytes, 1, open, [&]() { return child->loadFile(corpus.fileName); }, close);
+
+	//以下测量共用一个已加载的窗口
+	open();
+	if (!child->loadFile(corpus.fileName))
+	{
+		close();
+		return;
+	}
+	QApplication::processEvents();
+	QString saved = QDir(dir.path()).filePath("saved.txt");
+	measure("save", corpus, bytes, 1, nullptr, [&]() { return child->saveFile(saved); }, nullptr);
+
+	//逐页滚动并立即重绘
+	const int Pages = 50;
+	QScrollBar * bar = child->verticalScrollBar();
+	measure("scroll", corpus, 0, Pages, [&]() { bar->setValue(0); }, [&]()
+	{
+		for (int i = 0; i < Pages; ++i)
+		{
+			bar->setValue(bar->value() + bar->pageStep());
+			child->viewport()->repaint();
+		}
+		return true;
+	}, nullptr);
+
+	//在文档中间连续输入，每个字符都重绘，之后撤销
+	const int Keys = 200;
+	auto middle = [&]()
+	{
+		QTextCursor cursor = child->textCursor();
+		cursor.setPosition(child->document()->characterCount() / 2);
+		child->setTextCursor(cursor);
+	};
+	measure("type", corpus, 0, Keys, middle, [&]()
+	{
+		for (int i = 0; i < Keys; ++i)
+		{
+			QChar c = QChar('a' + i % 26);
+			QKeyEvent press(QEvent::KeyPress, Qt::Key_A + i % 26, Qt::NoModifier, QString(c));
+			QApplication::sendEvent(child, &press);
+			child->viewport()->repaint();
+		}
+		return true;
+	}, [&]() { child->undo(); });
+
+	//粘贴1MB文本，以及撤销这次粘贴
+	QString clip;
+	clip.reserve(1024 * 1024);
+	while (clip.size() < 1024 * 1024)
+		clip += QString::fromUtf8(u8"pasted text 粘贴的文本\n");
+	QApplication::clipboard()->setText(clip);
+	measure("paste", corpus, clip.size() * 2, 1, middle, [&]()
+	{
+		child->paste();
+		return true;
+	}, [&]() { child->undo(); });
+	measure("undo", corpus, clip.size() * 2, 1, [&]() { middle(); child->paste(); }, [&]()
+	{
+		child->undo();
+		return true;
+	}, nullptr);
+
+	//从头查找末尾的标记，以及统计常见单词
+	SearchEngine::Options options;
+	measure("search", corpus, bytes, 1, [&]() { child->moveCursor(QTextCursor::Start); }, [&]()
+	{
+		return child->findNext("NEEDLE", options);
+	}, nullptr);
+	measure("count", corpus, bytes, 1, nullptr, [&]()
+	{
+		return child->countMatches(corpus.charset == Cjk ? QString::fromUtf8(u8"文档") : QString("the"), options) >= 0;
+	}, nullptr);
+
+	close();
+}
+
+int Benchmark::run()
+{
+	if (!dir.isValid())
+	{
+		QTextStream(stderr) << "cannot create temporary directory\n";
+		return 1;
+	}
+
+	//每个大小分别生成短行和长行、三种字符集的语料
+	for (qint64 size : sizes)
+	{
+		for (int charset = Ascii; charset <= Cjk; ++charset)
+		{
+			for (int longLines = 0; longLines < 2; ++longLines)
+			{
+				Corpus corpus;
+				corpus.bytes = size;
+				corpus.charset = Charset(charset);
+				corpus.longLines = longLines;
+				corpus.name = QString("%1-%2-%3").arg(size).arg(charset == Ascii ? "ascii" : charset == Utf8 ? "utf8" : "cjk")
+					.arg(longLines ? "long" : "short");
+				if (!generate(corpus))
+				{
+					QTextStream(stderr) << "cannot write corpus " << corpus.name << '\n';
+					return 1;
+				}
+				benchmarkCorpus(corpus);
+				QFile::remove(corpus.fileName);
+			}
+		}
+	}
+
+	QJsonObject root;
+	root["version"] = 1;
+	root["qt"] = QString(qVersion());
+	root["platform"] = QGuiApplication::platformName();
+	root["results"] = results;
+	QByteArray json = QJsonDocument(root).toJson();
+	if (outputFile.isEmpty())
+	{
+		QTextStream(stdout) << json;
+		return 0;
+	}
+	QFile file(outputFile);
+	if (!file.open(QFile::WriteOnly) || file.write(json) != json.size())
+	{
+		QTextStream(stderr) << "cannot write " << outputFile << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+﻿#ifndef BENCHMARK_H
+#define BENCHMARK_H
+#include <functional>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QJsonArray>
+
+//基准测试：用 --benchmark 启动时运行，不创建主窗口。
+//先在临时目录中生成不同大小、行长和字符集的合成语料，再对每份语料测量
+//加载、保存、滚动、连续输入、粘贴、撤销和搜索，结果以JSON输出，便于在版本之间比较。
+//在没有显示器的机器上可以加上 -platform offscreen 运行
+class Benchmark
+{
+public:
+	explicit Benchmark(const QStringList &arguments);
+
+	int run();                                  //运行全部测量，返回进程的退出码
+
+	static bool requested(const QStringList &arguments) { return arguments.contains("--benchmark"); }
+
+	enum Charset { Ascii, Utf8, Cjk };
+	//写出一份合成语料，QtTest基准测试也用它生成同样的文件
+	static bool generate(const QString &fileName, qint64 bytes, bool longLines, Charset charset);
+	static qint64 parseSize(const QString &text);   //解析1K、16M、1G这样的大小
+
+private:
+	struct Corpus
+	{
+		QString name;
+		qint64 bytes;                           //目标大小（UTF-8字节）
+		bool longLines;                         //每行约64KB，否则每行几十个字符
+		Charset charset;
+		QString fileName;
+	};
+
+	bool generate(Corpus &corpus);              //按配置写出语料文件
+	void benchmarkCorpus(const Corpus &corpus);
+
+	//先执行setup，再计时执行body，最后执行teardown；重复到达到最少次数和最短总时间
+	void measure(const QString &name, const Corpus &corpus, qint64 bytes, int operations,
+		std::function<void()> setup, std::function<bool()> body, std::function<void()> teardown);
+
+	QList<qint64> sizes;
+	QString outputFile;                         //结果文件，为空时输出到标准输出
+	int minIterations;
+	qint64 minTotalTime;                        //每项测量的最短总时间（毫秒）
+	QTemporaryDir dir;
+	QJsonArray results;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,45 @@
+﻿#include "blockdata.h"
+#include "trigramindex.h"
+#include "bracketindex.h"
+#include "lineindex.h"
+
+BlockData::BlockData() :
+	trigramIndex(nullptr),
+	trigramId(0),
+	bracketIndex(nullptr),
+	bracketNode(-1),
+	foldedLines(0),
+	lineIndex(nullptr),
+	lineNode(-1),
+	spellChecked(false)
+{
+}
+
+BlockData::~BlockData()
+{
+	//块被删除时让索引把它的编号标记为失效
+	if (trigramIndex)
+	{
+		trigramIndex->blockRemoved(trigramId);
+	}
+	//从括号索引的树中移除这一行
+	if (bracketIndex)
+	{
+		bracketIndex->blockRemoved(bracketNode);
+	}
+	if (lineIndex)
+	{
+		lineIndex->blockRemoved(lineNode);
+	}
+}
+
+BlockData * BlockData::get(QTextBlock block)
+{
+	BlockData * data = static_cast<BlockData *>(block.userData());
+	if (!data)
+	{
+		data = new BlockData;
+		block.setUserData(data);
+	}
+	return data;
+}
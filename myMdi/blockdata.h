@@ -0,0 +1,35 @@
+﻿#ifndef BLOCKDATA_H
+#define BLOCKDATA_H
+#include <QTextBlock>
+#include <QVector>
+
+class TrigramIndex;
+class BracketIndex;
+class LineIndex;
+
+//附加在每个文本块（行）上的数据，供各种索引按块增量维护
+//文本块被删除时QTextDocument会销毁它，析构函数借此通知所属的索引
+class BlockData : public QTextBlockUserData
+{
+public:
+	BlockData();
+	~BlockData();
+
+	//取得块上的数据，没有则新建一个
+	static BlockData * get(QTextBlock block);
+
+	TrigramIndex * trigramIndex;    //所属的三元组索引，为空表示未被索引
+	quint32 trigramId;              //在三元组索引中的编号
+
+	BracketIndex * bracketIndex;    //所属的括号索引
+	int bracketNode;                //在括号索引中的结点编号
+	int foldedLines;                //折叠在这一行之下的行数，0表示没有折叠
+
+	LineIndex * lineIndex;          //所属的行索引
+	int lineNode;                   //在行索引中的结点编号
+
+	bool spellChecked;              //拼写检查的结果是否对应当前内容
+	QVector<int> misspelled;        //拼错的单词，依次为行内起点和长度
+};
+
+#endif // BLOCKDATA_H
@@ -0,0 +1,536 @@
+﻿#include <QTextDocument>
+#include <QTextBlock>
+#include <QTimer>
+#include <QtConcurrent>
+#include "bracketindex.h"
+#include "tracer.h"
+#include "blockdata.h"
+
+BracketIndex::BracketIndex(QTextDocument *document) :
+	QObject(document),
+	doc(document),
+	root(-1),
+	seed(2463534242u),
+	ready(true),
+	buildRevision(0)
+{
+	watcher = new QFutureWatcher<BuildResult>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(buildFinished()));
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+
+	//空文档只有一个没有括号的块
+	Node node;
+	node.left = node.right = node.parent = -1;
+	node.priority = nextPriority();
+	node.size = 1;
+	nodes.append(node);
+	root = 0;
+	BlockData * data = BlockData::get(doc->begin());
+	data->bracketIndex = this;
+	data->bracketNode = 0;
+}
+
+BracketIndex::~BracketIndex()
+{
+	watcher->waitForFinished();
+	for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+	{
+		BlockData * data = static_cast<BlockData *>(block.userData());
+		if (data && data->bracketIndex == this)
+		{
+			data->bracketIndex = nullptr;
+		}
+	}
+}
+
+void BracketIndex::invalidate()
+{
+	ready = false;
+	nodes.clear();
+	freeNodes.clear();
+	root = -1;
+}
+
+void BracketIndex::rebuild()
+{
+	if (watcher->isRunning())
+	{
+		QTimer::singleShot(200, this, SLOT(rebuild()));
+		return;
+	}
+	ready = false;
+	buildRevision = doc->revision();
+	watcher->setFuture(QtConcurrent::run(&BracketIndex::build, doc->toPlainText()));
+}
+
+BracketIndex::Summary BracketIndex::combine(const Summary &left, const Summary &right)
+{
+	//左边未配对的左括号与右边未配对的右括号配对
+	int matched = qMin(left.open, right.close);
+	Summary result;
+	result.close = left.close + right.close - matched;
+	result.open = left.open + right.open - matched;
+	return result;
+}
+
+BracketIndex::Summary BracketIndex::summarize(const QChar *text, int length)
+{
+	Summary summary;
+	for (int i = 0; i < length; ++i)
+	{
+		if (isOpening(text[i]))
+		{
+			++summary.open;
+		}
+		else if (isClosing(text[i]))
+		{
+			if (summary.open > 0)
+				--summary.open;
+			else
+				++summary.close;
+		}
+	}
+	return summary;
+}
+
+BracketIndex::BuildResult BracketIndex::build(const QString &text)
+{
+	TRACE_SCOPE_CATEGORY("BracketIndex::build", "worker");
+	BuildResult result;
+	quint32 state = 2463534242u;
+	const QChar * data = text.constData();
+	int lineStart = 0;
+	for (int i = 0; i <= text.size(); ++i)
+	{
+		if (i == text.size() || data[i] == QLatin1Char('\n'))
+		{
+			Node node;
+			node.left = node.right = node.parent = -1;
+			node.size = 1;
+			node.local = summarize(data + lineStart, i - lineStart);
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			node.priority = state;
+			result.nodes.append(node);
+			lineStart = i + 1;
+		}
+	}
+
+	//先按行号建一棵完全平衡的树，再交换优先级使其满足堆序，整个过程为O(n)
+	result.root = buildBalanced(result.nodes, 0, result.nodes.size() - 1, -1);
+	heapify(result.nodes, result.root);
+	return result;
+}
+
+int BracketIndex::buildBalanced(QVector<Node> &nodes, int low, int high, int parent)
+{
+	if (low > high)
+	{
+		return -1;
+	}
+	int middle = low + (high - low) / 2;
+	Node &node = nodes[middle];
+	node.parent = parent;
+	node.left = buildBalanced(nodes, low, middle - 1, middle);
+	node.right = buildBalanced(nodes, middle + 1, high, middle);
+	Summary left = node.left < 0 ? Summary() : nodes.at(node.left).total;
+	Summary right = node.right < 0 ? Summary() : nodes.at(node.right).total;
+	node.size = high - low + 1;
+	node.total = combine(combine(left, node.local), right);
+	return middle;
+}
+
+void BracketIndex::heapify(QVector<Node> &nodes, int node)
+{
+	if (node < 0)
+	{
+		return;
+	}
+	heapify(nodes, nodes.at(node).left);
+	heapify(nodes, nodes.at(node).right);
+	//只交换优先级，树的形状和各结点的统计不变
+	for (int current = node; ; )
+	{
+		int left = nodes.at(current).left;
+		int right = nodes.at(current).right;
+		int largest = current;
+		if (left >= 0 && nodes.at(left).priority > nodes.at(largest).priority)
+			largest = left;
+		if (right >= 0 && nodes.at(right).priority > nodes.at(largest).priority)
+			largest = right;
+		if (largest == current)
+			break;
+		std::swap(nodes[current].priority, nodes[largest].priority);
+		current = largest;
+	}
+}
+
+void BracketIndex::buildFinished()
+{
+	//统计期间文档被修改过，重新统计
+	if (doc->revision() != buildRevision)
+	{
+		QTimer::singleShot(200, this, SLOT(rebuild()));
+		return;
+	}
+
+	BuildResult result = watcher->result();
+	nodes = result.nodes;
+	root = result.root;
+	freeNodes.clear();
+	int line = 0;
+	for (QTextBlock block = doc->begin(); block.isValid() && line < nodes.size(); block = block.next(), ++line)
+	{
+		BlockData * data = BlockData::get(block);
+		data->bracketIndex = this;
+		data->bracketNode = line;
+	}
+	ready = true;
+	emit indexReady();
+}
+
+quint32 BracketIndex::nextPriority()
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+void BracketIndex::update(int node)
+{
+	Node &n = nodes[node];
+	n.size = 1 + size(n.left) + size(n.right);
+	n.total = combine(combine(total(n.left), n.local), total(n.right));
+}
+
+void BracketIndex::updatePath(int node)
+{
+	for (; node >= 0; node = nodes.at(node).parent)
+	{
+		update(node);
+	}
+}
+
+int BracketIndex::rank(int node) const
+{
+	int result = size(nodes.at(node).left);
+	for (int parent = nodes.at(node).parent; parent >= 0; node = parent, parent = nodes.at(node).parent)
+	{
+		if (nodes.at(parent).right == node)
+			result += size(nodes.at(parent).left) + 1;
+	}
+	return result;
+}
+
+void BracketIndex::split(int tree, int count, int *left, int *right)
+{
+	if (tree < 0)
+	{
+		*left = *right = -1;
+		return;
+	}
+	int l, r;
+	if (size(nodes.at(tree).left) < count)
+	{
+		split(nodes.at(tree).right, count - size(nodes.at(tree).left) - 1, &l, &r);
+		nodes[tree].right = l;
+		if (l >= 0)
+			nodes[l].parent = tree;
+		update(tree);
+		*left = tree;
+		*right = r;
+	}
+	else
+	{
+		split(nodes.at(tree).left, count, &l, &r);
+		nodes[tree].left = r;
+		if (r >= 0)
+			nodes[r].parent = tree;
+		update(tree);
+		*left = l;
+		*right = tree;
+	}
+}
+
+int BracketIndex::merge(int left, int right)
+{
+	if (left < 0)
+		return right;
+	if (right < 0)
+		return left;
+	if (nodes.at(left).priority > nodes.at(right).priority)
+	{
+		int merged = merge(nodes.at(left).right, right);
+		nodes[left].right = merged;
+		nodes[merged].parent = left;
+		update(left);
+		return left;
+	}
+	int merged = merge(left, nodes.at(right).left);
+	nodes[right].left = merged;
+	nodes[merged].parent = right;
+	update(right);
+	return right;
+}
+
+void BracketIndex::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved);
+	if (!ready)
+	{
+		return;
+	}
+
+	//被删除的行已经在BlockData析构时从树中移除，这里重新统计修改范围内的行，新行按行号插入
+	int end = position + charsAdded;
+	for (QTextBlock block = doc->findBlock(position); block.isValid() && block.position() <= end; block = block.next())
+	{
+		QString text = block.text();
+		Summary local = summarize(text.constData(), text.size());
+		BlockData * data = BlockData::get(block);
+		if (data->bracketIndex == this)
+		{
+			nodes[data->bracketNode].local = local;
+			updatePath(data->bracketNode);
+			continue;
+		}
+
+		int node;
+		if (freeNodes.isEmpty())
+		{
+			node = nodes.size();
+			nodes.append(Node());
+		}
+		else
+		{
+			node = freeNodes.takeLast();
+		}
+		Node &n = nodes[node];
+		n.left = n.right = n.parent = -1;
+		n.priority = nextPriority();
+		n.size = 1;
+		n.local = n.total = local;
+		data->bracketIndex = this;
+		data->bracketNode = node;
+
+		int left, right;
+		split(root, block.blockNumber(), &left, &right);
+		root = merge(merge(left, node), right);
+		nodes[root].parent = -1;
+	}
+}
+
+void BracketIndex::blockRemoved(int node)
+{
+	if (!ready)
+	{
+		return;
+	}
+	int left, rest, middle, right;
+	split(root, rank(node), &left, &rest);
+	split(rest, 1, &middle, &right);
+	root = merge(left, right);
+	if (root >= 0)
+	{
+		nodes[root].parent = -1;
+	}
+	freeNodes.append(node);
+}
+
+int BracketIndex::searchForward(int node, int start, int offset, int *depth) const
+{
+	if (node < 0)
+	{
+		return -1;
+	}
+	const Node &n = nodes.at(node);
+	int here = offset + size(n.left);
+	if (start > here)
+	{
+		return searchForward(n.right, start, here + 1, depth);
+	}
+	if (start < here)
+	{
+		int found = searchForward(n.left, start, offset, depth);
+		if (found >= 0)
+			return found;
+	}
+	if (n.local.close >= *depth)
+	{
+		return here;
+	}
+	*depth += n.local.open - n.local.close;
+	return searchWhole(n.right, here + 1, depth);
+}
+
+int BracketIndex::searchWhole(int node, int offset, int *depth) const
+{
+	if (node < 0)
+	{
+		return -1;
+	}
+	//整棵子树的右括号不够时直接跳过
+	const Node &n = nodes.at(node);
+	if (n.total.close < *depth)
+	{
+		*depth += n.total.open - n.total.close;
+		return -1;
+	}
+	int found = searchWhole(n.left, offset, depth);
+	if (found >= 0)
+	{
+		return found;
+	}
+	int here = offset + size(n.left);
+	if (n.local.close >= *depth)
+	{
+		return here;
+	}
+	*depth += n.local.open - n.local.close;
+	return searchWhole(n.right, here + 1, depth);
+}
+
+int BracketIndex::searchBackward(int node, int end, int offset, int *depth) const
+{
+	if (node < 0)
+	{
+		return -1;
+	}
+	const Node &n = nodes.at(node);
+	int here = offset + size(n.left);
+	if (end < here)
+	{
+		return searchBackward(n.left, end, offset, depth);
+	}
+	if (end > here)
+	{
+		int found = searchBackward(n.right, end, here + 1, depth);
+		if (found >= 0)
+			return found;
+	}
+	if (n.local.open >= *depth)
+	{
+		return here;
+	}
+	*depth += n.local.close - n.local.open;
+	return searchWholeBackward(n.left, offset, depth);
+}
+
+int BracketIndex::searchWholeBackward(int node, int offset, int *depth) const
+{
+	if (node < 0)
+	{
+		return -1;
+	}
+	const Node &n = nodes.at(node);
+	if (n.total.open < *depth)
+	{
+		*depth += n.total.close - n.total.open;
+		return -1;
+	}
+	int here = offset + size(n.left);
+	int found = searchWholeBackward(n.right, here + 1, depth);
+	if (found >= 0)
+	{
+		return found;
+	}
+	if (n.local.open >= *depth)
+	{
+		return here;
+	}
+	*depth += n.local.close - n.local.open;
+	return searchWholeBackward(n.left, offset, depth);
+}
+
+int BracketIndex::findInBlock(const QTextBlock &block, int from, bool forward, int *depth) const
+{
+	QString text = block.text();
+	if (forward)
+	{
+		for (int i = qMax(from, 0); i < text.size(); ++i)
+		{
+			if (isClosing(text.at(i)) && --*depth == 0)
+				return block.position() + i;
+			if (isOpening(text.at(i)))
+				++*depth;
+		}
+	}
+	else
+	{
+		for (int i = qMin(from, text.size() - 1); i >= 0; --i)
+		{
+			if (isOpening(text.at(i)) && --*depth == 0)
+				return block.position() + i;
+			if (isClosing(text.at(i)))
+				++*depth;
+		}
+	}
+	return -1;
+}
+
+int BracketIndex::match(int position) const
+{
+	QTextBlock block = doc->findBlock(position);
+	if (!ready || !block.isValid())
+	{
+		return -1;
+	}
+	BlockData * data = static_cast<BlockData *>(block.userData());
+	if (!data || data->bracketIndex != this)
+	{
+		return -1;
+	}
+
+	//先在本行中找，找不到时带着剩余的深度在树上查找匹配所在的行，最后在那一行中定位
+	QChar c = doc->characterAt(position);
+	int offset = position - block.position();
+	int depth = 1;
+	if (isOpening(c))
+	{
+		int found = findInBlock(block, offset + 1, true, &depth);
+		if (found >= 0)
+			return found;
+		int line = searchForward(root, rank(data->bracketNode) + 1, 0, &depth);
+		return line < 0 ? -1 : findInBlock(doc->findBlockByNumber(line), 0, true, &depth);
+	}
+	if (isClosing(c))
+	{
+		int found = findInBlock(block, offset - 1, false, &depth);
+		if (found >= 0)
+			return found;
+		int line = rank(data->bracketNode) - 1;
+		line = (line < 0) ? -1 : searchBackward(root, line, 0, &depth);
+		if (line < 0)
+			return -1;
+		QTextBlock target = doc->findBlockByNumber(line);
+		return findInBlock(target, target.length() - 1, false, &depth);
+	}
+	return -1;
+}
+
+int BracketIndex::foldEnd(const QTextBlock &block) const
+{
+	//找出本行最后一个未配对的左括号
+	QString text = block.text();
+	int opening = -1;
+	QVector<int> stack;
+	for (int i = 0; i < text.size(); ++i)
+	{
+		if (isOpening(text.at(i)))
+			stack.append(i);
+		else if (isClosing(text.at(i)) && !stack.isEmpty())
+			stack.removeLast();
+	}
+	if (!stack.isEmpty())
+	{
+		opening = stack.last();
+	}
+	if (opening < 0)
+	{
+		return -1;
+	}
+	int closing = match(block.position() + opening);
+	return closing < 0 ? -1 : doc->findBlock(closing).blockNumber();
+}
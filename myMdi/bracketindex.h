@@ -0,0 +1,96 @@
+﻿#ifndef BRACKETINDEX_H
+#define BRACKETINDEX_H
+#include <QObject>
+#include <QVector>
+#include <QFutureWatcher>
+
+class QTextDocument;
+class QTextBlock;
+
+//括号索引：每一行在括号内部配对后，只剩下若干个未配对的右括号和左括号，
+//以行为元素建立一棵隐式treap，每个结点保存子树中各行合起来的未配对括号数。
+//据此查找匹配的括号和折叠范围只需沿树下降，代价为O(log n)；
+//插入或删除行、修改一行也只需更新一条路径。三种括号按同一种嵌套关系处理
+class BracketIndex : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit BracketIndex(QTextDocument *document);
+	~BracketIndex();
+
+	void invalidate();                          //文档将被整体替换，暂停增量维护
+	bool isReady() const { return ready; }
+
+	int match(int position) const;              //position处括号的匹配括号的位置，没有时为-1
+	int foldEnd(const QTextBlock &block) const; //以该行最后一个未配对左括号开始的折叠范围，返回匹配括号所在的行号，没有时为-1
+
+	void blockRemoved(int node);                //文本块被删除时由BlockData调用
+
+	static bool isOpening(QChar c) { return c == QLatin1Char('(') || c == QLatin1Char('[') || c == QLatin1Char('{'); }
+	static bool isClosing(QChar c) { return c == QLatin1Char(')') || c == QLatin1Char(']') || c == QLatin1Char('}'); }
+
+public slots:
+	void rebuild();                             //在工作线程中重新统计每一行并建树
+
+signals:
+	void indexReady();                          //索引可用
+
+private slots:
+	void buildFinished();
+	void documentChanged(int position, int charsRemoved, int charsAdded);
+
+private:
+	//未配对的括号数：先有close个未配对的右括号，之后是open个未配对的左括号
+	struct Summary
+	{
+		Summary() : close(0), open(0) {}
+		int close;
+		int open;
+	};
+	static Summary combine(const Summary &left, const Summary &right);
+	static Summary summarize(const QChar *text, int length);
+
+	struct Node
+	{
+		int left, right, parent;
+		quint32 priority;
+		int size;                               //子树中的行数
+		Summary local;                          //这一行的未配对括号
+		Summary total;                          //整棵子树的未配对括号
+	};
+	struct BuildResult
+	{
+		QVector<Node> nodes;                    //第i个结点对应第i行
+		int root;
+	};
+	static BuildResult build(const QString &text);
+	static int buildBalanced(QVector<Node> &nodes, int low, int high, int parent);
+	static void heapify(QVector<Node> &nodes, int node);
+
+	int size(int node) const { return node < 0 ? 0 : nodes.at(node).size; }
+	Summary total(int node) const { return node < 0 ? Summary() : nodes.at(node).total; }
+	void update(int node);
+	void updatePath(int node);                  //修改结点后更新到根的路径
+	int rank(int node) const;                   //结点对应的行号
+	void split(int tree, int count, int *left, int *right);
+	int merge(int left, int right);
+	quint32 nextPriority();
+
+	int searchForward(int node, int start, int offset, int *depth) const;    //从第start行起向后查找使depth归零的行
+	int searchWhole(int node, int offset, int *depth) const;
+	int searchBackward(int node, int end, int offset, int *depth) const;     //从第end行起向前查找
+	int searchWholeBackward(int node, int offset, int *depth) const;
+	int findInBlock(const QTextBlock &block, int from, bool forward, int *depth) const;  //在一行中找出使depth归零的括号
+
+	QTextDocument * doc;
+	QVector<Node> nodes;
+	QVector<int> freeNodes;                     //已删除结点的编号，供新行复用
+	int root;
+	quint32 seed;
+	bool ready;
+	int buildRevision;
+	QFutureWatcher<BuildResult> * watcher;
+};
+
+#endif // BRACKETINDEX_H
@@ -0,0 +1,169 @@
+﻿#include <algorithm>
+#include "cursorset.h"
+
+CursorSet::CursorSet() :
+	count(0)
+{
+}
+
+void CursorSet::clear()
+{
+	tree.clear();
+	lengths.clear();
+	count = 0;
+}
+
+void CursorSet::setRanges(QVector<Range> ranges)
+{
+	for (Range &range : ranges)
+	{
+		if (range.start > range.end)
+			std::swap(range.start, range.end);
+	}
+	std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b)
+	{
+		return a.start < b.start || (a.start == b.start && a.end < b.end);
+	});
+
+	//合并重叠的选区和位置相同的光标
+	QVector<Range> merged;
+	merged.reserve(ranges.size());
+	for (const Range &range : ranges)
+	{
+		if (!merged.isEmpty() && (range.start < merged.last().end || range.start == merged.last().start))
+		{
+			merged.last().end = qMax(merged.last().end, range.end);
+			continue;
+		}
+		merged.append(range);
+	}
+
+	//按间隔线性建立树状数组
+	count = merged.size();
+	tree.fill(0, count + 1);
+	lengths.resize(count);
+	int previous = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		tree[i + 1] = merged.at(i).start - previous;
+		lengths[i] = merged.at(i).end - merged.at(i).start;
+		previous = merged.at(i).start;
+	}
+	for (int i = 1; i <= count; ++i)
+	{
+		int parent = i + (i & -i);
+		if (parent <= count)
+			tree[parent] += tree[i];
+	}
+}
+
+void CursorSet::add(const Range &range)
+{
+	QVector<Range> all = ranges();
+	all.append(range);
+	setRanges(all);
+}
+
+CursorSet::Range CursorSet::at(int index) const
+{
+	int start = prefix(index);
+	return Range(start, start + lengths.at(index));
+}
+
+QVector<CursorSet::Range> CursorSet::ranges() const
+{
+	//按建树的逆过程从后向前还原出各个间隔：处理i时它的值还没有被扣减过，
+	//正是建树时加到父结点上的值。之后依次累加间隔得到起点，整体为O(n)
+	QVector<int> gaps = tree;
+	for (int i = count; i >= 1; --i)
+	{
+		int parent = i + (i & -i);
+		if (parent <= count)
+			gaps[parent] -= gaps.at(i);
+	}
+	QVector<Range> result;
+	result.reserve(count);
+	int start = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		start += gaps.at(i + 1);
+		result.append(Range(start, start + lengths.at(i)));
+	}
+	return result;
+}
+
+int CursorSet::prefix(int index) const
+{
+	int sum = 0;
+	for (int i = index + 1; i > 0; i -= i & -i)
+		sum += tree.at(i);
+	return sum;
+}
+
+void CursorSet::addGap(int index, int delta)
+{
+	for (int i = index + 1; i <= count; i += i & -i)
+		tree[i] += delta;
+}
+
+int CursorSet::lowerBound(int position) const
+{
+	//间隔都不为负，前缀和单调不减，可以在树状数组上二分
+	int step = 1;
+	while (step * 2 <= count)
+		step *= 2;
+	int index = 0;
+	int remaining = position;
+	for (; step > 0; step /= 2)
+	{
+		if (index + step <= count && tree.at(index + step) < remaining)
+		{
+			index += step;
+			remaining -= tree.at(index);
+		}
+	}
+	return index;
+}
+
+void CursorSet::shift(int position, int removed, int added)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	int delta = added - removed;
+	int removedEnd = position + removed;
+	int first = lowerBound(position);
+	int last = lowerBound(removedEnd);
+	if (removed == 0)
+	{
+		last = first;
+	}
+
+	//起点在修改处之前、但选区跨过修改处的光标，只调整其长度
+	if (first > 0)
+	{
+		int start = prefix(first - 1);
+		int end = start + lengths.at(first - 1);
+		if (end > position)
+			lengths[first - 1] = (end >= removedEnd ? end + delta : position) - start;
+	}
+
+	//起点落在被删除范围内的光标移到删除处
+	for (int i = first; i < last; ++i)
+	{
+		int start = prefix(i);
+		int end = start + lengths.at(i);
+		int move = position - start;
+		addGap(i, move);
+		if (i + 1 < count)
+			addGap(i + 1, -move);
+		lengths[i] = (end >= removedEnd ? end + delta : position) - position;
+	}
+
+	//之后的光标整体平移，只需修改一个间隔
+	if (last < count)
+	{
+		addGap(last, delta);
+	}
+}
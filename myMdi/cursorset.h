@@ -0,0 +1,43 @@
+﻿#ifndef CURSORSET_H
+#define CURSORSET_H
+#include <QVector>
+
+//多光标集合：各个光标（选区）按位置有序且互不重叠。
+//起点之间的间隔保存在树状数组中，文档在某处插入或删除文本时，
+//只需修改该处之后第一个光标的间隔，就能让后面所有光标一起平移，代价为O(log n)
+class CursorSet
+{
+public:
+	struct Range
+	{
+		Range() : start(0), end(0) {}
+		Range(int s, int e) : start(s), end(e) {}
+		int start;      //选区起点，等于终点时表示没有选中文本的光标
+		int end;        //选区终点
+	};
+
+	CursorSet();
+
+	void clear();
+	int size() const { return count; }
+	bool isEmpty() const { return count == 0; }
+
+	void setRanges(QVector<Range> ranges);      //替换全部光标，排序并合并重叠的选区，O(n log n)
+	void add(const Range &range);               //添加一个光标，O(n)
+	Range at(int index) const;                  //第index个光标，O(log n)
+	QVector<Range> ranges() const;              //按位置顺序取出全部光标，O(n)
+	int lowerBound(int position) const;         //第一个起点不小于position的光标序号，O(log n)
+
+	//文档在position处删除了removed个字符并插入了added个字符，调整各个光标的位置
+	void shift(int position, int removed, int added);
+
+private:
+	int prefix(int index) const;                //第0到index个间隔之和，即第index个光标的起点
+	void addGap(int index, int delta);          //修改第index个间隔
+
+	QVector<int> tree;                          //间隔的树状数组，下标从1开始
+	QVector<int> lengths;                       //各个选区的长度
+	int count;
+};
+
+#endif // CURSORSET_H
@@ -0,0 +1,138 @@
+﻿#include <algorithm>
+#include "dictionary.h"
+
+//单词在行中遇到这些字符就结束
+static inline bool isTerminator(uchar c)
+{
+	return c == '\n' || c == '\r' || c == '/' || c == '\t' || c == ' ';
+}
+
+Dictionary::Dictionary() :
+	data(nullptr),
+	length(0)
+{
+}
+
+Dictionary::~Dictionary()
+{
+	if (data)
+	{
+		file.unmap(const_cast<uchar *>(data));
+	}
+}
+
+bool Dictionary::load(const QString &fileName, QString *error)
+{
+	file.setFileName(fileName);
+	if (!file.open(QFile::ReadOnly))
+	{
+		if (error)
+			*error = file.errorString();
+		return false;
+	}
+	length = file.size();
+	if (length == 0 || length >= 0xffffffffLL)
+	{
+		if (error)
+			*error = QString::fromLocal8Bit("词典文件为空或过大");
+		return false;
+	}
+	data = file.map(0, length);
+	if (!data)
+	{
+		if (error)
+			*error = file.errorString();
+		return false;
+	}
+
+	//扫描一遍记下每行的起点，已经排好序的词典不必再排序
+	bool ordered = true;
+	for (qint64 pos = 0; pos < length; )
+	{
+		qint64 end = pos;
+		while (end < length && data[end] != '\n')
+			++end;
+		if (end > pos && !isTerminator(data[pos]))
+		{
+			if (ordered && !offsets.isEmpty() && less(quint32(pos), offsets.last()))
+				ordered = false;
+			offsets.append(quint32(pos));
+		}
+		pos = end + 1;
+	}
+	//Hunspell词典的第一行是词数
+	if (!offsets.isEmpty() && offsets.first() == 0)
+	{
+		qint64 pos = 0;
+		while (pos < length && data[pos] >= '0' && data[pos] <= '9')
+			++pos;
+		if (pos > 0 && (pos == length || isTerminator(data[pos])))
+			offsets.removeFirst();
+	}
+	if (!ordered)
+	{
+		std::sort(offsets.begin(), offsets.end(), [this](quint32 a, quint32 b) { return less(a, b); });
+	}
+	return true;
+}
+
+bool Dictionary::less(quint32 a, quint32 b) const
+{
+	for (;; ++a, ++b)
+	{
+		bool endA = a >= length || isTerminator(data[a]);
+		bool endB = b >= length || isTerminator(data[b]);
+		if (endA || endB)
+			return endA && !endB;
+		if (data[a] != data[b])
+			return data[a] < data[b];
+	}
+}
+
+int Dictionary::compare(quint32 offset, const QByteArray &word) const
+{
+	//按UTF-8字节比较，与排序的顺序一致
+	for (int i = 0; ; ++i, ++offset)
+	{
+		bool end = offset >= length || isTerminator(data[offset]);
+		if (i == word.size())
+			return end ? 0 : 1;
+		if (end)
+			return -1;
+		uchar c = uchar(word.at(i));
+		if (data[offset] != c)
+			return data[offset] < c ? -1 : 1;
+	}
+}
+
+bool Dictionary::lookup(const QString &word) const
+{
+	QByteArray utf8 = word.toUtf8();
+	QVector<quint32>::const_iterator it = std::lower_bound(offsets.begin(), offsets.end(), utf8,
+		[this](quint32 offset, const QByteArray &value) { return compare(offset, value) < 0; });
+	return it != offsets.end() && compare(*it, utf8) == 0;
+}
+
+bool Dictionary::contains(const QString &word) const
+{
+	{
+		QReadLocker locker(&cacheLock);
+		QHash<QString, bool>::const_iterator it = cache.constFind(word);
+		if (it != cache.constEnd())
+			return it.value();
+	}
+
+	bool found = lookup(word);
+	if (!found && word.size() > 1 && word.at(0).isUpper())
+	{
+		found = lookup(word.toLower());
+	}
+
+	QWriteLocker locker(&cacheLock);
+	if (cache.size() >= MaxCacheSize)
+	{
+		cache.clear();
+	}
+	cache.insert(word, found);
+	return found;
+}
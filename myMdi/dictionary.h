@@ -0,0 +1,41 @@
+﻿#ifndef DICTIONARY_H
+#define DICTIONARY_H
+#include <QFile>
+#include <QVector>
+#include <QHash>
+#include <QReadWriteLock>
+
+//拼写词典：用QFile::map把词典文件映射到内存，不复制单词本身，
+//只保存每个单词在文件中的偏移，排好序后二分查找。
+//支持每行一个单词的词表和Hunspell的.dic文件（第一行的词数和'/'之后的词缀标记会被忽略）。
+//查询结果缓存在散列表中，可以在多个线程中同时查询
+class Dictionary
+{
+public:
+	Dictionary();
+	~Dictionary();
+
+	bool load(const QString &fileName, QString *error = nullptr);   //映射并索引词典文件
+	QString fileName() const { return file.fileName(); }
+	int size() const { return offsets.size(); }
+
+	//单词是否拼写正确；首字母大写的单词也按小写形式查找
+	bool contains(const QString &word) const;
+
+private:
+	bool lookup(const QString &word) const;
+	int compare(quint32 offset, const QByteArray &word) const;  //偏移处的单词与word比较
+	bool less(quint32 a, quint32 b) const;
+
+	enum { MaxCacheSize = 65536 };
+
+	QFile file;
+	const uchar * data;                         //映射的文件内容
+	qint64 length;
+	QVector<quint32> offsets;                   //按单词排序的各个单词起点
+
+	mutable QReadWriteLock cacheLock;
+	mutable QHash<QString, bool> cache;         //最近查询过的单词，数量超出上限时清空
+};
+
+#endif // DICTIONARY_H
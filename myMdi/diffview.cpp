@@ -0,0 +1,208 @@
+﻿#include <algorithm>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QSplitter>
+#include <QLabel>
+#include <QPushButton>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QtConcurrent>
+#include "diffview.h"
+#include "mdichild.h"
+
+namespace
+{
+	//超过这个长度的行不做字符级比较，整行高亮
+	const int MaximumRefineLength = 10000;
+}
+
+DiffView::DiffView(QWidget *parent) :
+	QWidget(parent),
+	finished(false)
+{
+	setAttribute(Qt::WA_DeleteOnClose);
+	setMinimumSize(1000, 600);
+
+	summary = new QLabel(QString::fromLocal8Bit("正在比较..."));
+	QPushButton * previous = new QPushButton(QString::fromLocal8Bit("上一处(&P)"));
+	QPushButton * next = new QPushButton(QString::fromLocal8Bit("下一处(&N)"));
+	connect(previous, SIGNAL(clicked()), this, SLOT(previousHunk()));
+	connect(next, SIGNAL(clicked()), this, SLOT(nextHunk()));
+	QHBoxLayout * top = new QHBoxLayout;
+	top->addWidget(summary, 1);
+	top->addWidget(previous);
+	top->addWidget(next);
+
+	oldPane = createPane();
+	newPane = createPane();
+	QSplitter * splitter = new QSplitter(Qt::Horizontal);
+	splitter->addWidget(oldPane);
+	splitter->addWidget(newPane);
+
+	QVBoxLayout * layout = new QVBoxLayout(this);
+	layout->addLayout(top);
+	layout->addWidget(splitter, 1);
+
+	//两侧的行一一对应，直接同步滚动条的值
+	connect(oldPane->verticalScrollBar(), SIGNAL(valueChanged(int)), newPane->verticalScrollBar(), SLOT(setValue(int)));
+	connect(newPane->verticalScrollBar(), SIGNAL(valueChanged(int)), oldPane->verticalScrollBar(), SLOT(setValue(int)));
+	connect(oldPane->horizontalScrollBar(), SIGNAL(valueChanged(int)), newPane->horizontalScrollBar(), SLOT(setValue(int)));
+	connect(newPane->horizontalScrollBar(), SIGNAL(valueChanged(int)), oldPane->horizontalScrollBar(), SLOT(setValue(int)));
+	connect(oldPane->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateHighlights()));
+
+	watcher = new QFutureWatcher<LineDiff::Result>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(compareFinished()));
+}
+
+QPlainTextEdit * DiffView::createPane()
+{
+	QPlainTextEdit * pane = new QPlainTextEdit;
+	pane->setReadOnly(true);
+	pane->setLineWrapMode(QPlainTextEdit::NoWrap);
+	pane->setFont(MdiChild::editorFont());
+	return pane;
+}
+
+void DiffView::compare(const QString &oldTitle, const QString &oldText,
+	const QString &newTitle, const QString &newText)
+{
+	this->oldTitle = oldTitle;
+	this->newTitle = newTitle;
+	setWindowTitle(QString::fromLocal8Bit("比较：%1 ↔ %2").arg(oldTitle, newTitle));
+	finished = false;
+	refinements.clear();
+	watcher->setFuture(QtConcurrent::run(&LineDiff::compare, oldText, newText));
+}
+
+void DiffView::compareFinished()
+{
+	result = watcher->result();
+	oldPane->setPlainText(result.oldAligned);
+	newPane->setPlainText(result.newAligned);
+	//对齐后的文本已经放进编辑器，不再保留一份副本
+	result.oldAligned.clear();
+	result.newAligned.clear();
+	finished = true;
+
+	summary->setText(QString::fromLocal8Bit("%1（%2行） ↔ %3（%4行）：%5处差异，删除%6行，新增%7行，耗时%8毫秒")
+		.arg(oldTitle).arg(result.oldLines).arg(newTitle).arg(result.newLines)
+		.arg(result.hunks.size()).arg(result.deleted).arg(result.inserted).arg(result.elapsed));
+	updateHighlights();
+}
+
+int DiffView::firstVisibleRow() const
+{
+	return oldPane->cursorForPosition(QPoint(0, 0)).blockNumber();
+}
+
+void DiffView::updateHighlights()
+{
+	if (!finished)
+	{
+		return;
+	}
+	int first = firstVisibleRow();
+	int last = oldPane->cursorForPosition(QPoint(0, oldPane->viewport()->height())).blockNumber();
+
+	QTextCharFormat deletedFormat, insertedFormat, fillerFormat, deletedChars, insertedChars;
+	deletedFormat.setBackground(QColor(255, 220, 220));
+	insertedFormat.setBackground(QColor(220, 255, 220));
+	fillerFormat.setBackground(QColor(235, 235, 235));
+	deletedChars.setBackground(QColor(255, 160, 160));
+	insertedChars.setBackground(QColor(160, 235, 160));
+	for (QTextCharFormat * format : { &deletedFormat, &insertedFormat, &fillerFormat })
+	{
+		format->setProperty(QTextFormat::FullWidthSelection, true);
+	}
+
+	//二分查找第一处结束于可见范围之后的差异
+	QVector<LineDiff::Hunk>::const_iterator it = std::upper_bound(result.hunks.constBegin(), result.hunks.constEnd(), first,
+		[](int row, const LineDiff::Hunk &hunk) { return row < hunk.row + hunk.rows(); });
+
+	QList<QTextEdit::ExtraSelection> oldSelections, newSelections;
+	auto lineSelection = [](QPlainTextEdit *pane, int row, const QTextCharFormat &format)
+	{
+		QTextEdit::ExtraSelection selection;
+		selection.cursor = QTextCursor(pane->document()->findBlockByNumber(row));
+		selection.format = format;
+		return selection;
+	};
+	auto charSelections = [](QPlainTextEdit *pane, int row, const QVector<LineDiff::Range> &ranges,
+		const QTextCharFormat &format, QList<QTextEdit::ExtraSelection> *selections)
+	{
+		QTextBlock block = pane->document()->findBlockByNumber(row);
+		for (const LineDiff::Range &range : ranges)
+		{
+			QTextEdit::ExtraSelection selection;
+			selection.cursor = QTextCursor(block);
+			selection.cursor.setPosition(block.position() + range.start);
+			selection.cursor.setPosition(block.position() + range.start + range.length, QTextCursor::KeepAnchor);
+			selection.format = format;
+			selections->append(selection);
+		}
+	};
+
+	for (; it != result.hunks.constEnd() && it->row <= last; ++it)
+	{
+		const LineDiff::Hunk &hunk = *it;
+		int oldCount = hunk.oldEnd - hunk.oldStart;
+		int newCount = hunk.newEnd - hunk.newStart;
+		for (int r = qMax(0, first - hunk.row); r < hunk.rows() && hunk.row + r <= last; ++r)
+		{
+			int row = hunk.row + r;
+			oldSelections.append(lineSelection(oldPane, row, r < oldCount ? deletedFormat : fillerFormat));
+			newSelections.append(lineSelection(newPane, row, r < newCount ? insertedFormat : fillerFormat));
+			if (r >= oldCount || r >= newCount)
+			{
+				continue;
+			}
+
+			//两侧都有内容的行做字符级比较，结果缓存起来
+			if (!refinements.contains(row))
+			{
+				Refinement refinement;
+				QString oldLine = oldPane->document()->findBlockByNumber(row).text();
+				QString newLine = newPane->document()->findBlockByNumber(row).text();
+				if (oldLine.size() <= MaximumRefineLength && newLine.size() <= MaximumRefineLength)
+				{
+					LineDiff::compareCharacters(oldLine, newLine, &refinement.oldRanges, &refinement.newRanges);
+				}
+				refinements.insert(row, refinement);
+			}
+			const Refinement &refinement = refinements[row];
+			charSelections(oldPane, row, refinement.oldRanges, deletedChars, &oldSelections);
+			charSelections(newPane, row, refinement.newRanges, insertedChars, &newSelections);
+		}
+	}
+	oldPane->setExtraSelections(oldSelections);
+	newPane->setExtraSelections(newSelections);
+}
+
+void DiffView::scrollToRow(int row)
+{
+	QTextCursor cursor(oldPane->document()->findBlockByNumber(row));
+	oldPane->setTextCursor(cursor);
+	oldPane->verticalScrollBar()->setValue(row);
+}
+
+void DiffView::nextHunk()
+{
+	//差异按行号有序，二分查找
+	QVector<LineDiff::Hunk>::const_iterator it = std::upper_bound(result.hunks.constBegin(), result.hunks.constEnd(), firstVisibleRow(),
+		[](int row, const LineDiff::Hunk &hunk) { return row < hunk.row; });
+	if (it != result.hunks.constEnd())
+	{
+		scrollToRow(it->row);
+	}
+}
+
+void DiffView::previousHunk()
+{
+	QVector<LineDiff::Hunk>::const_iterator it = std::lower_bound(result.hunks.constBegin(), result.hunks.constEnd(), firstVisibleRow(),
+		[](const LineDiff::Hunk &hunk, int row) { return hunk.row < row; });
+	if (it != result.hunks.constBegin())
+	{
+		scrollToRow((it - 1)->row);
+	}
+}
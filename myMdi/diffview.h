@@ -0,0 +1,57 @@
+﻿#ifndef DIFFVIEW_H
+#define DIFFVIEW_H
+#include <QWidget>
+#include <QHash>
+#include <QFutureWatcher>
+#include "linediff.h"
+
+class QPlainTextEdit;
+class QLabel;
+
+//并排比较视图：左右两侧按行对齐，滚动同步，
+//只为可见范围内的差异设置高亮，行内的字符级差异在第一次显示时才计算
+class DiffView : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit DiffView(QWidget *parent = nullptr);
+
+	//在工作线程中比较两段文本，标题用于显示
+	void compare(const QString &oldTitle, const QString &oldText,
+		const QString &newTitle, const QString &newText);
+
+	bool isFinished() const { return finished; }
+	int hunkCount() const { return result.hunks.size(); }
+
+public slots:
+	void nextHunk();                            //跳到下一处差异
+	void previousHunk();                        //跳到上一处差异
+
+private slots:
+	void compareFinished();                     //工作线程比较完成
+	void updateHighlights();                    //为可见范围内的差异设置高亮
+
+private:
+	QPlainTextEdit * createPane();
+	int firstVisibleRow() const;                //第一个可见的行
+	void scrollToRow(int row);
+
+	//一对行的字符级差异
+	struct Refinement
+	{
+		QVector<LineDiff::Range> oldRanges;
+		QVector<LineDiff::Range> newRanges;
+	};
+
+	QLabel * summary;                           //差异统计
+	QPlainTextEdit * oldPane;
+	QPlainTextEdit * newPane;
+	QString oldTitle, newTitle;
+	LineDiff::Result result;
+	bool finished;
+	QFutureWatcher<LineDiff::Result> * watcher;
+	QHash<int, Refinement> refinements;         //已经计算过的行内差异，以对齐后的行号为键
+};
+
+#endif // DIFFVIEW_H
@@ -0,0 +1,64 @@
+﻿#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include "findreplacedialog.h"
+
+FindReplaceDialog::FindReplaceDialog(QWidget *parent) :
+	QDialog(parent)
+{
+	setWindowTitle(QString::fromLocal8Bit("查找替换"));
+
+	findEdit = new QLineEdit(this);
+	replaceEdit = new QLineEdit(this);
+	regexBox = new QCheckBox(QString::fromLocal8Bit("正则表达式（&E）"), this);
+	caseBox = new QCheckBox(QString::fromLocal8Bit("区分大小写（&C）"), this);
+	caseBox->setChecked(true);
+	replaceEdit->setToolTip(QString::fromLocal8Bit("正则模式下可以使用\\1、$1或${name}引用捕获组"));
+
+	QPushButton * findBtn = new QPushButton(QString::fromLocal8Bit("查找下一个（&F）"), this);
+	QPushButton * replaceAllBtn = new QPushButton(QString::fromLocal8Bit("全部替换（&A）"), this);
+	QPushButton * countAllBtn = new QPushButton(QString::fromLocal8Bit("在所有文档中计数（&O）"), this);
+	QPushButton * closeBtn = new QPushButton(QString::fromLocal8Bit("关闭"), this);
+	findBtn->setDefault(true);
+
+	QGridLayout * layout = new QGridLayout(this);
+	layout->addWidget(new QLabel(QString::fromLocal8Bit("查找内容："), this), 0, 0);
+	layout->addWidget(findEdit, 0, 1);
+	layout->addWidget(findBtn, 0, 2);
+	layout->addWidget(new QLabel(QString::fromLocal8Bit("替换为："), this), 1, 0);
+	layout->addWidget(replaceEdit, 1, 1);
+	layout->addWidget(replaceAllBtn, 1, 2);
+	QHBoxLayout * optionLayout = new QHBoxLayout;
+	optionLayout->addWidget(regexBox);
+	optionLayout->addWidget(caseBox);
+	optionLayout->addStretch();
+	layout->addLayout(optionLayout, 2, 0, 1, 2);
+	layout->addWidget(countAllBtn, 2, 2);
+	layout->addWidget(closeBtn, 3, 2);
+
+	connect(findBtn, SIGNAL(clicked()), this, SIGNAL(findNextRequested()));
+	connect(replaceAllBtn, SIGNAL(clicked()), this, SIGNAL(replaceAllRequested()));
+	connect(countAllBtn, SIGNAL(clicked()), this, SIGNAL(countAllRequested()));
+	connect(closeBtn, SIGNAL(clicked()), this, SLOT(close()));
+}
+
+QString FindReplaceDialog::findText() const
+{
+	return findEdit->text();
+}
+
+QString FindReplaceDialog::replaceText() const
+{
+	return replaceEdit->text();
+}
+
+SearchEngine::Options FindReplaceDialog::options() const
+{
+	SearchEngine::Options options;
+	options.useRegex = regexBox->isChecked();
+	options.caseSensitive = caseBox->isChecked();
+	return options;
+}
@@ -0,0 +1,33 @@
+﻿#ifndef FINDREPLACEDIALOG_H
+#define FINDREPLACEDIALOG_H
+#include <QDialog>
+#include "searchengine.h"
+
+class QLineEdit;
+class QCheckBox;
+
+//查找替换对话框，非模态显示，具体操作交给主窗口作用于活动子窗口
+class FindReplaceDialog : public QDialog
+{
+	Q_OBJECT
+
+public:
+	explicit FindReplaceDialog(QWidget *parent = nullptr);
+
+	QString findText() const;                   //查找内容
+	QString replaceText() const;                //替换内容
+	SearchEngine::Options options() const;      //查找选项
+
+signals:
+	void findNextRequested();                   //请求查找下一个
+	void replaceAllRequested();                 //请求全部替换
+	void countAllRequested();                   //请求在所有打开的文档中统计匹配数
+
+private:
+	QLineEdit * findEdit;                       //查找内容输入框
+	QLineEdit * replaceEdit;                    //替换内容输入框
+	QCheckBox * regexBox;                       //使用正则表达式
+	QCheckBox * caseBox;                        //区分大小写
+};
+
+#endif // FINDREPLACEDIALOG_H
@@ -0,0 +1,9 @@
+﻿#include <QPixmap>
+#include "iconatlas.h"
+
+QIcon IconAtlas::icon(Icon icon)
+{
+	//图集在第一次使用时解码，之后各个图标从中复制
+	static const QPixmap atlas(":/ICON/atlas.png");
+	return QIcon(atlas.copy(icon % Columns * CellSize, icon / Columns * CellSize, CellSize, CellSize));
+}
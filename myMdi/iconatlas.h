@@ -0,0 +1,25 @@
+﻿#ifndef ICONATLAS_H
+#define ICONATLAS_H
+#include <QIcon>
+
+//图标图集：ICON/atlas.png把各个原始图标预先缩小到32×32，每行4个拼成一张小图，
+//启动时只解码这一张图片，而不是逐个解码几百像素的PNG和多尺寸的ICO。
+//Icon的顺序就是图集中从左到右、从上到下的顺序，增加图标时两边一起修改
+class IconAtlas
+{
+public:
+	enum Icon
+	{
+		New, Open, Save, SaveAs,
+		Exit, Undo, Redo, Cut,
+		Copy, Paste, Next, Previous,
+		About, AboutQt, Application
+	};
+
+	static QIcon icon(Icon icon);
+
+private:
+	enum { CellSize = 32, Columns = 4 };
+};
+
+#endif // ICONATLAS_H
@@ -0,0 +1,90 @@
+﻿#include "latencyhistogram.h"
+
+bool LatencyHistogram::enabled = false;
+
+LatencyHistogram::LatencyHistogram() :
+	total(0),
+	sum(0),
+	maxValue(0)
+{
+}
+
+bool LatencyHistogram::isEnabled()
+{
+	return enabled;
+}
+
+void LatencyHistogram::setEnabled(bool on)
+{
+	enabled = on;
+}
+
+int LatencyHistogram::bucketOf(qint64 micros)
+{
+	//小于SubBuckets的值各占一个桶，之后每个2的幂区间分为SubBuckets个桶
+	if (micros < SubBuckets)
+	{
+		return int(qMax<qint64>(micros, 0));
+	}
+	int exponent = 63 - qCountLeadingZeroBits(quint64(micros));
+	int sub = int(micros >> (exponent - SubBits)) - SubBuckets;
+	return qMin(int(BucketCount) - 1, (exponent - SubBits + 1) * SubBuckets + sub);
+}
+
+qint64 LatencyHistogram::upperBound(int bucket)
+{
+	if (bucket < SubBuckets)
+	{
+		return bucket;
+	}
+	int shift = bucket / SubBuckets - 1;
+	qint64 lower = qint64(SubBuckets + bucket % SubBuckets) << shift;
+	return lower + (qint64(1) << shift) - 1;
+}
+
+void LatencyHistogram::add(qint64 micros)
+{
+	if (counts.isEmpty())
+	{
+		counts.fill(0, BucketCount);
+	}
+	++counts[bucketOf(micros)];
+	++total;
+	sum += micros;
+	maxValue = qMax(maxValue, micros);
+}
+
+void LatencyHistogram::clear()
+{
+	counts.clear();
+	total = sum = maxValue = 0;
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+	if (total == 0)
+	{
+		return 0;
+	}
+	//第一个累计次数达到总数p%的桶
+	qint64 rank = qMax<qint64>(1, qint64(total * p / 100.0 + 0.5));
+	qint64 seen = 0;
+	for (int i = 0; i < counts.size(); ++i)
+	{
+		seen += counts.at(i);
+		if (seen >= rank)
+			return qMin(upperBound(i), maxValue);
+	}
+	return maxValue;
+}
+
+QVector<QPair<qint64, qint64> > LatencyHistogram::buckets() const
+{
+	QVector<QPair<qint64, qint64> > result;
+	for (int i = 0; i < counts.size(); ++i)
+	{
+		if (counts.at(i))
+			result.append(qMakePair(upperBound(i), counts.at(i)));
+	}
+	return result;
+}
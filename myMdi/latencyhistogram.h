@@ -0,0 +1,40 @@
+﻿#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+#include <QVector>
+#include <QPair>
+
+//延迟直方图：按对数刻度分桶，每个2的幂区间再均分为SubBuckets个桶，
+//任何延迟只需一次计数，百分位数的相对误差不超过1/SubBuckets。
+//第一次记录时才分配桶，未开启测量时不占内存
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	static bool isEnabled();                    //是否开启输入延迟测量
+	static void setEnabled(bool enabled);
+
+	void add(qint64 micros);                    //记录一次延迟（微秒）
+	void clear();
+
+	qint64 count() const { return total; }
+	qint64 maximum() const { return maxValue; }
+	qint64 mean() const { return total ? sum / total : 0; }
+	qint64 percentile(double p) const;          //第p百分位（0到100），返回所在桶的上界
+
+	QVector<QPair<qint64, qint64> > buckets() const;   //非空的桶：上界和次数，用于导出
+
+private:
+	enum { SubBuckets = 8, SubBits = 3, BucketCount = 320 };
+	static int bucketOf(qint64 micros);
+	static qint64 upperBound(int bucket);
+
+	QVector<qint64> counts;
+	qint64 total;
+	qint64 sum;
+	qint64 maxValue;
+
+	static bool enabled;
+};
+
+#endif // LATENCYHISTOGRAM_H
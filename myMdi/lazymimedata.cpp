@@ -0,0 +1,110 @@
+﻿#include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QTextCursor>
+#include <QTextBlock>
+#include "lazymimedata.h"
+
+LazyMimeData::LazyMimeData(QTextDocument *document, int start, int end) :
+	doc(document),
+	rangeStart(start),
+	rangeEnd(end),
+	materialized(false)
+{
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+}
+
+QStringList LazyMimeData::formats() const
+{
+	return QStringList() << QLatin1String("text/plain") << QLatin1String("text/html");
+}
+
+bool LazyMimeData::hasFormat(const QString &mimeType) const
+{
+	return formats().contains(mimeType);
+}
+
+bool LazyMimeData::overlaps(int start, int end) const
+{
+	//在范围内部插入也会改变复制的内容，所以端点处按相交处理
+	return !materialized && start <= rangeEnd && end >= rangeStart;
+}
+
+void LazyMimeData::materialize()
+{
+	if (materialized)
+	{
+		return;
+	}
+	text = plainText();
+	materialized = true;
+	if (doc)
+	{
+		disconnect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+	}
+}
+
+void LazyMimeData::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	if (materialized)
+	{
+		return;
+	}
+	if (position + charsRemoved <= rangeStart)
+	{
+		//修改完全在范围之前，平移范围
+		rangeStart += charsAdded - charsRemoved;
+		rangeEnd += charsAdded - charsRemoved;
+	}
+	else if (position < rangeEnd)
+	{
+		//编辑器没有事先保存的修改（正常情况下不会发生），只能按修改后的文本保存
+		rangeEnd = qMin(rangeEnd, doc->characterCount() - 1);
+		rangeStart = qMin(rangeStart, rangeEnd);
+		materialize();
+	}
+}
+
+QString LazyMimeData::plainText() const
+{
+	if (materialized || !doc)
+	{
+		return text;
+	}
+
+	//按块依次追加，不经过QTextCursor::selectedText()的中间副本
+	QString result;
+	result.reserve(rangeEnd - rangeStart);
+	for (QTextBlock block = doc->findBlock(rangeStart); block.isValid() && block.position() <= rangeEnd; block = block.next())
+	{
+		int from = qMax(rangeStart - block.position(), 0);
+		int to = qMin(rangeEnd - block.position(), block.length() - 1);
+		if (block.position() > rangeStart)
+		{
+			result.append(QLatin1Char('\n'));
+		}
+		result.append(block.text().midRef(from, to - from));
+	}
+	return result;
+}
+
+QVariant LazyMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+	Q_UNUSED(type);
+	if (mimeType == QLatin1String("text/plain"))
+	{
+		return plainText();
+	}
+	if (mimeType == QLatin1String("text/html"))
+	{
+		//HTML只在被请求时生成，文档还在时保留原有格式
+		if (!materialized && doc)
+		{
+			QTextCursor cursor(doc);
+			cursor.setPosition(rangeStart);
+			cursor.setPosition(rangeEnd, QTextCursor::KeepAnchor);
+			return QTextDocumentFragment(cursor).toHtml();
+		}
+		return QTextDocumentFragment::fromPlainText(text).toHtml();
+	}
+	return QVariant();
+}
@@ -0,0 +1,41 @@
+﻿#ifndef LAZYMIMEDATA_H
+#define LAZYMIMEDATA_H
+#include <QMimeData>
+#include <QPointer>
+
+class QTextDocument;
+
+//延迟生成内容的剪贴板数据：复制时只记录文档和范围，
+//其他程序真正请求数据时才从文档中取出纯文本或HTML。
+//文档中这个范围将被修改时，由编辑器先调用materialize()保存一份纯文本
+class LazyMimeData : public QMimeData
+{
+	Q_OBJECT
+
+public:
+	LazyMimeData(QTextDocument *document, int start, int end);
+
+	QStringList formats() const;
+	bool hasFormat(const QString &mimeType) const;
+
+	bool overlaps(int start, int end) const;    //[start, end)处的修改是否会影响复制的内容
+	void materialize();                         //把复制的内容保存下来，不再依赖文档
+	bool isMaterialized() const { return materialized; }
+
+protected:
+	QVariant retrieveData(const QString &mimeType, QVariant::Type type) const;
+
+private slots:
+	void documentChanged(int position, int charsRemoved, int charsAdded);    //修改在范围之前时平移范围
+
+private:
+	QString plainText() const;                  //逐块从文档中拼出纯文本
+
+	QPointer<QTextDocument> doc;
+	int rangeStart;                             //复制的范围
+	int rangeEnd;
+	bool materialized;
+	QString text;                               //保存下来的纯文本
+};
+
+#endif // LAZYMIMEDATA_H
@@ -0,0 +1,383 @@
+﻿#include <climits>
+#include <cmath>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringRef>
+#include "linediff.h"
+#include "tracer.h"
+
+//Myers算法的工作区：前向和后向两组对角线上走得最远的位置
+struct LineDiff::Context
+{
+	const int * a;
+	const int * b;
+	char * changedA;
+	char * changedB;
+	QVector<int> forward;
+	QVector<int> backward;
+	int offset;             //对角线编号到数组下标的偏移
+	int costLimit;          //编辑距离超过这个值时放弃最优解，取走得最远的对角线作为分割点
+};
+
+void LineDiff::split(Context &context, int aLow, int aHigh, int bLow, int bHigh, int *aMid, int *bMid)
+{
+	const int * a = context.a;
+	const int * b = context.b;
+	int * fd = context.forward.data() + context.offset;
+	int * bd = context.backward.data() + context.offset;
+
+	int dmin = aLow - bHigh;
+	int dmax = aHigh - bLow;
+	int fmid = aLow - bLow;
+	int bmid = aHigh - bHigh;
+	bool odd = ((fmid - bmid) & 1) != 0;
+	int fmin = fmid, fmax = fmid;
+	int bmin = bmid, bmax = bmid;
+	fd[fmid] = aLow;
+	bd[bmid] = aHigh;
+
+	for (int cost = 1; ; ++cost)
+	{
+		//前向扩展一步
+		if (fmin > dmin)
+			fd[--fmin - 1] = -1;
+		else
+			++fmin;
+		if (fmax < dmax)
+			fd[++fmax + 1] = -1;
+		else
+			--fmax;
+		for (int d = fmax; d >= fmin; d -= 2)
+		{
+			int i = (fd[d - 1] >= fd[d + 1]) ? fd[d - 1] + 1 : fd[d + 1];
+			int j = i - d;
+			while (i < aHigh && j < bHigh && a[i] == b[j])
+			{
+				++i;
+				++j;
+			}
+			fd[d] = i;
+			if (odd && bmin <= d && d <= bmax && bd[d] <= i)
+			{
+				*aMid = i;
+				*bMid = j;
+				return;
+			}
+		}
+
+		//后向扩展一步
+		if (bmin > dmin)
+			bd[--bmin - 1] = INT_MAX;
+		else
+			++bmin;
+		if (bmax < dmax)
+			bd[++bmax + 1] = INT_MAX;
+		else
+			--bmax;
+		for (int d = bmax; d >= bmin; d -= 2)
+		{
+			int i = (bd[d - 1] < bd[d + 1]) ? bd[d - 1] : bd[d + 1] - 1;
+			int j = i - d;
+			while (i > aLow && j > bLow && a[i - 1] == b[j - 1])
+			{
+				--i;
+				--j;
+			}
+			bd[d] = i;
+			if (!odd && fmin <= d && d <= fmax && i <= fd[d])
+			{
+				*aMid = i;
+				*bMid = j;
+				return;
+			}
+		}
+
+		if (cost < context.costLimit)
+		{
+			continue;
+		}
+
+		//差异太多时不再求最优解，取前向或后向走得最远的点作为分割点，保证耗时有上界
+		int forwardBest = -1, forwardI = aLow, forwardJ = bLow;
+		for (int d = fmax; d >= fmin; d -= 2)
+		{
+			int i = qMin(fd[d], aHigh);
+			int j = i - d;
+			if (j > bHigh)
+			{
+				i = bHigh + d;
+				j = bHigh;
+			}
+			if (forwardBest < i + j)
+			{
+				forwardBest = i + j;
+				forwardI = i;
+				forwardJ = j;
+			}
+		}
+		int backwardBest = INT_MAX, backwardI = aHigh, backwardJ = bHigh;
+		for (int d = bmax; d >= bmin; d -= 2)
+		{
+			int i = qMax(aLow, bd[d]);
+			int j = i - d;
+			if (j < bLow)
+			{
+				i = bLow + d;
+				j = bLow;
+			}
+			if (i + j < backwardBest)
+			{
+				backwardBest = i + j;
+				backwardI = i;
+				backwardJ = j;
+			}
+		}
+		if ((aHigh + bHigh) - backwardBest < forwardBest - (aLow + bLow))
+		{
+			*aMid = forwardI;
+			*bMid = forwardJ;
+		}
+		else
+		{
+			*aMid = backwardI;
+			*bMid = backwardJ;
+		}
+		return;
+	}
+}
+
+void LineDiff::compareSequences(const QVector<int> &a, const QVector<int> &b,
+	QVector<char> *changedA, QVector<char> *changedB)
+{
+	int n = a.size();
+	int m = b.size();
+	changedA->fill(0, n);
+	changedB->fill(0, m);
+
+	Context context;
+	context.a = a.constData();
+	context.b = b.constData();
+	context.changedA = changedA->data();
+	context.changedB = changedB->data();
+	context.offset = m + 1;
+	context.forward.resize(n + m + 3);
+	context.backward.resize(n + m + 3);
+	context.costLimit = qMax(256, int(std::sqrt(double(n + m))));
+
+	//用显式的栈代替递归，分割很不均匀时也不会栈溢出
+	struct Span { int aLow, aHigh, bLow, bHigh; };
+	QVector<Span> stack;
+	stack.append({ 0, n, 0, m });
+	while (!stack.isEmpty())
+	{
+		Span span = stack.takeLast();
+		//去掉公共的开头和结尾
+		while (span.aLow < span.aHigh && span.bLow < span.bHigh && a.at(span.aLow) == b.at(span.bLow))
+		{
+			++span.aLow;
+			++span.bLow;
+		}
+		while (span.aLow < span.aHigh && span.bLow < span.bHigh && a.at(span.aHigh - 1) == b.at(span.bHigh - 1))
+		{
+			--span.aHigh;
+			--span.bHigh;
+		}
+		if (span.aLow == span.aHigh)
+		{
+			for (int j = span.bLow; j < span.bHigh; ++j)
+				context.changedB[j] = 1;
+			continue;
+		}
+		if (span.bLow == span.bHigh)
+		{
+			for (int i = span.aLow; i < span.aHigh; ++i)
+				context.changedA[i] = 1;
+			continue;
+		}
+		int aMid, bMid;
+		split(context, span.aLow, span.aHigh, span.bLow, span.bHigh, &aMid, &bMid);
+		stack.append({ aMid, span.aHigh, bMid, span.bHigh });
+		stack.append({ span.aLow, aMid, span.bLow, bMid });
+	}
+}
+
+QVector<LineDiff::Hunk> LineDiff::buildHunks(const QVector<char> &changedA, const QVector<char> &changedB)
+{
+	//未修改的行在两侧一一对应，跳过它们之后两侧连续的修改行就是一处差异
+	QVector<Hunk> hunks;
+	int n = changedA.size();
+	int m = changedB.size();
+	int i = 0, j = 0, row = 0;
+	while (i < n || j < m)
+	{
+		if (i < n && j < m && !changedA.at(i) && !changedB.at(j))
+		{
+			++i;
+			++j;
+			++row;
+			continue;
+		}
+		Hunk hunk;
+		hunk.oldStart = i;
+		hunk.newStart = j;
+		hunk.row = row;
+		while (i < n && changedA.at(i))
+			++i;
+		while (j < m && changedB.at(j))
+			++j;
+		hunk.oldEnd = i;
+		hunk.newEnd = j;
+		row += hunk.rows();
+		hunks.append(hunk);
+	}
+	return hunks;
+}
+
+QVector<LineDiff::Hunk> LineDiff::diffLines(const QVector<QStringRef> &oldLines, const QVector<QStringRef> &newLines)
+{
+	//相同内容的行映射为同一个编号，之后只比较整数
+	QHash<QStringRef, int> ids;
+	ids.reserve(oldLines.size() + newLines.size());
+	QVector<int> oldIds(oldLines.size());
+	QVector<int> newIds(newLines.size());
+	QVector<int> oldCount, newCount;    //每个编号在两侧出现的次数
+	for (int i = 0; i < oldLines.size(); ++i)
+	{
+		int id = ids.value(oldLines.at(i), -1);
+		if (id < 0)
+		{
+			id = ids.size();
+			ids.insert(oldLines.at(i), id);
+			oldCount.append(0);
+			newCount.append(0);
+		}
+		oldIds[i] = id;
+		++oldCount[id];
+	}
+	for (int i = 0; i < newLines.size(); ++i)
+	{
+		int id = ids.value(newLines.at(i), -1);
+		if (id < 0)
+		{
+			id = ids.size();
+			ids.insert(newLines.at(i), id);
+			oldCount.append(0);
+			newCount.append(0);
+		}
+		newIds[i] = id;
+		++newCount[id];
+	}
+	ids.clear();
+
+	//只出现在一侧的行必然是修改，不参与Myers算法，可以大大缩短要比较的序列
+	QVector<int> oldKept, newKept;      //参与比较的行在原文中的行号
+	QVector<int> oldSeq, newSeq;
+	QVector<char> oldChanged(oldIds.size(), 1);
+	QVector<char> newChanged(newIds.size(), 1);
+	for (int i = 0; i < oldIds.size(); ++i)
+	{
+		if (newCount.at(oldIds.at(i)) > 0)
+		{
+			oldKept.append(i);
+			oldSeq.append(oldIds.at(i));
+		}
+	}
+	for (int i = 0; i < newIds.size(); ++i)
+	{
+		if (oldCount.at(newIds.at(i)) > 0)
+		{
+			newKept.append(i);
+			newSeq.append(newIds.at(i));
+		}
+	}
+	QVector<char> oldSeqChanged, newSeqChanged;
+	compareSequences(oldSeq, newSeq, &oldSeqChanged, &newSeqChanged);
+	for (int i = 0; i < oldKept.size(); ++i)
+		oldChanged[oldKept.at(i)] = oldSeqChanged.at(i);
+	for (int i = 0; i < newKept.size(); ++i)
+		newChanged[newKept.at(i)] = newSeqChanged.at(i);
+
+	return buildHunks(oldChanged, newChanged);
+}
+
+LineDiff::Result LineDiff::compare(const QString &oldText, const QString &newText)
+{
+	TRACE_SCOPE_CATEGORY("LineDiff::compare", "worker");
+	Result result;
+	QElapsedTimer timer;
+	timer.start();
+
+	QVector<QStringRef> oldLines = oldText.splitRef(QLatin1Char('\n'));
+	QVector<QStringRef> newLines = newText.splitRef(QLatin1Char('\n'));
+	result.oldLines = oldLines.size();
+	result.newLines = newLines.size();
+
+	result.hunks = diffLines(oldLines, newLines);
+
+	//生成对齐的文本，差异处较短的一侧补空行，这样两侧的行号一一对应
+	result.oldAligned.reserve(oldText.size() + newLines.size());
+	result.newAligned.reserve(newText.size() + oldLines.size());
+	int oldLine = 0, newLine = 0;
+	bool first = true;
+	auto appendRow = [&](const QStringRef &oldRef, const QStringRef &newRef)
+	{
+		if (!first)
+		{
+			result.oldAligned.append(QLatin1Char('\n'));
+			result.newAligned.append(QLatin1Char('\n'));
+		}
+		first = false;
+		result.oldAligned.append(oldRef);
+		result.newAligned.append(newRef);
+	};
+	for (int h = 0; h <= result.hunks.size(); ++h)
+	{
+		int oldStop = (h < result.hunks.size()) ? result.hunks.at(h).oldStart : oldLines.size();
+		for (; oldLine < oldStop; ++oldLine, ++newLine)
+			appendRow(oldLines.at(oldLine), newLines.at(newLine));
+		if (h == result.hunks.size())
+			break;
+		const Hunk &hunk = result.hunks.at(h);
+		for (int r = 0; r < hunk.rows(); ++r)
+		{
+			appendRow(hunk.oldStart + r < hunk.oldEnd ? oldLines.at(hunk.oldStart + r) : QStringRef(),
+				hunk.newStart + r < hunk.newEnd ? newLines.at(hunk.newStart + r) : QStringRef());
+		}
+		oldLine = hunk.oldEnd;
+		newLine = hunk.newEnd;
+		result.deleted += hunk.oldEnd - hunk.oldStart;
+		result.inserted += hunk.newEnd - hunk.newStart;
+	}
+	result.elapsed = timer.elapsed();
+	return result;
+}
+
+void LineDiff::compareCharacters(const QString &oldLine, const QString &newLine,
+	QVector<Range> *oldRanges, QVector<Range> *newRanges)
+{
+	QVector<int> a(oldLine.size());
+	QVector<int> b(newLine.size());
+	for (int i = 0; i < oldLine.size(); ++i)
+		a[i] = oldLine.at(i).unicode();
+	for (int i = 0; i < newLine.size(); ++i)
+		b[i] = newLine.at(i).unicode();
+	QVector<char> changedA, changedB;
+	compareSequences(a, b, &changedA, &changedB);
+
+	//把连续的修改字符合并成范围
+	auto collect = [](const QVector<char> &changed, QVector<Range> *ranges)
+	{
+		ranges->clear();
+		for (int i = 0; i < changed.size(); ++i)
+		{
+			if (!changed.at(i))
+				continue;
+			if (!ranges->isEmpty() && ranges->last().start + ranges->last().length == i)
+				++ranges->last().length;
+			else
+				ranges->append(Range(i, 1));
+		}
+	};
+	collect(changedA, oldRanges);
+	collect(changedB, newRanges);
+}
@@ -0,0 +1,67 @@
+﻿#ifndef LINEDIFF_H
+#define LINEDIFF_H
+#include <QString>
+#include <QVector>
+#include <QStringRef>
+
+//按行比较两段文本：先把每一行映射为整数编号，再用线性空间的Myers算法求出最短编辑脚本。
+//只依赖纯文本，可以在工作线程中运行
+class LineDiff
+{
+public:
+	//一处差异：旧文本的[oldStart, oldEnd)行被替换为新文本的[newStart, newEnd)行
+	struct Hunk
+	{
+		Hunk() : oldStart(0), oldEnd(0), newStart(0), newEnd(0), row(0) {}
+		int oldStart, oldEnd;
+		int newStart, newEnd;
+		int row;                //在并排对齐的视图中的起始行
+		int rows() const { return qMax(oldEnd - oldStart, newEnd - newStart); }
+	};
+
+	//比较的结果
+	struct Result
+	{
+		Result() : oldLines(0), newLines(0), deleted(0), inserted(0), elapsed(0) {}
+		QVector<Hunk> hunks;    //按位置排序的各处差异
+		QString oldAligned;     //对齐后的旧文本，差异处较短的一侧用空行补齐
+		QString newAligned;     //对齐后的新文本
+		int oldLines;
+		int newLines;
+		int deleted;            //删除的行数
+		int inserted;           //新增的行数
+		qint64 elapsed;         //计算耗时（毫秒）
+	};
+
+	//一段字符范围
+	struct Range
+	{
+		Range() : start(0), length(0) {}
+		Range(int s, int l) : start(s), length(l) {}
+		int start;
+		int length;
+	};
+
+	//比较两段文本，生成差异和对齐后的文本
+	static Result compare(const QString &oldText, const QString &newText);
+
+	//按行比较，各行引用原文本
+	static QVector<Hunk> diffLines(const QVector<QStringRef> &oldLines, const QVector<QStringRef> &newLines);
+
+	//逐字符比较两行，给出各自被修改的字符范围，用于行内细化
+	static void compareCharacters(const QString &oldLine, const QString &newLine,
+		QVector<Range> *oldRanges, QVector<Range> *newRanges);
+
+	//比较两个整数序列，标记各自不在最长公共子序列中的元素
+	static void compareSequences(const QVector<int> &a, const QVector<int> &b,
+		QVector<char> *changedA, QVector<char> *changedB);
+
+	//根据两侧的修改标记归并出各处差异，row按对齐视图计算
+	static QVector<Hunk> buildHunks(const QVector<char> &changedA, const QVector<char> &changedB);
+
+private:
+	struct Context;
+	static void split(Context &context, int aLow, int aHigh, int bLow, int bHigh, int *aMid, int *bMid);
+};
+
+#endif // LINEDIFF_H
@@ -0,0 +1,461 @@
+﻿#include <QTextDocument>
+#include <QTextBlock>
+#include <QTimer>
+#include <QtConcurrent>
+#include "lineindex.h"
+#include "tracer.h"
+#include "blockdata.h"
+
+LineIndex::LineIndex(QTextDocument *document) :
+	QObject(document),
+	doc(document),
+	root(-1),
+	seed(2463534242u),
+	ready(true),
+	buildRevision(0)
+{
+	watcher = new QFutureWatcher<BuildResult>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(buildFinished()));
+
+	//空文档只有一个空行，所以一开始就是就绪的
+	Node node;
+	node.left = node.right = node.parent = -1;
+	node.priority = nextPriority();
+	node.size = 1;
+	node.words = node.bytes = 0;
+	node.totalWords = node.totalBytes = 0;
+	nodes.append(node);
+	root = 0;
+	BlockData * data = BlockData::get(doc->begin());
+	data->lineIndex = this;
+	data->lineNode = 0;
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+}
+
+LineIndex::~LineIndex()
+{
+	watcher->waitForFinished();
+	for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+	{
+		BlockData * data = static_cast<BlockData *>(block.userData());
+		if (data && data->lineIndex == this)
+		{
+			data->lineIndex = nullptr;
+		}
+	}
+}
+
+void LineIndex::invalidate()
+{
+	ready = false;
+}
+
+void LineIndex::rebuild()
+{
+	if (watcher->isRunning())
+	{
+		QTimer::singleShot(200, this, SLOT(rebuild()));
+		return;
+	}
+	ready = false;
+	buildRevision = doc->revision();
+	watcher->setFuture(QtConcurrent::run(&LineIndex::build, doc->toPlainText()));
+}
+
+LineIndex::BuildResult LineIndex::build(const QString &text)
+{
+	TRACE_SCOPE_CATEGORY("LineIndex::build", "worker");
+	BuildResult result;
+	quint32 state = 2463534242u;
+	const QChar * data = text.constData();
+	int lineStart = 0;
+	for (int i = 0; i <= text.size(); ++i)
+	{
+		if (i == text.size() || data[i] == QLatin1Char('\n'))
+		{
+			Node node;
+			node.left = node.right = node.parent = -1;
+			node.size = 1;
+			countText(data + lineStart, i - lineStart, &node.words, &node.bytes);
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			node.priority = state;
+			result.nodes.append(node);
+			lineStart = i + 1;
+		}
+	}
+
+	//与括号索引相同，先建完全平衡的树再交换优先级，整个过程为O(n)
+	result.root = buildBalanced(result.nodes, 0, result.nodes.size() - 1, -1);
+	heapify(result.nodes, result.root);
+	return result;
+}
+
+int LineIndex::buildBalanced(QVector<Node> &nodes, int low, int high, int parent)
+{
+	if (low > high)
+	{
+		return -1;
+	}
+	int middle = low + (high - low) / 2;
+	Node &node = nodes[middle];
+	node.parent = parent;
+	node.left = buildBalanced(nodes, low, middle - 1, middle);
+	node.right = buildBalanced(nodes, middle + 1, high, middle);
+	node.size = high - low + 1;
+	node.totalWords = node.words;
+	node.totalBytes = node.bytes;
+	if (node.left >= 0)
+	{
+		node.totalWords += nodes.at(node.left).totalWords;
+		node.totalBytes += nodes.at(node.left).totalBytes;
+	}
+	if (node.right >= 0)
+	{
+		node.totalWords += nodes.at(node.right).totalWords;
+		node.totalBytes += nodes.at(node.right).totalBytes;
+	}
+	return middle;
+}
+
+void LineIndex::heapify(QVector<Node> &nodes, int node)
+{
+	if (node < 0)
+	{
+		return;
+	}
+	heapify(nodes, nodes.at(node).left);
+	heapify(nodes, nodes.at(node).right);
+	//只交换优先级，树的形状和各结点的统计不变
+	for (int current = node; ; )
+	{
+		int left = nodes.at(current).left;
+		int right = nodes.at(current).right;
+		int largest = current;
+		if (left >= 0 && nodes.at(left).priority > nodes.at(largest).priority)
+			largest = left;
+		if (right >= 0 && nodes.at(right).priority > nodes.at(largest).priority)
+			largest = right;
+		if (largest == current)
+			break;
+		std::swap(nodes[current].priority, nodes[largest].priority);
+		current = largest;
+	}
+}
+
+void LineIndex::buildFinished()
+{
+	//统计期间文档被修改过，重新统计
+	if (doc->revision() != buildRevision)
+	{
+		QTimer::singleShot(200, this, SLOT(rebuild()));
+		return;
+	}
+
+	BuildResult result = watcher->result();
+	nodes = result.nodes;
+	root = result.root;
+	freeNodes.clear();
+	int line = 0;
+	for (QTextBlock block = doc->begin(); block.isValid() && line < nodes.size(); block = block.next(), ++line)
+	{
+		BlockData * data = BlockData::get(block);
+		data->lineIndex = this;
+		data->lineNode = line;
+	}
+	ready = true;
+	emit statisticsChanged();
+}
+
+quint32 LineIndex::nextPriority()
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+void LineIndex::update(int node)
+{
+	Node &n = nodes[node];
+	n.size = 1;
+	n.totalWords = n.words;
+	n.totalBytes = n.bytes;
+	if (n.left >= 0)
+	{
+		n.size += nodes.at(n.left).size;
+		n.totalWords += nodes.at(n.left).totalWords;
+		n.totalBytes += nodes.at(n.left).totalBytes;
+	}
+	if (n.right >= 0)
+	{
+		n.size += nodes.at(n.right).size;
+		n.totalWords += nodes.at(n.right).totalWords;
+		n.totalBytes += nodes.at(n.right).totalBytes;
+	}
+}
+
+void LineIndex::updatePath(int node)
+{
+	for (; node >= 0; node = nodes.at(node).parent)
+	{
+		update(node);
+	}
+}
+
+int LineIndex::rank(int node) const
+{
+	int result = size(nodes.at(node).left);
+	for (int parent = nodes.at(node).parent; parent >= 0; node = parent, parent = nodes.at(node).parent)
+	{
+		if (nodes.at(parent).right == node)
+			result += size(nodes.at(parent).left) + 1;
+	}
+	return result;
+}
+
+void LineIndex::split(int tree, int count, int *left, int *right)
+{
+	if (tree < 0)
+	{
+		*left = *right = -1;
+		return;
+	}
+	int l, r;
+	if (size(nodes.at(tree).left) < count)
+	{
+		split(nodes.at(tree).right, count - size(nodes.at(tree).left) - 1, &l, &r);
+		nodes[tree].right = l;
+		if (l >= 0)
+			nodes[l].parent = tree;
+		update(tree);
+		*left = tree;
+		*right = r;
+	}
+	else
+	{
+		split(nodes.at(tree).left, count, &l, &r);
+		nodes[tree].left = r;
+		if (r >= 0)
+			nodes[r].parent = tree;
+		update(tree);
+		*left = l;
+		*right = tree;
+	}
+}
+
+int LineIndex::merge(int left, int right)
+{
+	if (left < 0)
+		return right;
+	if (right < 0)
+		return left;
+	if (nodes.at(left).priority > nodes.at(right).priority)
+	{
+		int merged = merge(nodes.at(left).right, right);
+		nodes[left].right = merged;
+		nodes[merged].parent = left;
+		update(left);
+		return left;
+	}
+	int merged = merge(left, nodes.at(right).left);
+	nodes[right].left = merged;
+	nodes[merged].parent = right;
+	update(right);
+	return right;
+}
+
+void LineIndex::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved);
+	if (!ready)
+	{
+		return;
+	}
+
+	//被删除的行已经在BlockData析构时从树中移除，这里重新统计修改范围内的行，新行按行号插入
+	int end = position + charsAdded;
+	for (QTextBlock block = doc->findBlock(position); block.isValid() && block.position() <= end; block = block.next())
+	{
+		int words = 0;
+		int bytes = 0;
+		QString text = block.text();
+		countText(text.constData(), text.size(), &words, &bytes);
+		BlockData * data = BlockData::get(block);
+		if (data->lineIndex == this)
+		{
+			nodes[data->lineNode].words = words;
+			nodes[data->lineNode].bytes = bytes;
+			updatePath(data->lineNode);
+			continue;
+		}
+
+		int node;
+		if (freeNodes.isEmpty())
+		{
+			node = nodes.size();
+			nodes.append(Node());
+		}
+		else
+		{
+			node = freeNodes.takeLast();
+		}
+		Node &n = nodes[node];
+		n.left = n.right = n.parent = -1;
+		n.priority = nextPriority();
+		n.size = 1;
+		n.words = words;
+		n.bytes = bytes;
+		n.totalWords = words;
+		n.totalBytes = bytes;
+		data->lineIndex = this;
+		data->lineNode = node;
+
+		int left, right;
+		split(root, block.blockNumber(), &left, &right);
+		root = merge(merge(left, node), right);
+		nodes[root].parent = -1;
+	}
+	emit statisticsChanged();
+}
+
+void LineIndex::blockRemoved(int node)
+{
+	if (!ready)
+	{
+		return;
+	}
+	int left, rest, middle, right;
+	split(root, rank(node), &left, &rest);
+	split(rest, 1, &middle, &right);
+	root = merge(left, right);
+	if (root >= 0)
+	{
+		nodes[root].parent = -1;
+	}
+	freeNodes.append(node);
+}
+
+void LineIndex::prefix(int lines, qint64 *words, qint64 *bytes) const
+{
+	//沿树下降，走向右子树时把左子树和当前行计入
+	*words = 0;
+	*bytes = 0;
+	for (int node = root; node >= 0 && lines > 0; )
+	{
+		const Node &n = nodes.at(node);
+		int leftSize = size(n.left);
+		if (lines <= leftSize)
+		{
+			node = n.left;
+			continue;
+		}
+		if (n.left >= 0)
+		{
+			*words += nodes.at(n.left).totalWords;
+			*bytes += nodes.at(n.left).totalBytes;
+		}
+		*words += n.words;
+		*bytes += n.bytes;
+		lines -= leftSize + 1;
+		node = n.right;
+	}
+}
+
+void LineIndex::countText(const QChar *text, int length, int *words, int *bytes)
+{
+	int wordCount = 0;
+	int byteCount = 0;
+	bool inWord = false;
+	for (int i = 0; i < length; ++i)
+	{
+		ushort c = text[i].unicode();
+		//代理对的两半各算两个字节，合起来正好是四字节的UTF-8编码
+		if (c < 0x80)
+			byteCount += 1;
+		else if (c < 0x800 || QChar::isSurrogate(c))
+			byteCount += 2;
+		else
+			byteCount += 3;
+
+		bool space = text[i].isSpace();
+		if (!space && !inWord)
+			++wordCount;
+		inWord = !space;
+	}
+	*words = wordCount;
+	*bytes = byteCount;
+}
+
+TextStatistics LineIndex::statistics() const
+{
+	TextStatistics stats;
+	stats.lines = doc->blockCount();
+	stats.chars = doc->characterCount() - 1;
+	stats.words = root < 0 ? 0 : nodes.at(root).totalWords;
+	//每两行之间还有一个换行符
+	stats.bytes = (root < 0 ? 0 : nodes.at(root).totalBytes) + stats.lines - 1;
+	return stats;
+}
+
+TextStatistics LineIndex::selectionStatistics(int start, int end) const
+{
+	TextStatistics stats;
+	if (start >= end)
+	{
+		return stats;
+	}
+
+	QTextBlock first = doc->findBlock(start);
+	QTextBlock last = doc->findBlock(end);
+	if (!last.isValid())
+	{
+		last = doc->lastBlock();
+	}
+	stats.chars = end - start;
+	stats.lines = last.blockNumber() - first.blockNumber() + 1;
+	stats.bytes = stats.lines - 1;
+
+	int words = 0;
+	int bytes = 0;
+	if (first == last)
+	{
+		QString text = first.text();
+		countText(text.constData() + (start - first.position()), end - start, &words, &bytes);
+		stats.words = words;
+		stats.bytes = bytes;
+		return stats;
+	}
+
+	//首尾两行只统计选中的部分，中间的整行由前缀和相减得到
+	QString text = first.text();
+	int offset = start - first.position();
+	countText(text.constData() + offset, text.size() - offset, &words, &bytes);
+	stats.words += words;
+	stats.bytes += bytes;
+	if (ready)
+	{
+		qint64 wordsBefore, bytesBefore, wordsUntil, bytesUntil;
+		prefix(first.blockNumber() + 1, &wordsBefore, &bytesBefore);
+		prefix(last.blockNumber(), &wordsUntil, &bytesUntil);
+		stats.words += wordsUntil - wordsBefore;
+		stats.bytes += bytesUntil - bytesBefore;
+	}
+	else
+	{
+		//统计尚未完成时只能逐行计算
+		for (QTextBlock block = first.next(); block.isValid() && block != last; block = block.next())
+		{
+			QString blockText = block.text();
+			countText(blockText.constData(), blockText.size(), &words, &bytes);
+			stats.words += words;
+			stats.bytes += bytes;
+		}
+	}
+	text = last.text();
+	countText(text.constData(), end - last.position(), &words, &bytes);
+	stats.words += words;
+	stats.bytes += bytes;
+	return stats;
+}
@@ -0,0 +1,91 @@
+﻿#ifndef LINEINDEX_H
+#define LINEINDEX_H
+#include <QObject>
+#include <QVector>
+#include <QFutureWatcher>
+
+class QTextDocument;
+
+//文本统计信息
+struct TextStatistics
+{
+	TextStatistics() : lines(0), words(0), chars(0), bytes(0) {}
+	int lines;          //行数
+	qint64 words;       //单词数，以空白分隔
+	int chars;          //字符数
+	qint64 bytes;       //按UTF-8编码的字节数
+};
+
+//行索引：以行为元素建立一棵隐式treap，每个结点保存这一行和整棵子树的单词数、字节数。
+//修改一行只需更新到根的路径，插入或删除行按行号拆分再合并，代价都是O(log n)，
+//加上重新统计修改范围内各行文本的时间；
+//选区统计只需统计首尾两行的文本，中间的整行由前缀和相减得到，代价为O(log n)
+class LineIndex : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit LineIndex(QTextDocument *document);
+	~LineIndex();
+
+	void invalidate();                          //文档将被整体替换，暂停增量维护
+	bool isReady() const { return ready; }      //统计是否可用
+
+	TextStatistics statistics() const;          //全文统计
+	TextStatistics selectionStatistics(int start, int end) const;  //选区统计
+
+	void blockRemoved(int node);                //文本块被删除时由BlockData调用
+
+	//统计一段文本的单词数和UTF-8字节数
+	static void countText(const QChar *text, int length, int *words, int *bytes);
+
+public slots:
+	void rebuild();                             //在工作线程中重新统计每一行
+
+signals:
+	void statisticsChanged();                   //统计信息发生变化
+
+private slots:
+	void buildFinished();                       //工作线程统计完成
+	void documentChanged(int position, int charsRemoved, int charsAdded);    //文档内容改变
+
+private:
+	struct Node
+	{
+		int left, right, parent;
+		quint32 priority;
+		int size;                               //子树中的行数
+		int words;                              //这一行的单词数
+		int bytes;                              //这一行的UTF-8字节数，不含换行符
+		qint64 totalWords;                      //整棵子树的单词数
+		qint64 totalBytes;                      //整棵子树的字节数
+	};
+	struct BuildResult
+	{
+		QVector<Node> nodes;                    //第i个结点对应第i行
+		int root;
+	};
+	static BuildResult build(const QString &text);
+	static int buildBalanced(QVector<Node> &nodes, int low, int high, int parent);
+	static void heapify(QVector<Node> &nodes, int node);
+
+	int size(int node) const { return node < 0 ? 0 : nodes.at(node).size; }
+	void update(int node);
+	void updatePath(int node);                  //修改结点后更新到根的路径
+	int rank(int node) const;                   //结点对应的行号
+	void split(int tree, int count, int *left, int *right);
+	int merge(int left, int right);
+	quint32 nextPriority();
+	void prefix(int lines, qint64 *words, qint64 *bytes) const;    //前lines行的单词数和字节数之和
+
+	QTextDocument * doc;
+	QVector<Node> nodes;
+	QVector<int> freeNodes;                     //已删除结点的编号，供新行复用
+	int root;
+	quint32 seed;
+	bool ready;
+	int buildRevision;                          //开始统计时的文档版本
+	QFutureWatcher<BuildResult> * watcher;
+};
+
+#endif // LINEINDEX_H
@@ -0,0 +1,196 @@
+﻿#include <algorithm>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+#include "lineoperations.h"
+#include "tracer.h"
+
+namespace
+{
+	//每块至少这么多行才值得分给一个线程
+	const int MinimumChunkSize = 16 * 1024;
+
+	//把n个元素平均分成若干块，返回各块的边界
+	QVector<int> chunkBounds(int n)
+	{
+		int chunks = qBound(1, n / MinimumChunkSize, QThread::idealThreadCount());
+		QVector<int> bounds(chunks + 1);
+		for (int i = 0; i <= chunks; ++i)
+		{
+			bounds[i] = int(qint64(n) * i / chunks);
+		}
+		return bounds;
+	}
+
+	struct NumericLine
+	{
+		double key;
+		QStringRef line;
+	};
+}
+
+template <typename T, typename LessThan>
+void LineOperations::parallelSort(QVector<T> &items, LessThan lessThan)
+{
+	QVector<int> bounds = chunkBounds(items.size());
+	int chunks = bounds.size() - 1;
+	T * data = items.data();
+
+	QVector<int> ids(chunks);
+	for (int i = 0; i < chunks; ++i)
+		ids[i] = i;
+	QtConcurrent::blockingMap(ids, [&](int chunk)
+	{
+		std::stable_sort(data + bounds.at(chunk), data + bounds.at(chunk + 1), lessThan);
+	});
+
+	//每一轮把相邻的两段归并成一段，各对之间互不相干，可以并行
+	for (int width = 1; width < chunks; width *= 2)
+	{
+		QVector<int> pairs;
+		for (int i = 0; i + width < chunks; i += 2 * width)
+			pairs.append(i);
+		QtConcurrent::blockingMap(pairs, [&](int first)
+		{
+			std::inplace_merge(data + bounds.at(first), data + bounds.at(first + width),
+				data + bounds.at(qMin(first + 2 * width, chunks)), lessThan);
+		});
+	}
+}
+
+double LineOperations::numericKey(const QStringRef &line)
+{
+	//与sort -n相同，跳过行首空白后取最长的数值前缀
+	int i = 0;
+	while (i < line.size() && line.at(i).isSpace())
+		++i;
+	int start = i;
+	if (i < line.size() && (line.at(i) == QLatin1Char('-') || line.at(i) == QLatin1Char('+')))
+		++i;
+	bool dot = false;
+	while (i < line.size() && (line.at(i).isDigit() || (!dot && line.at(i) == QLatin1Char('.'))))
+	{
+		if (line.at(i) == QLatin1Char('.'))
+			dot = true;
+		++i;
+	}
+	bool ok = false;
+	double value = line.mid(start, i - start).toDouble(&ok);
+	return ok ? value : 0;
+}
+
+LineOperations::Result LineOperations::apply(const QString &text, Operation operation,
+	const QString &pattern, const SearchEngine::Options &options)
+{
+	TRACE_SCOPE_CATEGORY("LineOperations::apply", "worker");
+	Result result;
+	QElapsedTimer timer;
+	timer.start();
+
+	//末尾的换行符不算作一个空行，处理完再补回去
+	bool trailingNewline = text.endsWith(QLatin1Char('\n'));
+	QStringRef body = text.leftRef(trailingNewline ? text.size() - 1 : text.size());
+
+	//各行只引用原文本，排序和过滤时不复制字符
+	QVector<QStringRef> lines = body.split(QLatin1Char('\n'));
+	result.linesBefore = lines.size();
+
+	switch (operation)
+	{
+	case SortAscending:
+		parallelSort(lines, [](const QStringRef &a, const QStringRef &b) { return a < b; });
+		break;
+	case SortDescending:
+		parallelSort(lines, [](const QStringRef &a, const QStringRef &b) { return b < a; });
+		break;
+	case SortNumeric:
+	{
+		//先并行算出每行的数值，排序时不再重复解析
+		QVector<NumericLine> keyed(lines.size());
+		QVector<int> bounds = chunkBounds(lines.size());
+		QVector<int> ids(bounds.size() - 1);
+		for (int i = 0; i < ids.size(); ++i)
+			ids[i] = i;
+		QtConcurrent::blockingMap(ids, [&](int chunk)
+		{
+			for (int i = bounds.at(chunk); i < bounds.at(chunk + 1); ++i)
+			{
+				keyed[i].key = numericKey(lines.at(i));
+				keyed[i].line = lines.at(i);
+			}
+		});
+		parallelSort(keyed, [](const NumericLine &a, const NumericLine &b) { return a.key < b.key; });
+		for (int i = 0; i < keyed.size(); ++i)
+			lines[i] = keyed.at(i).line;
+		break;
+	}
+	case RemoveDuplicates:
+	{
+		QSet<QStringRef> seen;
+		seen.reserve(lines.size());
+		int kept = 0;
+		for (int i = 0; i < lines.size(); ++i)
+		{
+			if (seen.contains(lines.at(i)))
+				continue;
+			seen.insert(lines.at(i));
+			lines[kept++] = lines.at(i);
+		}
+		lines.resize(kept);
+		break;
+	}
+	case KeepMatching:
+	case RemoveMatching:
+	{
+		QRegularExpression re = SearchEngine::compile(pattern, options);
+		if (pattern.isEmpty() || !re.isValid())
+		{
+			result.error = pattern.isEmpty() ? QString::fromLocal8Bit("没有指定匹配模式") : re.errorString();
+			result.elapsed = timer.elapsed();
+			return result;
+		}
+		//各块并行匹配，每个线程使用自己的正则表达式对象
+		QVector<char> matched(lines.size());
+		QVector<int> bounds = chunkBounds(lines.size());
+		QVector<int> ids(bounds.size() - 1);
+		for (int i = 0; i < ids.size(); ++i)
+			ids[i] = i;
+		QtConcurrent::blockingMap(ids, [&](int chunk)
+		{
+			QRegularExpression local(re.pattern(), re.patternOptions());
+			for (int i = bounds.at(chunk); i < bounds.at(chunk + 1); ++i)
+				matched[i] = local.match(lines.at(i)).hasMatch();
+		});
+		bool keep = (operation == KeepMatching);
+		int kept = 0;
+		for (int i = 0; i < lines.size(); ++i)
+		{
+			if (bool(matched.at(i)) == keep)
+				lines[kept++] = lines.at(i);
+		}
+		lines.resize(kept);
+		break;
+	}
+	case Reverse:
+		std::reverse(lines.begin(), lines.end());
+		break;
+	}
+
+	//一次分配好空间后拼接结果
+	int size = lines.size();
+	for (const QStringRef &line : lines)
+		size += line.size();
+	result.text.reserve(size);
+	for (int i = 0; i < lines.size(); ++i)
+	{
+		if (i > 0)
+			result.text.append(QLatin1Char('\n'));
+		result.text.append(lines.at(i));
+	}
+	if (trailingNewline)
+		result.text.append(QLatin1Char('\n'));
+	result.linesAfter = lines.size();
+	result.elapsed = timer.elapsed();
+	return result;
+}
@@ -0,0 +1,45 @@
+﻿#ifndef LINEOPERATIONS_H
+#define LINEOPERATIONS_H
+#include <QString>
+#include <QVector>
+#include "searchengine.h"
+
+//行操作：排序、去重、按模式过滤和反转，只依赖纯文本，可以在工作线程中运行
+class LineOperations
+{
+public:
+	enum Operation
+	{
+		SortAscending,          //按字符升序排序
+		SortDescending,         //按字符降序排序
+		SortNumeric,            //按行首的数值排序
+		RemoveDuplicates,       //删除重复行，保留第一次出现的行
+		KeepMatching,           //只保留匹配的行
+		RemoveMatching,         //删除匹配的行
+		Reverse                 //反转行的顺序
+	};
+
+	//行操作的结果
+	struct Result
+	{
+		Result() : linesBefore(0), linesAfter(0), elapsed(0) {}
+		QString text;           //处理后的文本
+		int linesBefore;        //处理前的行数
+		int linesAfter;         //处理后的行数
+		qint64 elapsed;         //计算耗时（毫秒）
+		QString error;          //出错信息，为空表示成功
+	};
+
+	//对text中的各行执行operation，过滤时按pattern和options匹配
+	static Result apply(const QString &text, Operation operation,
+		const QString &pattern, const SearchEngine::Options &options);
+
+private:
+	//分块并行排序后逐轮两两归并，整体是稳定排序
+	template <typename T, typename LessThan>
+	static void parallelSort(QVector<T> &items, LessThan lessThan);
+
+	static double numericKey(const QStringRef &line);   //行首的数值，没有数值时为0
+};
+
+#endif // LINEOPERATIONS_H
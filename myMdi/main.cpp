@@ -1,12 +1,114 @@
-#include "mainwindow.h"
+﻿#include "mainwindow.h"
+#include "benchmark.h"
+#include "batchprocessor.h"
+#include "tracer.h"
+#include "singleinstance.h"
 #include <QApplication>
+#include <QFileInfo>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <shellapi.h>
+#endif
+
+//命令行参数。Windows上argv是按ANSI代码页转换过的，代码页之外的文件名已经变成问号，
+//所以改从宽字符的命令行重新拆分
+static QStringList commandLineArguments(int argc, char *argv[])
+{
+    QStringList arguments;
+#ifdef Q_OS_WIN
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+    int count = 0;
+    LPWSTR * wide = CommandLineToArgvW(GetCommandLineW(), &count);
+    if (wide)
+    {
+        for (int i = 0; i < count; ++i)
+            arguments.append(QString::fromWCharArray(wide[i]));
+        LocalFree(wide);
+        return arguments;
+    }
+#endif
+    for (int i = 0; i < argc; ++i)
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    return arguments;
+}
+
+//从命令行中取出要打开的文件，转为绝对路径，正在运行的实例的当前目录可能不同。
+//-platform这类后面带值的选项跳过它的值；基准测试、启动跟踪和--new-instance不使用单实例。
+//没有文件参数时返回空列表，仍然发给正在运行的实例：它收到空列表时只把窗口提到前面，
+//所以再次启动编辑器的效果是激活已有的窗口，进程以0退出。
+//在创建应用程序对象之前读取命令行，与BatchProcessor::requested()相同
+static QStringList filesFromArguments(int argc, char *argv[], bool *singleInstance)
+{
+    static const QStringList optionsWithValue = { "-platform", "-platformpluginpath", "-platformtheme", "-plugin",
+        "-qwindowgeometry", "-qwindowtitle", "-qwindowicon", "-style", "-stylesheet", "-session", "-display",
+        "--benchmark-sizes", "--benchmark-output" };
+    static const QStringList separateInstance = { "--new-instance", "--benchmark", "--startup-trace" };
+    QStringList arguments = commandLineArguments(argc, argv);
+    QStringList files;
+    *singleInstance = true;
+    for (int i = 1; i < arguments.size(); ++i)
+    {
+        const QString &argument = arguments.at(i);
+        if (!argument.startsWith("-"))
+            files.append(QFileInfo(argument).absoluteFilePath());
+        else if (optionsWithValue.contains(argument))
+            ++i;
+        else if (separateInstance.contains(argument))
+            *singleInstance = false;
+    }
+    return files;
+}
 
 int main(int argc, char *argv[])
 {
+    //启动耗时从这里开始计时
+    Tracer::now();
+
+    //命令行批处理模式只创建QCoreApplication，在没有显示器的机器上也能运行
+    if (BatchProcessor::requested(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        BatchProcessor processor(app.arguments());
+        return processor.run();
+    }
+
+    //有实例在运行时把文件交给它打开，这时不加载界面。
+    //QLocalSocket的等待函数要用到套接字通知器，只创建一个代价很小的QCoreApplication
+    bool singleInstance = true;
+    QStringList files = filesFromArguments(argc, argv, &singleInstance);
+    if (singleInstance)
+    {
+        QCoreApplication probe(argc, argv);
+        if (SingleInstance::sendFiles(files))
+            return 0;
+    }
+
     QApplication a(argc, argv);
 
+    //基准测试模式不创建主窗口，输出JSON结果后退出
+    if (Benchmark::requested(a.arguments()))
+    {
+        Benchmark benchmark(a.arguments());
+        return benchmark.run();
+    }
+
+    //--startup-trace记录启动过程的跟踪，并报告第一次绘制和可以交互的时间
+    bool startupTrace = a.arguments().contains("--startup-trace");
+    Tracer::setEnabled(startupTrace);
+
     MainWindow w;
+    w.setStartupTrace(startupTrace);
     w.show();
+    w.openFiles(files);
+
+    //之后启动的进程把文件交给这个窗口打开
+    SingleInstance instance;
+    if (singleInstance)
+    {
+        QObject::connect(&instance, SIGNAL(filesReceived(QStringList)), &w, SLOT(openFiles(QStringList)));
+        instance.listen();
+    }
 
     return a.exec();
 }
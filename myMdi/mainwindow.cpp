@@ -1,45 +1,156 @@
 ﻿#include <QMdiSubWindow>
 #include <QFileDialog>
-#include <QSignalMapper>
 #include <QSettings>
 #include <QCloseEvent>
 #include <QLabel>
+#include <QElapsedTimer>
+#include <QInputDialog>
+#include <QTimer>
+#include <QDir>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QSet>
+#include <QtConcurrent>
 
 #include "mainwindow.h"
+#include "tracer.h"
 #include "mdichild.h"
+#include "findreplacedialog.h"
+#include "trigramindex.h"
+#include "diffview.h"
+#include "mergesession.h"
+#include "wordindex.h"
+#include "spellchecker.h"
+#include "performancedialog.h"
+#include "iconatlas.h"
+#include "mdichildpool.h"
+#include "windowlist.h"
+#include "quickswitcher.h"
+#include "uistateaggregator.h"
+#include "tabrealizer.h"
+#include "windowlayout.h"
 #include "ui_mainwindow.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
+	TRACE_SCOPE_CATEGORY("MainWindow::MainWindow", "startup");
+	//窗口设置在工作线程中读取，与创建界面同时进行
+	QFuture<WindowSettings> settings = QtConcurrent::run(&MainWindow::readSettings);
+
     ui->setupUi(this);
 
-	//设置窗口图标
-	QIcon icon(":/ICON/TextEdit_128px_1130521_easyicon.net.ico");
-	setWindowIcon(icon);
+	//查找替换对话框在第一次使用时创建
+	findDialog = nullptr;
+	performanceDialog = nullptr;
+	watchdog = nullptr;
+	startupTrace = false;
+	firstPaintTime = 0;
+	quickSwitcher = nullptr;
+	recentFilesLoaded = false;
+
+	//单词补全索引由所有子窗口共享，在工作线程中更新
+	wordIndex = new WordIndex(this);
+
+	//光标、选区和活动窗口的变化只做标记，每帧合并更新一次界面状态
+	uiState = new UiStateAggregator(this);
+	connect(uiState, SIGNAL(updateRequested(int)), this, SLOT(updateUiState(int)));
+
+	tabRealizer = new TabRealizer(ui->mdiArea, this);
+	windowLayout = new WindowLayout(ui->mdiArea, this);
+
+	//子窗口池在第一次绘制之后开始补充，池中的子窗口创建时就连接好信号
+	childPool = new MdiChildPool(2, this);
+	connect(childPool, SIGNAL(created(MdiChild *)), this, SLOT(connectMdiChild(MdiChild *)));
 
-	readSettings();				//初始窗口时读取窗口设置信息
 	initWindow();				//初始化窗口
 	
 	//创建间隔器动作并在其中设置间隔器
 	actionSeparator = new QAction(this);
 	actionSeparator->setSeparator(true);
 
-	//创建信号映射器
-	windowMapper = new QSignalMapper(this);
-	//映射器重新发射信号，根据信号设置活动窗口
-	connect(windowMapper, SIGNAL(mapped(QWidget *)), this, SLOT(setActiveSubWindow(QWidget *)));
-
-	//更新窗口菜单，并且设置当窗口菜单将要显示的时候更新窗口菜单
-	updateWindowMenu();
-	connect(ui->menuW, SIGNAL(aboutToShow()), this, SLOT(updateWindowMenu()));
+	//创建窗口菜单，之后窗口列表随子窗口的变化更新
+	initWindowMenu();
 
 	//更新菜单
 	updateMenus();
 
 	//当有活动窗口时更新菜单
-	connect(ui->mdiArea, SIGNAL(subWindowActivated(QMdiSubWindow *)), this, SLOT(updateMenus()));
+	connect(ui->mdiArea, SIGNAL(subWindowActivated(QMdiSubWindow *)), uiState, SLOT(markMenus()));
+	connect(ui->mdiArea, SIGNAL(subWindowActivated(QMdiSubWindow *)), uiState, SLOT(markStatistics()));
+
+	//显示窗口之前必须知道位置和大小
+	WindowSettings windowSettings = settings.result();
+	move(windowSettings.geometry.topLeft());
+	resize(windowSettings.geometry.size());
+	ui->actionTabbedView->setChecked(windowSettings.tabbedView);
+
+	//图标和状态提示在第一次绘制之后再设置，先让窗口显示出来
+	ui->mdiArea->viewport()->installEventFilter(this);
+}
+
+bool MainWindow::eventFilter(QObject * watched, QEvent * event)
+{
+	if (watched == ui->mdiArea->viewport() && event->type() == QEvent::Paint)
+	{
+		//零时间的定时器在这次绘制完成之后才执行
+		ui->mdiArea->viewport()->removeEventFilter(this);
+		QTimer::singleShot(0, this, SLOT(finishStartup()));
+	}
+	return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::finishStartup()
+{
+	firstPaintTime = Tracer::now();
+	TRACE_SCOPE_CATEGORY("MainWindow::finishStartup", "startup");
+	loadIcons();
+	initStatusTips();
+	childPool->refill();
+	//再等事件循环处理完积压的事件，这时才算可以交互
+	if (startupTrace)
+		QTimer::singleShot(0, this, SLOT(reportStartup()));
+}
+
+void MainWindow::reportStartup()
+{
+	qint64 interactiveTime = Tracer::now();
+	QTextStream(stderr) << "time to first paint: " << firstPaintTime / 1000.0 << " ms\n"
+		<< "time to interactive: " << interactiveTime / 1000.0 << " ms\n";
+
+	//启动过程的跟踪和卡顿跟踪保存在同一个目录
+	QString directory = QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("traces");
+	QString fileName = QDir(directory).filePath(
+		QString("startup-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+	if (QDir().mkpath(directory) && Tracer::save(fileName, 0, interactiveTime))
+		QTextStream(stderr) << "startup trace: " << QDir::toNativeSeparators(fileName) << '\n';
+
+	//启动跟踪结束后恢复到菜单中的设置
+	Tracer::setEnabled(ui->actionTrace->isChecked());
+	ui->statusbar->showMessage(QString::fromLocal8Bit("启动耗时：第一次绘制 %1 毫秒，可以交互 %2 毫秒")
+		.arg(firstPaintTime / 1000).arg(interactiveTime / 1000), 5000);
+}
+
+void MainWindow::loadIcons()
+{
+	TRACE_SCOPE_CATEGORY("MainWindow::loadIcons", "startup");
+	setWindowIcon(IconAtlas::icon(IconAtlas::Application));
+	ui->actionNew->setIcon(IconAtlas::icon(IconAtlas::New));
+	ui->actionOpen->setIcon(IconAtlas::icon(IconAtlas::Open));
+	ui->actionSave->setIcon(IconAtlas::icon(IconAtlas::Save));
+	ui->actionSaveAs->setIcon(IconAtlas::icon(IconAtlas::SaveAs));
+	ui->actionExit->setIcon(IconAtlas::icon(IconAtlas::Exit));
+	ui->actionUndo->setIcon(IconAtlas::icon(IconAtlas::Undo));
+	ui->actionRedo->setIcon(IconAtlas::icon(IconAtlas::Redo));
+	ui->actionCut->setIcon(IconAtlas::icon(IconAtlas::Cut));
+	ui->actionCopy->setIcon(IconAtlas::icon(IconAtlas::Copy));
+	ui->actionPaste->setIcon(IconAtlas::icon(IconAtlas::Paste));
+	ui->actionNext->setIcon(IconAtlas::icon(IconAtlas::Next));
+	ui->actionPrevious->setIcon(IconAtlas::icon(IconAtlas::Previous));
+	ui->actionAbout->setIcon(IconAtlas::icon(IconAtlas::About));
+	ui->actionAboutQt->setIcon(IconAtlas::icon(IconAtlas::AboutQt));
 }
 
 MainWindow::~MainWindow()
@@ -51,132 +162,194 @@ void MainWindow::on_actionOpen_triggered()
 {
 	//获取文件路径
 	QString fileName = QFileDialog::getOpenFileName(this);
-	//如果路径不为空，则查看该文件是否已经打开
+	//如果路径不为空，则打开该文件
 	if (!fileName.isEmpty())
 	{
-		QMdiSubWindow *existing = findMdiChild(fileName);
-		//如果已经存在，则将对应的子窗口设置为活动窗口
-		if (existing)
-		{
-			ui->mdiArea->setActiveSubWindow(existing);
-			return;
-		}
-		//如果没有打开，则新建子窗口
-		MdiChild *child = createMdiChild();
-		if (child->loadFile(fileName))
-		{
-			ui->statusbar->showMessage(QString::fromLocal8Bit("打开文件成功"), 2000);
-			child->show();
-		}
-		else
-		{
-			child->close();
-		}
+		openFile(fileName);
+	}
+}
+
+bool MainWindow::openFile(const QString &fileName)
+{
+	TRACE_SCOPE_CATEGORY("MainWindow::openFile", "ui");
+	QMdiSubWindow *existing = findMdiChild(fileName);
+	//如果已经存在，则将对应的子窗口设置为活动窗口
+	if (existing)
+	{
+		ui->mdiArea->setActiveSubWindow(existing);
+		return true;
+	}
+	//如果没有打开，则新建子窗口
+	MdiChild *child = createMdiChild();
+	if (child->loadFile(fileName))
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("打开文件成功"), 2000);
+		child->show();
+		addRecentFile(child->currentFile());
+		return true;
+	}
+	child->close();
+	return false;
+}
+
+void MainWindow::openFiles(const QStringList &fileNames)
+{
+	for (const QString &fileName : fileNames)
+	{
+		openFile(fileName);
 	}
+	//另一个进程转来的请求，把窗口带到前台
+	if (isMinimized())
+		showNormal();
+	raise();
+	activateWindow();
 }
 
 void MainWindow::updateMenus()
 {
+	TRACE_SCOPE_CATEGORY("MainWindow::updateMenus", "ui");
 	//根据是否有活动窗口来设置各个动作是否可用
 	bool hasMdiChild = (activeMdiChild() != 0);
 	ui->actionSave->setEnabled(hasMdiChild);
 	ui->actionSaveAs->setEnabled(hasMdiChild);
 	ui->actionPaste->setEnabled(hasMdiChild);
+	ui->actionFind->setEnabled(hasMdiChild);
+	ui->actionSelectNext->setEnabled(hasMdiChild);
+	ui->actionSelectAllOccurrences->setEnabled(hasMdiChild);
+	ui->menuLines->setEnabled(hasMdiChild);
+	ui->actionMatchBracket->setEnabled(hasMdiChild);
+	ui->actionFold->setEnabled(hasMdiChild);
+	ui->actionUnfold->setEnabled(hasMdiChild);
+	ui->actionUnfoldAll->setEnabled(hasMdiChild);
+	ui->actionComplete->setEnabled(hasMdiChild);
 	ui->actionClose->setEnabled(hasMdiChild);
 	ui->actionCloseAll->setEnabled(hasMdiChild);
 	ui->actionTile->setEnabled(hasMdiChild);
+	ui->actionTileColumns->setEnabled(hasMdiChild);
+	ui->actionMasterStack->setEnabled(hasMdiChild);
 	ui->actionCascade->setEnabled(hasMdiChild);
 	ui->actionNext->setEnabled(hasMdiChild);
 	ui->actionPrevious->setEnabled(hasMdiChild);
+	ui->actionCompare->setEnabled(hasMdiChild);
+	ui->actionNextConflict->setEnabled(activeMergeSession() != nullptr);
+	ui->actionPreviousConflict->setEnabled(activeMergeSession() != nullptr);
 
 	//设置间隔器是否显示
 	actionSeparator->setVisible(hasMdiChild);
 
+	updateClipboardActions();
+	updateUndoActions();
+}
+
+void MainWindow::updateClipboardActions()
+{
 	//有活动窗口具有被选择的文本，剪切复制才可用
-	bool hasSelection = (activeMdiChild() && activeMdiChild()->textCursor().hasSelection());
+	bool hasSelection = (activeMdiChild() && (activeMdiChild()->textCursor().hasSelection()
+		|| activeMdiChild()->hasBlockSelection()));
 	ui->actionCut->setEnabled(hasSelection);
 	ui->actionCopy->setEnabled(hasSelection);
+}
+
+void MainWindow::updateUndoActions()
+{
+	//分块粘贴期间撤销和恢复都不可用，粘贴结束后重新检查
+	MdiChild * child = activeMdiChild();
+	bool canEdit = child && !child->isPasting();
 
 	//有活动窗口且文档有撤销操作时撤销动作可用
-	ui->actionUndo->setEnabled(activeMdiChild() && activeMdiChild()->document()->isUndoAvailable());
+	ui->actionUndo->setEnabled(canEdit && child->document()->isUndoAvailable());
 
 	//有活动窗口且文档有恢复操作时恢复动作可用
-	ui->actionRedo->setEnabled(activeMdiChild() && activeMdiChild()->document()->isRedoAvailable());
+	ui->actionRedo->setEnabled(canEdit && child->document()->isRedoAvailable());
+}
+
+void MainWindow::updateUiState(int parts)
+{
+	//菜单的更新已经包含剪切复制和撤销恢复
+	if (parts & UiStateAggregator::Menus)
+	{
+		updateMenus();
+	}
+	else
+	{
+		if (parts & UiStateAggregator::Clipboard)
+			updateClipboardActions();
+		if (parts & UiStateAggregator::UndoRedo)
+			updateUndoActions();
+	}
+	if (parts & UiStateAggregator::CursorPosition)
+	{
+		showTextRowAndCol();
+	}
+	if (parts & UiStateAggregator::Statistics)
+	{
+		updateStatistics();
+	}
 }
 
 MdiChild * MainWindow::createMdiChild()
 {
-	//创建MdiChild部件
-	MdiChild * child = new MdiChild;
+	//从子窗口池中取出已经创建好并连接了信号的MdiChild部件
+	MdiChild * child = childPool->take();
+	//放入池中之后可能又开启或关闭了搜索索引和拼写检查
+	child->updateSearchIndex();
+	child->updateSpellCheck();
 	//向多文档区域添加子窗口，child为中心部件
-	ui->mdiArea->addSubWindow(child);
-
-	//根据QTextEdit类的是否可以复制信号设置剪切复制动作是否可用
-	connect(child, SIGNAL(copyAvailable(bool)), ui->actionCut, SLOT(setEnabled(bool)));
-	connect(child, SIGNAL(copyAvailable(bool)), ui->actionCopy, SLOT(setEnabled(bool)));
-	//根据QTextDocument类的是否可以撤销恢复信号设置撤销恢复动作是否可用
-	connect(child->document(), SIGNAL(undoAvailable(bool)),ui->actionUndo,SLOT(setEnabled(bool)));
-	connect(child->document(), SIGNAL(redoAvailable(bool)), ui->actionRedo, SLOT(setEnabled(bool)));
-
-	//每当编辑器中的光标位置改变，就重新显示行号和列号
-	connect(child, SIGNAL(cursorPositionChanged()), this, SLOT(showTextRowAndCol()));
-
+	windowList->add(ui->mdiArea->addSubWindow(child));
 	return child;
 }
 
-void MainWindow::setActiveSubWindow(QWidget * window)
+void MainWindow::connectMdiChild(MdiChild * child)
 {
-	//如果传递了窗口部件，则将其设置为活动窗口
-	if (!window)
-	{
-		return;
-	}
-	ui->mdiArea->setActiveSubWindow(qobject_cast<QMdiSubWindow *>(window));
+	//文档内容加入共享的补全索引，文档销毁时自动移出
+	child->setWordIndex(wordIndex);
+	wordIndex->addDocument(child->document());
+
+	//根据QTextEdit类的是否可以复制信号更新剪切复制动作，按活动窗口的状态设置
+	connect(child, SIGNAL(copyAvailable(bool)), uiState, SLOT(markClipboard()));
+	//根据QTextDocument类的是否可以撤销恢复信号更新撤销恢复动作
+	connect(child->document(), SIGNAL(undoAvailable(bool)), uiState, SLOT(markUndoRedo()));
+	connect(child->document(), SIGNAL(redoAvailable(bool)), uiState, SLOT(markUndoRedo()));
+	connect(child, SIGNAL(pastingChanged()), uiState, SLOT(markUndoRedo()));
+
+	//每当编辑器中的光标位置改变，就在下一帧重新显示行号和列号
+	connect(child, SIGNAL(cursorPositionChanged()), uiState, SLOT(markCursorPosition()));
+
+	//全部替换完成后在状态栏显示替换次数和耗时
+	connect(child, SIGNAL(replaceAllFinished(int, qint64)), this, SLOT(showReplaceResult(int, qint64)));
+	connect(child, SIGNAL(replaceAllFailed(QString)), this, SLOT(showReplaceError(QString)));
+	connect(child, SIGNAL(searchIndexReady(qint64)), this, SLOT(showSearchIndexReady(qint64)));
+	connect(child, SIGNAL(linesTransformed(int, int, qint64)), this, SLOT(showLinesTransformed(int, int, qint64)));
+	connect(child, SIGNAL(transformLinesFailed(QString)), this, SLOT(showTransformLinesError(QString)));
+
+	//文档内容或选区改变时更新状态栏中的统计
+	connect(child, SIGNAL(statisticsChanged()), uiState, SLOT(markStatistics()));
+	connect(child, SIGNAL(selectionChanged()), uiState, SLOT(markStatistics()));
 }
 
-void MainWindow::updateWindowMenu()
+void MainWindow::initWindowMenu()
 {
-	//先清空菜单，然后再添加各个菜单动作
+	//固定的菜单动作只添加一次，窗口列表追加在间隔器之后，由WindowList随子窗口增量更新
 	ui->menuW->clear();
 	ui->menuW->addAction(ui->actionClose);
 	ui->menuW->addAction(ui->actionCloseAll);
 	ui->menuW->addSeparator();
 	ui->menuW->addAction(ui->actionTile);
+	ui->menuW->addAction(ui->actionTileColumns);
+	ui->menuW->addAction(ui->actionMasterStack);
 	ui->menuW->addAction(ui->actionCascade);
+	ui->menuW->addAction(ui->actionTabbedView);
 	ui->menuW->addSeparator();
 	ui->menuW->addAction(ui->actionNext);
 	ui->menuW->addAction(ui->actionPrevious);
+	ui->menuW->addAction(ui->actionQuickSwitch);
+	ui->menuW->addSeparator();
+	ui->menuW->addAction(ui->actionCompare);
+	ui->menuW->addAction(ui->actionMerge);
+	ui->menuW->addAction(ui->actionNextConflict);
+	ui->menuW->addAction(ui->actionPreviousConflict);
 	ui->menuW->addAction(actionSeparator);
-
-	//如果有活动窗口，则显示间隔器
-	QList<QMdiSubWindow * >windows = ui->mdiArea->subWindowList();
-	actionSeparator->setVisible(!windows.isEmpty());
-
-	//遍历各个子窗口
-	for (int i = 0; i < windows.size(); ++i)
-	{
-		MdiChild *child = qobject_cast<MdiChild *>(windows.at(i)->widget());
-		QString text;
-		//如果窗口数小于9，则设置编号为快捷键
-		if (i<9)
-		{
-			text = QString::fromLocal8Bit("&%1 %2").arg(i + 1).arg(child->userFriendlyCurrentFile());
-		}
-		else
-		{
-			text = QString::fromLocal8Bit("%1 %2").arg(i + 1).arg(child->userFriendlyCurrentFile());
-		}
-		//添加动作到菜单，设置动作可以选择
-		QAction *action = ui->menuW->addAction(text);
-		action->setCheckable(true);
-		//设置当前活动窗口动作为选中状态
-		action->setChecked(child == activeMdiChild());
-		//关联动作的触发信号到信号映射器的map()槽，这个槽会发射mapped（）信号
-		connect(action, SIGNAL(triggered()), windowMapper, SLOT(map()));
-		//将动作与相应的窗口部件进行映射，
-		//在发射mapped（）信号时就会以这个窗口部件为参数
-		windowMapper->setMapping(action, windows.at(i));
-	}
+	windowList = new WindowList(ui->mdiArea, ui->menuW, this);
 }
 
 MdiChild * MainWindow::activeMdiChild()
@@ -213,7 +386,7 @@ QMdiSubWindow * MainWindow::findMdiChild(const QString & fileName)
 	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
 	{
 		MdiChild *mdiChild = qobject_cast<MdiChild *>(window->widget());
-		if (mdiChild->currentFile() == canonicalFilePath)
+		if (mdiChild && mdiChild->currentFile() == canonicalFilePath)
 		{
 			return window;
 		}
@@ -246,6 +419,7 @@ void MainWindow::on_actionSaveAs_triggered()
 	if (activeMdiChild() && activeMdiChild()->saveAs())
 	{
 		ui->statusbar->showMessage(QString::fromLocal8Bit("文件另存成功"), 2000);
+		addRecentFile(activeMdiChild()->currentFile());
 	}
 }
 
@@ -266,12 +440,23 @@ void MainWindow::on_actionRedo_triggered()
 
 void MainWindow::on_actionCut_triggered()
 {
-	if (activeMdiChild()) activeMdiChild()->cut();
+	//列选区按矩形形状剪切
+	MdiChild * child = activeMdiChild();
+	if (!child) return;
+	if (child->hasBlockSelection())
+		child->cutBlock();
+	else
+		child->cut();
 }
 
 void MainWindow::on_actionCopy_triggered()
 {
-	if (activeMdiChild()) activeMdiChild()->copy();
+	MdiChild * child = activeMdiChild();
+	if (!child) return;
+	if (child->hasBlockSelection())
+		child->copyBlock();
+	else
+		child->copy();
 }
 
 void MainWindow::on_actionPaste_triggered()
@@ -279,6 +464,332 @@ void MainWindow::on_actionPaste_triggered()
 	if (activeMdiChild()) activeMdiChild()->paste();
 }
 
+void MainWindow::on_actionSelectNext_triggered()
+{
+	if (activeMdiChild()) activeMdiChild()->selectNextOccurrence();
+}
+
+void MainWindow::on_actionMatchBracket_triggered()
+{
+	if (activeMdiChild() && !activeMdiChild()->gotoMatchingBracket())
+		ui->statusbar->showMessage(QString::fromLocal8Bit("光标处没有可匹配的括号"), 2000);
+}
+
+void MainWindow::on_actionFold_triggered()
+{
+	if (activeMdiChild()) activeMdiChild()->foldAtCursor();
+}
+
+void MainWindow::on_actionUnfold_triggered()
+{
+	if (activeMdiChild()) activeMdiChild()->unfoldAtCursor();
+}
+
+void MainWindow::on_actionUnfoldAll_triggered()
+{
+	if (activeMdiChild()) activeMdiChild()->unfoldAll();
+}
+
+void MainWindow::on_actionComplete_triggered()
+{
+	if (activeMdiChild() && !activeMdiChild()->completeWord())
+		ui->statusbar->showMessage(QString::fromLocal8Bit("没有可补全的单词"), 2000);
+}
+
+void MainWindow::on_actionSelectAllOccurrences_triggered()
+{
+	if (activeMdiChild())
+	{
+		activeMdiChild()->selectAllOccurrences();
+		ui->statusbar->showMessage(QString::fromLocal8Bit("%1个光标").arg(activeMdiChild()->cursorCount()), 2000);
+	}
+}
+
+void MainWindow::on_actionSortAscending_triggered()
+{
+	transformLines(LineOperations::SortAscending);
+}
+
+void MainWindow::on_actionSortDescending_triggered()
+{
+	transformLines(LineOperations::SortDescending);
+}
+
+void MainWindow::on_actionSortNumeric_triggered()
+{
+	transformLines(LineOperations::SortNumeric);
+}
+
+void MainWindow::on_actionReverseLines_triggered()
+{
+	transformLines(LineOperations::Reverse);
+}
+
+void MainWindow::on_actionRemoveDuplicates_triggered()
+{
+	transformLines(LineOperations::RemoveDuplicates);
+}
+
+void MainWindow::on_actionKeepMatching_triggered()
+{
+	transformLines(LineOperations::KeepMatching);
+}
+
+void MainWindow::on_actionRemoveMatching_triggered()
+{
+	transformLines(LineOperations::RemoveMatching);
+}
+
+void MainWindow::transformLines(LineOperations::Operation operation)
+{
+	MdiChild * child = activeMdiChild();
+	if (!child)
+	{
+		return;
+	}
+
+	//过滤行时先输入正则表达式
+	QString pattern;
+	SearchEngine::Options options;
+	if (operation == LineOperations::KeepMatching || operation == LineOperations::RemoveMatching)
+	{
+		bool ok = false;
+		pattern = QInputDialog::getText(this, QString::fromLocal8Bit("过滤行"),
+			QString::fromLocal8Bit("正则表达式："), QLineEdit::Normal, QString(), &ok);
+		if (!ok || pattern.isEmpty())
+		{
+			return;
+		}
+		options.useRegex = true;
+	}
+	ui->statusbar->showMessage(QString::fromLocal8Bit("正在处理..."));
+	child->transformLines(operation, pattern, options);
+}
+
+void MainWindow::showLinesTransformed(int linesBefore, int linesAfter, qint64 elapsed)
+{
+	ui->statusbar->showMessage(QString::fromLocal8Bit("处理了%1行，剩余%2行，耗时%3毫秒")
+		.arg(linesBefore).arg(linesAfter).arg(elapsed));
+}
+
+void MainWindow::showTransformLinesError(const QString &reason)
+{
+	ui->statusbar->showMessage(QString::fromLocal8Bit("行操作失败：%1").arg(reason), 5000);
+}
+
+void MainWindow::on_actionFind_triggered()
+{
+	if (!findDialog)
+	{
+		findDialog = new FindReplaceDialog(this);
+		connect(findDialog, SIGNAL(findNextRequested()), this, SLOT(findNext()));
+		connect(findDialog, SIGNAL(replaceAllRequested()), this, SLOT(replaceAll()));
+		connect(findDialog, SIGNAL(countAllRequested()), this, SLOT(countInAllDocuments()));
+	}
+	findDialog->show();
+	findDialog->raise();
+	findDialog->activateWindow();
+}
+
+void MainWindow::findNext()
+{
+	if (activeMdiChild() && !activeMdiChild()->findNext(findDialog->findText(), findDialog->options()))
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("找不到“%1”").arg(findDialog->findText()), 2000);
+	}
+}
+
+void MainWindow::replaceAll()
+{
+	if (activeMdiChild())
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("正在替换..."));
+		activeMdiChild()->replaceAll(findDialog->findText(), findDialog->replaceText(), findDialog->options());
+	}
+}
+
+void MainWindow::showReplaceResult(int count, qint64 elapsed)
+{
+	ui->statusbar->showMessage(QString::fromLocal8Bit("替换了%1处，耗时%2毫秒").arg(count).arg(elapsed));
+}
+
+void MainWindow::showReplaceError(const QString &reason)
+{
+	ui->statusbar->showMessage(QString::fromLocal8Bit("全部替换失败：%1").arg(reason), 5000);
+}
+
+void MainWindow::countInAllDocuments()
+{
+	//同一组文档会被反复查找，已建立索引的文档只需验证候选块
+	QElapsedTimer timer;
+	timer.start();
+	int total = 0;
+	int documents = 0;
+	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
+	{
+		MdiChild *child = qobject_cast<MdiChild *>(window->widget());
+		if (!child)
+		{
+			continue;
+		}
+		int count = child->countMatches(findDialog->findText(), findDialog->options());
+		total += count;
+		if (count > 0)
+		{
+			++documents;
+		}
+	}
+	ui->statusbar->showMessage(QString::fromLocal8Bit("在%1个文档中共找到%2处，耗时%3毫秒").arg(documents).arg(total).arg(timer.elapsed()));
+}
+
+void MainWindow::showSearchIndexReady(qint64 bytes)
+{
+	MdiChild *child = qobject_cast<MdiChild *>(sender());
+	if (child)
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("%1的搜索索引已建立，占用内存%2 KB").arg(child->userFriendlyCurrentFile()).arg(bytes / 1024), 5000);
+	}
+}
+
+void MainWindow::on_actionSearchIndex_toggled(bool checked)
+{
+	TrigramIndex::setEnabled(checked);
+	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
+	{
+		if (MdiChild *child = qobject_cast<MdiChild *>(window->widget()))
+		{
+			child->updateSearchIndex();
+		}
+	}
+}
+
+void MainWindow::on_actionSpellCheck_toggled(bool checked)
+{
+	//第一次启用时加载词典，默认使用程序目录下的词典，找不到时让用户选择
+	if (checked && !SpellChecker::dictionary())
+	{
+		QSettings settings("BruceChe", "myMdi");
+		QString fileName = settings.value("dictionary",
+			QCoreApplication::applicationDirPath() + "/dictionaries/en_US.dic").toString();
+		if (!QFileInfo::exists(fileName))
+		{
+			fileName = QFileDialog::getOpenFileName(this, QString::fromLocal8Bit("选择拼写词典"), QString(),
+				QString::fromLocal8Bit("词典 (*.dic *.txt);;所有文件 (*)"));
+		}
+		QSharedPointer<Dictionary> dictionary(new Dictionary);
+		QString error;
+		if (fileName.isEmpty() || !dictionary->load(fileName, &error))
+		{
+			if (!fileName.isEmpty())
+				QMessageBox::warning(this, QString::fromLocal8Bit("拼写检查"),
+					QString::fromLocal8Bit("无法加载词典%1：%2").arg(fileName, error));
+			ui->actionSpellCheck->setChecked(false);
+			return;
+		}
+		settings.setValue("dictionary", fileName);
+		SpellChecker::setDictionary(dictionary);
+		ui->statusbar->showMessage(QString::fromLocal8Bit("已加载词典，共%1个单词").arg(dictionary->size()), 2000);
+	}
+
+	SpellChecker::setEnabled(checked);
+	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
+	{
+		if (MdiChild *child = qobject_cast<MdiChild *>(window->widget()))
+		{
+			child->updateSpellCheck();
+		}
+	}
+}
+
+void MainWindow::on_actionMeasureLatency_toggled(bool checked)
+{
+	LatencyHistogram::setEnabled(checked);
+}
+
+void MainWindow::on_actionPerformance_triggered()
+{
+	if (!performanceDialog)
+	{
+		performanceDialog = new PerformanceDialog(this);
+		connect(performanceDialog, SIGNAL(refreshRequested()), this, SLOT(updatePerformance()));
+		connect(performanceDialog, SIGNAL(clearRequested()), this, SLOT(clearPerformance()));
+	}
+	if (!LatencyHistogram::isEnabled())
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("输入延迟测量未开启，请先选择“工具 > 测量输入延迟”"), 3000);
+	}
+	updatePerformance();
+	performanceDialog->show();
+	performanceDialog->raise();
+	performanceDialog->activateWindow();
+}
+
+void MainWindow::updatePerformance()
+{
+	QList<PerformanceDialog::Row> rows;
+	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
+	{
+		if (MdiChild *child = qobject_cast<MdiChild *>(window->widget()))
+		{
+			PerformanceDialog::Row row;
+			row.document = child->userFriendlyCurrentFile();
+			row.latency = child->keyLatency();
+			rows.append(row);
+		}
+	}
+	performanceDialog->setRows(rows);
+	performanceDialog->setUiUpdateSummary(uiState->summary());
+}
+
+void MainWindow::clearPerformance()
+{
+	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
+	{
+		if (MdiChild *child = qobject_cast<MdiChild *>(window->widget()))
+		{
+			child->clearKeyLatency();
+		}
+	}
+	uiState->clearCounts();
+	updatePerformance();
+}
+
+void MainWindow::on_actionTrace_toggled(bool checked)
+{
+	Tracer::setEnabled(checked);
+	//记录跟踪时同时监视界面线程，阻塞超过200毫秒就自动保存一份跟踪
+	if (checked && !watchdog)
+	{
+		watchdog = new StallWatchdog(200, this);
+		connect(watchdog, SIGNAL(stallRecorded(QString, qint64)), this, SLOT(showStallRecorded(QString, qint64)));
+		watchdog->start(QThread::LowPriority);
+	}
+	else if (!checked && watchdog)
+	{
+		delete watchdog;
+		watchdog = nullptr;
+	}
+}
+
+void MainWindow::on_actionSaveTrace_triggered()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, QString::fromLocal8Bit("保存跟踪"), "trace.json",
+		QString::fromLocal8Bit("Chrome跟踪文件 (*.json)"));
+	if (fileName.isEmpty())
+	{
+		return;
+	}
+	if (Tracer::save(fileName))
+		ui->statusbar->showMessage(QString::fromLocal8Bit("跟踪已保存，可以在Perfetto或chrome://tracing中打开"), 3000);
+	else
+		QMessageBox::warning(this, QString::fromLocal8Bit("保存跟踪"), QString::fromLocal8Bit("无法写入文件%1").arg(fileName));
+}
+
+void MainWindow::showStallRecorded(const QString &fileName, qint64 milliseconds)
+{
+	ui->statusbar->showMessage(QString::fromLocal8Bit("界面卡顿%1毫秒，跟踪已保存到%2").arg(milliseconds).arg(fileName), 5000);
+}
+
 void MainWindow::on_actionClose_triggered()
 {
 	ui->mdiArea->closeActiveSubWindow();
@@ -291,12 +802,80 @@ void MainWindow::on_actionCloseAll_triggered()
 
 void MainWindow::on_actionTile_triggered()
 {
-	ui->mdiArea->tileSubWindows();
+	//平铺和层叠只在窗口模式下有意义
+	ui->actionTabbedView->setChecked(false);
+	windowLayout->arrange(WindowLayout::Grid);
+}
+
+void MainWindow::on_actionTileColumns_triggered()
+{
+	ui->actionTabbedView->setChecked(false);
+	windowLayout->arrange(WindowLayout::Columns);
+}
+
+void MainWindow::on_actionMasterStack_triggered()
+{
+	ui->actionTabbedView->setChecked(false);
+	windowLayout->arrange(WindowLayout::MasterStack);
 }
 
 void MainWindow::on_actionCascade_triggered()
 {
-	ui->mdiArea->cascadeSubWindows();
+	ui->actionTabbedView->setChecked(false);
+	windowLayout->arrange(WindowLayout::Cascade);
+}
+
+void MainWindow::on_actionTabbedView_toggled(bool checked)
+{
+	TRACE_SCOPE_CATEGORY("MainWindow::on_actionTabbedView_toggled", "ui");
+	if (checked)
+	{
+		ui->mdiArea->setViewMode(QMdiArea::TabbedView);
+		ui->mdiArea->setDocumentMode(true);
+		ui->mdiArea->setTabsClosable(true);
+		ui->mdiArea->setTabsMovable(true);
+	}
+	else
+	{
+		ui->mdiArea->setViewMode(QMdiArea::SubWindowView);
+	}
+	//窗口模式下所有子窗口都可见，全部唤醒
+	tabRealizer->setEnabled(checked);
+}
+
+void MainWindow::on_actionQuickSwitch_triggered()
+{
+	//第一次使用时创建快速切换窗口，选中的窗口通过setActiveSubWindow激活
+	if (!quickSwitcher)
+	{
+		quickSwitcher = new QuickSwitcher(this);
+		connect(quickSwitcher, SIGNAL(windowSelected(QMdiSubWindow *)), ui->mdiArea, SLOT(setActiveSubWindow(QMdiSubWindow *)));
+		connect(quickSwitcher, SIGNAL(fileSelected(QString)), this, SLOT(openFile(QString)));
+	}
+
+	//最近使用的窗口排在前面，已经打开的文件不再作为最近的文件列出
+	quickSwitcher->clear();
+	QList<QMdiSubWindow *> windows = ui->mdiArea->subWindowList(QMdiArea::ActivationHistoryOrder);
+	QSet<QString> openFiles;
+	for (int i = windows.size() - 1; i >= 0; --i)
+	{
+		QMdiSubWindow * window = windows.at(i);
+		if (MdiChild *child = qobject_cast<MdiChild *>(window->widget()))
+		{
+			quickSwitcher->addWindow(window, child->userFriendlyCurrentFile(), child->currentFile());
+			openFiles.insert(child->currentFile());
+		}
+		else
+		{
+			quickSwitcher->addWindow(window, window->widget()->windowTitle(), QString());
+		}
+	}
+	for (const QString &fileName : recentFileList())
+	{
+		if (!openFiles.contains(fileName))
+			quickSwitcher->addFile(fileName);
+	}
+	quickSwitcher->popup();
 }
 
 void MainWindow::on_actionNext_triggered()
@@ -309,6 +888,145 @@ void MainWindow::on_actionPrevious_triggered()
 	ui->mdiArea->activatePreviousSubWindow();
 }
 
+void MainWindow::on_actionCompare_triggered()
+{
+	MdiChild * current = activeMdiChild();
+	if (!current)
+	{
+		return;
+	}
+	QList<MdiChild *> others;
+	QStringList names;
+	foreach(QMdiSubWindow * window, ui->mdiArea->subWindowList())
+	{
+		MdiChild *child = qobject_cast<MdiChild *>(window->widget());
+		if (child && child != current)
+		{
+			others.append(child);
+			names.append(QString::fromLocal8Bit("%1 %2").arg(others.size()).arg(child->userFriendlyCurrentFile()));
+		}
+	}
+	if (others.isEmpty())
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("需要再打开一个文档才能比较"), 2000);
+		return;
+	}
+
+	//只有两个文档时直接比较，否则选择另一个文档
+	MdiChild * other = others.first();
+	if (others.size() > 1)
+	{
+		bool ok = false;
+		QString name = QInputDialog::getItem(this, QString::fromLocal8Bit("比较"),
+			QString::fromLocal8Bit("将%1与：").arg(current->userFriendlyCurrentFile()), names, 0, false, &ok);
+		if (!ok)
+		{
+			return;
+		}
+		other = others.at(names.indexOf(name));
+	}
+
+	//文本快照在界面线程中取出，比较在工作线程中进行
+	DiffView * view = new DiffView;
+	windowList->add(ui->mdiArea->addSubWindow(view));
+	view->compare(current->userFriendlyCurrentFile(), current->toPlainText(),
+		other->userFriendlyCurrentFile(), other->toPlainText());
+	view->show();
+}
+
+void MainWindow::on_actionMerge_triggered()
+{
+	//依次选择基础版本、我方版本和对方版本
+	const char * titles[] = { "选择基础版本", "选择我方版本", "选择对方版本" };
+	QStringList fileNames;
+	for (const char * title : titles)
+	{
+		QString fileName = QFileDialog::getOpenFileName(this, QString::fromLocal8Bit(title));
+		if (fileName.isEmpty())
+		{
+			return;
+		}
+		fileNames.append(fileName);
+	}
+
+	//三个版本以只读方式打开，即使已经打开过也单独打开一份
+	QList<MdiChild *> children;
+	foreach(const QString &fileName, fileNames)
+	{
+		MdiChild *child = createMdiChild();
+		if (!child->loadFile(fileName))
+		{
+			child->close();
+			foreach(MdiChild *opened, children)
+			{
+				opened->close();
+			}
+			return;
+		}
+		child->setReadOnly(true);
+		child->show();
+		children.append(child);
+	}
+
+	ui->statusbar->showMessage(QString::fromLocal8Bit("正在合并..."));
+	MergeSession * session = new MergeSession(this);
+	connect(session, SIGNAL(mergeReady()), this, SLOT(showMergeResult()));
+	session->start(children.at(0), children.at(1), children.at(2));
+}
+
+void MainWindow::showMergeResult()
+{
+	MergeSession * session = qobject_cast<MergeSession *>(sender());
+	if (!session)
+	{
+		return;
+	}
+	//合并结果放在新文档中，保存时走普通的另存为流程
+	MdiChild *merged = createMdiChild();
+	merged->newFile();
+	session->setMergedView(merged);
+	merged->show();
+	ui->actionTabbedView->setChecked(false);
+	windowLayout->arrange(WindowLayout::Grid);
+	ui->statusbar->showMessage(QString::fromLocal8Bit("合并完成，%1个冲突，耗时%2毫秒")
+		.arg(session->conflictCount()).arg(session->elapsed()));
+}
+
+MergeSession * MainWindow::activeMergeSession()
+{
+	QMdiSubWindow * window = ui->mdiArea->activeSubWindow();
+	if (!window)
+	{
+		return nullptr;
+	}
+	foreach(MergeSession *session, findChildren<MergeSession *>())
+	{
+		if (session->contains(window->widget()))
+		{
+			return session;
+		}
+	}
+	return nullptr;
+}
+
+void MainWindow::on_actionNextConflict_triggered()
+{
+	MergeSession * session = activeMergeSession();
+	if (session && !session->nextConflict())
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("后面没有冲突了"), 2000);
+	}
+}
+
+void MainWindow::on_actionPreviousConflict_triggered()
+{
+	MergeSession * session = activeMergeSession();
+	if (session && !session->previousConflict())
+	{
+		ui->statusbar->showMessage(QString::fromLocal8Bit("前面没有冲突了"), 2000);
+	}
+}
+
 void MainWindow::on_actionAbout_triggered()
 {
 	QMessageBox::about(this, QString::fromLocal8Bit("关于本软件"), QString::fromLocal8Bit("欢迎大家加我的qq：1527728647，一起来交流"));
@@ -344,16 +1062,53 @@ void MainWindow::writeSettings()
 	//写入位置信息和大小信息
 	settings.setValue("pos", pos());
 	settings.setValue("size", size());
+	settings.setValue("tabbedView", ui->actionTabbedView->isChecked());
+	//没有读取过就没有变化
+	if (recentFilesLoaded)
+	{
+		settings.setValue("recentFiles", recentFiles);
+	}
+}
+
+const QStringList & MainWindow::recentFileList()
+{
+	if (!recentFilesLoaded)
+	{
+		//启动时不读取，新记录的文件排在设置中的文件前面
+		QStringList added = recentFiles;
+		recentFiles = QSettings("BruceChe", "myMdi").value("recentFiles").toStringList();
+		for (int i = added.size() - 1; i >= 0; --i)
+		{
+			recentFiles.removeAll(added.at(i));
+			recentFiles.prepend(added.at(i));
+		}
+		recentFilesLoaded = true;
+	}
+	return recentFiles;
 }
 
-//读取窗口设置
-void MainWindow::readSettings()
+void MainWindow::addRecentFile(const QString &fileName)
 {
+	const int MaxRecentFiles = 50;
+	recentFiles.removeAll(fileName);
+	recentFiles.prepend(fileName);
+	while (recentFiles.size() > MaxRecentFiles)
+	{
+		recentFiles.removeLast();
+	}
+}
+
+//读取窗口设置，返回窗口的位置、大小和显示模式
+MainWindow::WindowSettings MainWindow::readSettings()
+{
+	TRACE_SCOPE_CATEGORY("MainWindow::readSettings", "startup");
 	QSettings settings("BruceChe", "myMdi");
+	WindowSettings result;
 	QPoint pos = settings.value("pos", QPoint(200, 200)).toPoint();
 	QSize size = settings.value("size", QSize(400, 400)).toSize();
-	move(pos);
-	resize(size);
+	result.geometry = QRect(pos, size);
+	result.tabbedView = settings.value("tabbedView", false).toBool();
+	return result;
 }
 
 void MainWindow::showTextRowAndCol()
@@ -369,6 +1124,26 @@ void MainWindow::showTextRowAndCol()
 	}
 }
 
+void MainWindow::updateStatistics()
+{
+	MdiChild *child = activeMdiChild();
+	if (!child)
+	{
+		statisticsLabel->clear();
+		return;
+	}
+
+	//全文统计直接取行索引维护的结果，选区统计只遍历选中的行
+	TextStatistics stats = child->statistics();
+	QString text = QString::fromLocal8Bit("%1行 %2词 %3字符 %4字节").arg(stats.lines).arg(stats.words).arg(stats.chars).arg(stats.bytes);
+	if (child->textCursor().hasSelection())
+	{
+		TextStatistics selected = child->selectionStatistics();
+		text = QString::fromLocal8Bit("选中%1行 %2词 %3字符 %4字节 | ").arg(selected.lines).arg(selected.words).arg(selected.chars).arg(selected.bytes) + text;
+	}
+	statisticsLabel->setText(text);
+}
+
 void MainWindow::initWindow() // 初始化窗口
 {
 	setWindowTitle(QString::fromLocal8Bit("多文档编辑器"));
@@ -382,13 +1157,21 @@ void MainWindow::initWindow() // 初始化窗口
 
 	ui->statusbar->showMessage(QString::fromLocal8Bit("欢迎使用多文档编辑器"));
 
+	// 文档统计显示在行号列号信息的右侧
+	statisticsLabel = new QLabel(this);
+	ui->statusbar->addPermanentWidget(statisticsLabel);
+
 	QLabel *label = new QLabel(this);
 	label->setFrameStyle(QFrame::Box | QFrame::Sunken);
 	label->setText(QString::fromLocal8Bit("<a href=\"http://www.hexindianzi.com/\">www.hexindianzi.com</a>"));
 	label->setTextFormat(Qt::RichText); // 标签文本为富文本
 	label->setOpenExternalLinks(true);  // 可以打开外部链接
 	ui->statusbar->addPermanentWidget(label);
+}
 
+void MainWindow::initStatusTips()
+{
+	TRACE_SCOPE_CATEGORY("MainWindow::initStatusTips", "startup");
 	/**************其他动作的状态提示**************************/
 	ui->actionNew->setStatusTip(QString::fromLocal8Bit("创建一个文件"));
 	ui->actionOpen->setStatusTip(QString::fromLocal8Bit("打开一个已经存在的文件"));
@@ -400,12 +1183,41 @@ void MainWindow::initWindow() // 初始化窗口
 	ui->actionCut->setStatusTip(QString::fromLocal8Bit("剪切选中的内容到剪贴板"));
 	ui->actionCopy->setStatusTip(QString::fromLocal8Bit("复制选中的内容到剪贴板"));
 	ui->actionPaste->setStatusTip(QString::fromLocal8Bit("粘贴剪贴板的内容到当前位置"));
+	ui->actionFind->setStatusTip(QString::fromLocal8Bit("查找或替换文本，支持正则表达式"));
+	ui->actionSelectNext->setStatusTip(QString::fromLocal8Bit("选中下一处相同的文本并添加一个光标，Ctrl+单击也可以添加光标"));
+	ui->actionSelectAllOccurrences->setStatusTip(QString::fromLocal8Bit("为所有相同的文本各添加一个光标，按Esc退出多光标"));
+	ui->actionMatchBracket->setStatusTip(QString::fromLocal8Bit("光标移到与光标处括号匹配的括号"));
+	ui->actionFold->setStatusTip(QString::fromLocal8Bit("折叠从光标所在行的左括号到匹配右括号之间的行"));
+	ui->actionUnfold->setStatusTip(QString::fromLocal8Bit("展开光标所在行的折叠"));
+	ui->actionUnfoldAll->setStatusTip(QString::fromLocal8Bit("展开文档中的全部折叠"));
+	ui->actionSpellCheck->setStatusTip(QString::fromLocal8Bit("在后台检查拼写，拼错的单词下显示波浪线"));
+	ui->actionMeasureLatency->setStatusTip(QString::fromLocal8Bit("记录每次按键到画面更新的延迟，关闭时没有额外开销"));
+	ui->actionPerformance->setStatusTip(QString::fromLocal8Bit("查看和导出各文档的输入延迟统计"));
+	ui->actionTrace->setStatusTip(QString::fromLocal8Bit("记录耗时操作的跟踪，界面卡顿时自动保存"));
+	ui->actionSaveTrace->setStatusTip(QString::fromLocal8Bit("把记录的跟踪保存为Chrome Trace格式的JSON文件"));
+	ui->actionComplete->setStatusTip(QString::fromLocal8Bit("根据所有打开的文档中出现过的单词补全光标前的单词"));
+	ui->actionCompare->setStatusTip(QString::fromLocal8Bit("将当前文档与另一个文档并排比较"));
+	ui->actionMerge->setStatusTip(QString::fromLocal8Bit("选择基础、我方和对方版本进行三方合并"));
+	ui->actionNextConflict->setStatusTip(QString::fromLocal8Bit("跳到合并结果中的下一个冲突"));
+	ui->actionPreviousConflict->setStatusTip(QString::fromLocal8Bit("跳到合并结果中的上一个冲突"));
+	ui->actionSortAscending->setStatusTip(QString::fromLocal8Bit("将选中的行（没有选中时为全文）按升序排序"));
+	ui->actionSortDescending->setStatusTip(QString::fromLocal8Bit("将选中的行（没有选中时为全文）按降序排序"));
+	ui->actionSortNumeric->setStatusTip(QString::fromLocal8Bit("按行首的数值排序"));
+	ui->actionReverseLines->setStatusTip(QString::fromLocal8Bit("反转行的顺序"));
+	ui->actionRemoveDuplicates->setStatusTip(QString::fromLocal8Bit("删除重复的行，保留第一次出现的行"));
+	ui->actionKeepMatching->setStatusTip(QString::fromLocal8Bit("只保留匹配正则表达式的行"));
+	ui->actionRemoveMatching->setStatusTip(QString::fromLocal8Bit("删除匹配正则表达式的行"));
+	ui->actionSearchIndex->setStatusTip(QString::fromLocal8Bit("为大文档建立三元组索引，加快反复查找"));
 	ui->actionClose->setStatusTip(QString::fromLocal8Bit("关闭活动窗口"));
 	ui->actionCloseAll->setStatusTip(QString::fromLocal8Bit("关闭所有窗口"));
 	ui->actionTile->setStatusTip(QString::fromLocal8Bit("平铺所有窗口"));
+	ui->actionTileColumns->setStatusTip(QString::fromLocal8Bit("把所有窗口并排成列"));
+	ui->actionMasterStack->setStatusTip(QString::fromLocal8Bit("活动窗口占左半边，其余窗口在右侧上下排列"));
 	ui->actionCascade->setStatusTip(QString::fromLocal8Bit("层叠所有窗口"));
+	ui->actionTabbedView->setStatusTip(QString::fromLocal8Bit("以标签页显示文档，只有最近使用的几个标签保持完整的编辑器"));
 	ui->actionNext->setStatusTip(QString::fromLocal8Bit("将焦点移动到下一个窗口"));
 	ui->actionPrevious->setStatusTip(QString::fromLocal8Bit("将焦点移动到前一个窗口"));
+	ui->actionQuickSwitch->setStatusTip(QString::fromLocal8Bit("按文件名或路径模糊查找打开的窗口和最近的文件"));
 	ui->actionAbout->setStatusTip(QString::fromLocal8Bit("显示本软件的介绍"));
 	ui->actionAboutQt->setStatusTip(QString::fromLocal8Bit("显示Qt的介绍"));
 
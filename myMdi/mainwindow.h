@@ -2,11 +2,23 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include "lineoperations.h"
 
 
 class MdiChild;
 class QMdiSubWindow;
-class QSignalMapper;
+class WindowList;
+class FindReplaceDialog;
+class QLabel;
+class MergeSession;
+class WordIndex;
+class PerformanceDialog;
+class StallWatchdog;
+class MdiChildPool;
+class QuickSwitcher;
+class UiStateAggregator;
+class TabRealizer;
+class WindowLayout;
 
 namespace Ui {
 class MainWindow;
@@ -20,13 +32,19 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+	void setStartupTrace(bool enabled) { startupTrace = enabled; }	//可以交互时报告启动耗时
+
+public slots:
+	bool openFile(const QString &fileName);	//打开文件，已经打开时激活对应的子窗口
+	void openFiles(const QStringList &fileNames);	//打开多个文件并激活主窗口，命令行和其他进程使用
+
 private slots:
     void on_actionNew_triggered();
 	void on_actionOpen_triggered();
 	void updateMenus();				//更新菜单
+	void updateUiState(int parts);	//按合并后的标记更新界面状态
 	MdiChild * createMdiChild();	//创建子窗口
-	void setActiveSubWindow(QWidget * window);	//设置活动子窗口
-	void updateWindowMenu();		//更新窗口菜单
+	void connectMdiChild(MdiChild * child);	//连接子窗口的信号
 
 	////////////////////菜单功能/////////////////////////////////////////
     void on_actionSave_triggered();			//保存
@@ -39,33 +57,108 @@ private slots:
 	void on_actionCut_triggered();			//剪切
 	void on_actionCopy_triggered();			//复制
 	void on_actionPaste_triggered();		//粘贴
+	void on_actionFind_triggered();			//查找替换
+	void on_actionSearchIndex_toggled(bool checked);	//启用或停用搜索索引
+	void on_actionSpellCheck_toggled(bool checked);	//启用或停用拼写检查
+	void on_actionMeasureLatency_toggled(bool checked);	//开启或关闭输入延迟测量
+	void on_actionPerformance_triggered();	//显示性能对话框
+	void updatePerformance();				//把各文档的延迟统计显示到性能对话框
+	void clearPerformance();				//清除各文档的延迟统计
+	void on_actionTrace_toggled(bool checked);	//开始或停止记录跟踪
+	void on_actionSaveTrace_triggered();	//把记录的跟踪保存为Chrome Trace格式
+	void showStallRecorded(const QString &fileName, qint64 milliseconds);	//提示界面卡顿的跟踪已保存
+	void on_actionSelectNext_triggered();	//选择下一个匹配项
+	void on_actionSelectAllOccurrences_triggered();	//选择所有匹配项
+	void on_actionMatchBracket_triggered();	//转到匹配的括号
+	void on_actionFold_triggered();			//折叠
+	void on_actionUnfold_triggered();		//展开
+	void on_actionUnfoldAll_triggered();	//全部展开
+	void on_actionComplete_triggered();		//自动完成
+	void on_actionSortAscending_triggered();	//升序排序
+	void on_actionSortDescending_triggered();	//降序排序
+	void on_actionSortNumeric_triggered();	//按数值排序
+	void on_actionReverseLines_triggered();	//反转行顺序
+	void on_actionRemoveDuplicates_triggered();	//删除重复行
+	void on_actionKeepMatching_triggered();	//保留匹配的行
+	void on_actionRemoveMatching_triggered();	//删除匹配的行
 
 	void on_actionClose_triggered();		//关闭
 	void on_actionCloseAll_triggered();		//关闭所有窗口
 	void on_actionTile_triggered();			//平铺
+	void on_actionTileColumns_triggered();	//按列平铺
+	void on_actionMasterStack_triggered();	//活动窗口在左，其余在右侧堆叠
     void on_actionCascade_triggered();		//层叠
+	void on_actionTabbedView_toggled(bool checked);	//切换标签页模式和窗口模式
 	void on_actionNext_triggered();			//下一个
 	void on_actionPrevious_triggered();		//上一个
+	void on_actionQuickSwitch_triggered();	//快速切换到打开的窗口或最近的文件
+	void on_actionCompare_triggered();		//比较两个文档
+	void on_actionMerge_triggered();		//三方合并
+	void on_actionNextConflict_triggered();	//下一个冲突
+	void on_actionPreviousConflict_triggered();	//上一个冲突
 
     void on_actionAbout_triggered();		//关于
     void on_actionAboutQt_triggered();		//关于Qt
 	////////////////////菜单功能/////////////////////////////////////////
 
 	void showTextRowAndCol();				//显示文本的行号和列号
+	void updateStatistics();				//更新状态栏中的文档统计
+
+	void findNext();						//在活动窗口中查找下一个
+	void replaceAll();						//在活动窗口中全部替换
+	void showReplaceResult(int count, qint64 elapsed);	//显示全部替换的结果
+	void showReplaceError(const QString &reason);		//显示全部替换失败的原因
+	void countInAllDocuments();				//在所有打开的文档中统计匹配数
+	void showSearchIndexReady(qint64 bytes);	//显示搜索索引占用的内存
+	void showLinesTransformed(int linesBefore, int linesAfter, qint64 elapsed);	//显示行操作的结果
+	void showTransformLinesError(const QString &reason);	//显示行操作失败的原因
+	void showMergeResult();					//三方合并完成，打开合并结果窗口
+	void finishStartup();					//第一次绘制之后加载图标和状态提示
+	void reportStartup();					//报告第一次绘制和可以交互的时间
 
 
 private:
 	QAction * actionSeparator;		//间隔器
 	MdiChild * activeMdiChild();	//活动窗口
+	MergeSession * activeMergeSession();	//活动窗口所属的三方合并会话
 	QMdiSubWindow * findMdiChild(const QString &fileName);	//查找子窗口
-	QSignalMapper * windowMapper;   //信号映射器
-	void readSettings();			//读取窗口设置
+	WindowList * windowList;		//窗口菜单中的窗口列表
+	FindReplaceDialog * findDialog;	//查找替换对话框
+	PerformanceDialog * performanceDialog;	//性能对话框
+	StallWatchdog * watchdog;		//界面卡顿监视线程，记录跟踪时运行
+	QLabel * statisticsLabel;		//状态栏中的文档统计
+	WordIndex * wordIndex;			//所有文档共享的单词补全索引
+	MdiChildPool * childPool;		//预先创建的子窗口
+	QuickSwitcher * quickSwitcher;	//快速切换窗口，第一次使用时创建
+	UiStateAggregator * uiState;	//合并界面状态的更新
+	TabRealizer * tabRealizer;		//标签页模式下让不可见的标签休眠
+	WindowLayout * windowLayout;	//平铺和层叠子窗口
+	void updateClipboardActions();	//更新剪切复制动作
+	void updateUndoActions();		//更新撤销恢复动作
+	QStringList recentFiles;		//最近打开或保存的文件，最近的在前
+	bool recentFilesLoaded;			//最近的文件是否已经从设置中读取
+	const QStringList &recentFileList();	//最近的文件，第一次使用时读取设置
+	void addRecentFile(const QString &fileName);	//记录最近的文件
+	bool startupTrace;				//是否报告启动耗时
+	qint64 firstPaintTime;			//第一次绘制完成的时间（微秒）
+	//启动时读取的窗口设置
+	struct WindowSettings
+	{
+		QRect geometry;				//位置和大小
+		bool tabbedView;			//是否使用标签页模式
+	};
+	static WindowSettings readSettings();	//读取窗口设置，在工作线程中运行
 	void writeSettings();			//写入窗口设置
 
 	void initWindow();				//初始化窗口
+	void initWindowMenu();			//创建窗口菜单
+	void initStatusTips();			//设置各个动作的状态提示
+	void loadIcons();				//从图集设置各个动作的图标
+	void transformLines(LineOperations::Operation operation);	//在活动窗口中执行行操作
 
 protected:
 	void closeEvent(QCloseEvent * event);	//关闭事件
+	bool eventFilter(QObject * watched, QEvent * event);	//发现多文档区域的第一次绘制
 
 private:
     Ui::MainWindow *ui;
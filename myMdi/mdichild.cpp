@@ -1,15 +1,120 @@
 ﻿#include <QMenu>
+#include <QPainter>
+#include <QKeyEvent>
+#include <QResizeEvent>
+#include <QMouseEvent>
+#include <QMimeData>
+#include <QClipboard>
+#include <QScrollBar>
+#include <QProgressDialog>
+#include <QTimer>
+#include <QtConcurrent>
+#include <QCompleter>
+#include <QStringListModel>
+#include <QAbstractItemView>
 #include "mdichild.h"
+#include "tracer.h"
+#include "trigramindex.h"
+#include "lazymimedata.h"
+#include "bracketindex.h"
+#include "blockdata.h"
+#include "wordindex.h"
+#include "spellchecker.h"
 
-MdiChild::MdiChild()
+const char * MdiChild::BlockMimeType = "application/x-mymdi-block";
+
+MdiChild::MdiChild() :
+	eagerCopy(false)
 {
 	setMinimumSize(1000, 600);
-	setFont(QFont(QString::fromLocal8Bit("Consolas"),14));
+	setFont(editorFont());
     //设置在子窗口关闭时销毁这个类的对象
     setAttribute(Qt::WA_DeleteOnClose);
     //初始isUnititled为true
     isUntitled = true;
+	//标签页模式下不可见时才休眠
+	dormant = false;
+
+	//全部替换在工作线程中计算，完成后回到界面线程应用结果
+	replaceWatcher = new QFutureWatcher<SearchEngine::ReplaceResult>(this);
+	replaceRevision = 0;
+	connect(replaceWatcher, SIGNAL(finished()), this, SLOT(replaceAllComputed()));
+
+	//行操作同样在工作线程中计算
+	lineWatcher = new QFutureWatcher<LineOperations::Result>(this);
+	lineRevision = 0;
+	lineStart = lineEnd = 0;
+	connect(lineWatcher, SIGNAL(finished()), this, SLOT(linesComputed()));
+
+	pasteOffset = pasteStart = pasteEnd = 0;
+	pasteWasReadOnly = false;
+	pasteProgress = nullptr;
+
+	searchIndex = nullptr;
+
+	//行索引随文档修改增量更新统计信息
+	lineIndex = new LineIndex(document());
+	connect(lineIndex, SIGNAL(statisticsChanged()), this, SIGNAL(statisticsChanged()));
+
+	//括号索引随文档修改增量更新，光标移动时高亮匹配的括号
+	bracketIndex = new BracketIndex(document());
+	connect(bracketIndex, SIGNAL(indexReady()), this, SLOT(matchBrackets()));
+	connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(matchBrackets()));
+
+	wordIndex = nullptr;
+
+	//拼写检查优先检查可见的行，滚动时更新可见范围
+	spellChecker = nullptr;
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisibleLines()));
+	connect(verticalScrollBar(), SIGNAL(rangeChanged(int, int)), this, SLOT(updateVisibleLines()));
+	updateSpellCheck();
+	completer = nullptr;
+	completionStart = 0;
+
+	//其他途径修改文档（如撤销）时，多光标随之平移
+	applyingEdits = false;
+	connect(document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(shiftCursors(int, int, int)));
+}
+
+MdiChild::~MdiChild()
+{
+	//剪贴板中的延迟数据不能再引用即将销毁的文档
+	for (const QPointer<LazyMimeData> &copy : pendingCopies)
+	{
+		if (copy)
+			copy->materialize();
+	}
+	//索引挂在文档的各个块上，要在文档销毁之前先删除
+	delete searchIndex;
+	delete lineIndex;
+	delete bracketIndex;
+	delete spellChecker;
+}
 
+const QFont & MdiChild::editorFont()
+{
+	//Linux上通常没有Consolas，每次都要查找替代字体；这里只解析一次，
+	//之后各个窗口的QFont共享同一份解析结果和字形度量
+	static const QFont font = []()
+	{
+		QFont font(QString::fromLocal8Bit("Consolas"), 14);
+		font.setStyleHint(QFont::TypeWriter);
+		QFontMetrics(font).height();
+		return font;
+	}();
+	return font;
+}
+
+qreal MdiChild::spaceWidth() const
+{
+	static QFont cachedFont;
+	static qreal cachedWidth = -1;
+	if (cachedWidth < 0 || font() != cachedFont)
+	{
+		cachedFont = font();
+		cachedWidth = QFontMetricsF(cachedFont).horizontalAdvance(QLatin1Char(' '));
+	}
+	return cachedWidth;
 }
 
 void MdiChild::newFile()
@@ -26,6 +131,9 @@ void MdiChild::newFile()
     //新建文档没有被保存过
     isUntitled = true;
 
+    //新建文档使用本地编码和平台的换行符
+    format = TextFile::Format();
+
     //将当前文件命名为未命名文档加编号，编号先使用再加1
     curFile = QString::fromLocal8Bit("未命名文档%1.txt").arg(sequenceNumber++);
 
@@ -45,26 +153,35 @@ void MdiChild::documentWasModified()
 
 bool MdiChild::loadFile(const QString &fileName)
 {
-    //新建QFile对象
-    QFile file(fileName);
-    //只读方式打开文件，出错则提示，并返回false
-    if(!file.open(QFile::ReadOnly | QFile::Text))
+	TRACE_SCOPE_CATEGORY("MdiChild::loadFile", "io");
+    //设置鼠标状态为等待状态
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    //读取文件的全部文本内容，识别编码和换行符，保存时按原格式写回
+    QString text;
+    QString error;
+    if (!TextFile::read(fileName, &text, &format, &error))
     {
-        QMessageBox::warning(this,QString::fromLocal8Bit("多文档编辑器"),QString::fromLocal8Bit("无法读取文件 %1：\n%2.").arg(fileName).arg(file.errorString()));
+        QApplication::restoreOverrideCursor();
+        QMessageBox::warning(this,QString::fromLocal8Bit("多文档编辑器"),QString::fromLocal8Bit("无法读取文件 %1：\n%2.").arg(fileName).arg(error));
         return false;
     }
-
-    //新建文本流对象
-    QTextStream in(&file);
-    //设置鼠标状态为等待状态
-    QApplication::setOverrideCursor(Qt::WaitCursor);
-    //读取文件的全部文本内容，并添加到编辑器中
-    setPlainText(in.readAll());
+    //整体替换文档时不逐块统计，加载完成后在后台统一统计
+    lineIndex->invalidate();
+    bracketIndex->invalidate();
+    {
+        TRACE_SCOPE_CATEGORY("QTextEdit::setPlainText", "layout");
+        setPlainText(text);
+    }
+    text.clear();
+    lineIndex->rebuild();
+    bracketIndex->rebuild();
     //恢复鼠标状态
     QApplication::restoreOverrideCursor();
 	//设置当前文件
 	setCurrentFile(fileName);
     connect(document(), SIGNAL(contentsChanged()), this, SLOT(documentWasModified()));
+	//大文档加载后在后台建立搜索索引
+	updateSearchIndex();
 	return true;
 
 
@@ -119,20 +236,19 @@ bool MdiChild::saveAs()
 
 bool MdiChild::saveFile(const QString &fileName)
 {
-    QFile file(fileName);
-    if(!file.open(QFile::WriteOnly | QFile::Text))
-    {
-        QMessageBox::warning(this,QString::fromLocal8Bit("多文档编辑器"),QString::fromLocal8Bit("无法写入文件%1：\n%2.").arg(fileName).arg(file.errorString()));
-        return false;
-    }
-    //新建文本流对象
-    QTextStream out(&file);
+	TRACE_SCOPE_CATEGORY("MdiChild::saveFile", "io");
     //设置鼠标状态为等待状态
     QApplication::setOverrideCursor(Qt::WaitCursor);
-    //以纯文本文件写入
-    out<<toPlainText();
+    //按打开时的编码和换行符写入，先写临时文件再替换，失败时不会损坏原文件
+    QString error;
+    bool written = TextFile::write(fileName, toPlainText(), format, &error);
     //恢复鼠标状态
     QApplication::restoreOverrideCursor();
+    if (!written)
+    {
+        QMessageBox::warning(this,QString::fromLocal8Bit("多文档编辑器"),QString::fromLocal8Bit("无法写入文件%1：\n%2.").arg(fileName).arg(error));
+        return false;
+    }
 	//设置当前文件
 	setCurrentFile(fileName);
 	return true;
@@ -181,10 +297,10 @@ void MdiChild::contextMenuEvent(QContextMenuEvent * e)
 	//创建菜单，并向其中添加动作
 	QMenu *menu = new QMenu;
 	QAction * undo = menu->addAction(QString::fromLocal8Bit("撤销（&U）"), this, SLOT(undo()), QKeySequence::Undo);
-	undo->setEnabled(document()->isUndoAvailable());
+	undo->setEnabled(document()->isUndoAvailable() && !isPasting());
 
 	QAction * redo = menu->addAction(QString::fromLocal8Bit("恢复（&R）"), this, SLOT(redo()), QKeySequence::Redo);
-	redo->setEnabled(document()->isRedoAvailable());
+	redo->setEnabled(document()->isRedoAvailable() && !isPasting());
 
 	menu->addSeparator();
 	QAction * cut = menu->addAction(QString::fromLocal8Bit("剪切（&T）"), this, SLOT(cut()), QKeySequence::Cut);
@@ -208,25 +324,1465 @@ void MdiChild::contextMenuEvent(QContextMenuEvent * e)
 	delete menu;
 }
 
+bool MdiChild::findNext(const QString &pattern, const SearchEngine::Options &options)
+{
+	TRACE_SCOPE_CATEGORY("MdiChild::findNext", "search");
+	if (pattern.isEmpty())
+	{
+		return false;
+	}
+
+	//从当前光标处向后查找，到达文档末尾后从头开始
+	QTextDocument::FindFlags flags;
+	if (options.caseSensitive)
+	{
+		flags |= QTextDocument::FindCaseSensitively;
+	}
+	QRegularExpression re = SearchEngine::compile(pattern, options);
+	QTextCursor found;
+
+	//有索引时只在候选块中验证，否则整篇文档顺序查找
+	QVector<QTextBlock> candidates;
+	updateSearchIndex();
+	if (searchIndex && searchIndex->candidateBlocks(pattern, options, &candidates))
+	{
+		found = findInBlocks(candidates, re, textCursor().selectionEnd());
+		if (found.isNull())
+		{
+			found = findInBlocks(candidates, re, 0);
+		}
+	}
+	else
+	{
+		found = document()->find(re, textCursor(), flags);
+		if (found.isNull())
+		{
+			found = document()->find(re, 0, flags);
+		}
+	}
+	if (found.isNull())
+	{
+		return false;
+	}
+	setTextCursor(found);
+	return true;
+}
+
+void MdiChild::replaceAll(const QString &pattern, const QString &replacement,
+	const SearchEngine::Options &options)
+{
+	//上一次替换还没有完成时忽略新的请求
+	if (pattern.isEmpty() || replaceWatcher->isRunning())
+	{
+		return;
+	}
+	QRegularExpression re = SearchEngine::compile(pattern, options);
+	if (!re.isValid())
+	{
+		emit replaceAllFailed(QString::fromLocal8Bit("正则表达式无效：%1").arg(re.errorString()));
+		return;
+	}
+	//合并视图和分块粘贴期间文档是只读的
+	if (isReadOnly())
+	{
+		emit replaceAllFailed(QString::fromLocal8Bit("文档是只读的，不能替换"));
+		return;
+	}
+
+	//QTextDocument不能跨线程访问，所以先取出纯文本快照，再交给工作线程一次性计算出替换结果
+	replaceTimer.start();
+	replaceRevision = document()->revision();
+	replaceWatcher->setFuture(QtConcurrent::run(&SearchEngine::replaceAll, toPlainText(), pattern, replacement, options));
+}
+
+void MdiChild::replaceAllComputed()
+{
+	SearchEngine::ReplaceResult result = replaceWatcher->result();
+	if (!result.error.isEmpty())
+	{
+		emit replaceAllFailed(result.error);
+		return;
+	}
+	//计算期间文档被修改过，快照已经失效，放弃这次结果
+	if (document()->revision() != replaceRevision)
+	{
+		emit replaceAllFailed(QString::fromLocal8Bit("替换期间文档被修改，请重新执行全部替换"));
+		return;
+	}
+	//计算期间可能开始了分块粘贴
+	if (isReadOnly())
+	{
+		emit replaceAllFailed(QString::fromLocal8Bit("文档是只读的，不能替换"));
+		return;
+	}
+
+	if (result.count > 0)
+	{
+		replaceRange(result.start, result.end, result.text);
+	}
+	emit replaceAllFinished(result.count, replaceTimer.elapsed());
+}
+
+void MdiChild::transformLines(LineOperations::Operation operation, const QString &pattern,
+	const SearchEngine::Options &options)
+{
+	if (lineWatcher->isRunning() || isReadOnly())
+	{
+		return;
+	}
+
+	//有选区时扩展到完整的行
+	QTextCursor cursor = textCursor();
+	QString text;
+	if (cursor.hasSelection())
+	{
+		QTextBlock first = document()->findBlock(cursor.selectionStart());
+		QTextBlock last = document()->findBlock(cursor.selectionEnd());
+		lineStart = first.position();
+		lineEnd = last.position() + last.length() - 1;
+		text = textInRange(lineStart, lineEnd);
+	}
+	else
+	{
+		lineStart = 0;
+		lineEnd = document()->characterCount() - 1;
+		text = toPlainText();
+	}
+
+	lineTimer.start();
+	lineRevision = document()->revision();
+	lineWatcher->setFuture(QtConcurrent::run(&LineOperations::apply, text, operation, pattern, options));
+}
+
+void MdiChild::linesComputed()
+{
+	LineOperations::Result result = lineWatcher->result();
+	if (!result.error.isEmpty())
+	{
+		emit transformLinesFailed(result.error);
+		return;
+	}
+	if (document()->revision() != lineRevision)
+	{
+		emit transformLinesFailed(QString::fromLocal8Bit("处理期间文档被修改，请重新执行"));
+		return;
+	}
+
+	//整段结果一次替换回文档
+	replaceRange(lineStart, lineEnd, result.text);
+	emit linesTransformed(result.linesBefore, result.linesAfter, lineTimer.elapsed());
+}
+
+void MdiChild::replaceRange(int start, int end, const QString &text)
+{
+	prepareEdit(start, end);
+	//在一个编辑块中只做一次插入，这样只产生一个撤销步骤，也只触发一次重新布局
+	QTextCursor cursor(document());
+	cursor.setPosition(start);
+	cursor.setPosition(end, QTextCursor::KeepAnchor);
+	cursor.beginEditBlock();
+	cursor.insertText(text);
+	cursor.endEditBlock();
+}
+
+QTextCursor MdiChild::findInBlocks(const QVector<QTextBlock> &blocks, const QRegularExpression &re, int from)
+{
+	//候选块已经按位置排好序，找到from之后的第一处匹配
+	for (const QTextBlock &block : blocks)
+	{
+		int blockStart = block.position();
+		if (blockStart + block.length() <= from)
+		{
+			continue;
+		}
+		QRegularExpressionMatch match = re.match(block.text(), qMax(0, from - blockStart));
+		if (match.hasMatch())
+		{
+			QTextCursor cursor(document());
+			cursor.setPosition(blockStart + match.capturedStart());
+			cursor.setPosition(blockStart + match.capturedEnd(), QTextCursor::KeepAnchor);
+			return cursor;
+		}
+	}
+	return QTextCursor();
+}
+
+int MdiChild::countMatches(const QString &pattern, const SearchEngine::Options &options)
+{
+	TRACE_SCOPE_CATEGORY("MdiChild::countMatches", "search");
+	QRegularExpression re = SearchEngine::compile(pattern, options);
+	if (pattern.isEmpty() || !re.isValid())
+	{
+		return 0;
+	}
+
+	int count = 0;
+	QVector<QTextBlock> candidates;
+	updateSearchIndex();
+	if (searchIndex && searchIndex->candidateBlocks(pattern, options, &candidates))
+	{
+		//只验证索引给出的候选块
+		for (const QTextBlock &block : candidates)
+		{
+			QRegularExpressionMatchIterator it = re.globalMatch(block.text());
+			while (it.hasNext())
+			{
+				it.next();
+				++count;
+			}
+		}
+	}
+	else
+	{
+		//与QTextDocument::find和索引的结果一致，逐块匹配，匹配不跨越换行
+		for (QTextBlock block = document()->begin(); block.isValid(); block = block.next())
+		{
+			QRegularExpressionMatchIterator it = re.globalMatch(block.text());
+			while (it.hasNext())
+			{
+				it.next();
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+void MdiChild::updateSearchIndex()
+{
+	bool wanted = TrigramIndex::isEnabled() && document()->characterCount() >= TrigramIndex::MinimumDocumentSize;
+	if (wanted && !searchIndex)
+	{
+		searchIndex = new TrigramIndex(document());
+		connect(searchIndex, SIGNAL(indexReady(qint64)), this, SIGNAL(searchIndexReady(qint64)));
+		searchIndex->rebuild();
+	}
+	else if (!TrigramIndex::isEnabled() && searchIndex)
+	{
+		//小文档不主动删除已有的索引，避免编辑时反复建立
+		delete searchIndex;
+		searchIndex = nullptr;
+	}
+}
+
+void MdiChild::updateSpellCheck()
+{
+	if (SpellChecker::isEnabled() && !spellChecker)
+	{
+		spellChecker = new SpellChecker(document());
+		connect(spellChecker, SIGNAL(linesChecked(int, int)), this, SLOT(spellingChecked(int, int)));
+		updateVisibleLines();
+	}
+	else if (!SpellChecker::isEnabled() && spellChecker)
+	{
+		delete spellChecker;
+		spellChecker = nullptr;
+		viewport()->update();
+	}
+}
+
+void MdiChild::setDormant(bool dormant)
+{
+	if (this->dormant == dormant)
+	{
+		return;
+	}
+	TRACE_SCOPE_CATEGORY("MdiChild::setDormant", "ui");
+	this->dormant = dormant;
+	if (dormant)
+	{
+		//补全列表和括号高亮在唤醒后需要时再生成
+		dormantSize = viewport()->size();
+		delete completer;
+		completer = nullptr;
+		setExtraSelections(QList<QTextEdit::ExtraSelection>());
+		return;
+	}
+
+	//休眠期间大小变化时按最终的大小处理一次，宽度没变时沿用原来的布局
+	if (viewport()->size() != dormantSize)
+	{
+		QResizeEvent event(viewport()->size(), dormantSize);
+		QTextEdit::resizeEvent(&event);
+	}
+	matchBrackets();
+	updateVisibleLines();
+}
+
+void MdiChild::resizeEvent(QResizeEvent *e)
+{
+	if (dormant)
+	{
+		return;
+	}
+	QTextEdit::resizeEvent(e);
+}
+
+void MdiChild::updateVisibleLines()
+{
+	if (spellChecker && !dormant)
+	{
+		int first = cursorForPosition(QPoint(0, 0)).blockNumber();
+		int last = cursorForPosition(QPoint(viewport()->width(), viewport()->height())).blockNumber();
+		spellChecker->setVisibleLines(first, last);
+	}
+}
+
+void MdiChild::spellingChecked(int first, int last)
+{
+	//下划线是另外绘制的，只需重绘视口，不影响文档布局
+	int top = cursorForPosition(QPoint(0, 0)).blockNumber();
+	int bottom = cursorForPosition(QPoint(viewport()->width(), viewport()->height())).blockNumber();
+	if (first <= bottom && last >= top)
+	{
+		viewport()->update();
+	}
+}
+
+qint64 MdiChild::searchIndexMemory() const
+{
+	return (searchIndex && searchIndex->isReady()) ? searchIndex->memoryUsage() : 0;
+}
+
+TextStatistics MdiChild::statistics() const
+{
+	return lineIndex->statistics();
+}
+
+TextStatistics MdiChild::selectionStatistics() const
+{
+	QTextCursor cursor = textCursor();
+	return lineIndex->selectionStatistics(cursor.selectionStart(), cursor.selectionEnd());
+}
+
+void MdiChild::applyEdits(const QVector<EditOperation> &edits)
+{
+	if (edits.isEmpty())
+	{
+		return;
+	}
+
+	//在同一个编辑块中从后向前逐处修改，前面的位置不受影响。
+	//只产生一个撤销步骤，布局也只在编辑块结束时按修改过的行更新一次；
+	//各处之间未修改的行保留它们的块数据（索引编号、折叠状态、拼写检查结果）
+	prepareEdit(edits.first().start, edits.last().end);
+	applyingEdits = true;
+	QTextCursor cursor(document());
+	cursor.beginEditBlock();
+	for (int i = edits.size() - 1; i >= 0; --i)
+	{
+		const EditOperation &edit = edits.at(i);
+		if (edit.start == edit.end && edit.text.isEmpty())
+			continue;
+		cursor.setPosition(edit.start);
+		cursor.setPosition(edit.end, QTextCursor::KeepAnchor);
+		cursor.insertText(edit.text);
+	}
+	cursor.endEditBlock();
+	applyingEdits = false;
+}
+
+QString MdiChild::textInRange(int start, int end) const
+{
+	QTextCursor cursor(document());
+	cursor.setPosition(start);
+	cursor.setPosition(end, QTextCursor::KeepAnchor);
+	//selectedText()用段落分隔符表示换行
+	return cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+}
+
+void MdiChild::selectNextOccurrence()
+{
+	QTextCursor cursor = textCursor();
+	//没有选中文本时先选中光标处的单词
+	if (!cursor.hasSelection())
+	{
+		cursor.select(QTextCursor::WordUnderCursor);
+		setTextCursor(cursor);
+		return;
+	}
+	//只读时不添加光标，只选中下一处
+	if (cursors.isEmpty() && !isReadOnly())
+	{
+		cursors.add(CursorSet::Range(cursor.selectionStart(), cursor.selectionEnd()));
+	}
+
+	//从最后添加的选区之后继续查找，到达末尾后从头开始
+	QString needle = cursor.selectedText();
+	QTextCursor found = document()->find(needle, cursor.selectionEnd(), QTextDocument::FindCaseSensitively);
+	if (found.isNull())
+	{
+		found = document()->find(needle, 0, QTextDocument::FindCaseSensitively);
+	}
+	if (found.isNull())
+	{
+		return;
+	}
+	if (isReadOnly())
+	{
+		setTextCursor(found);
+		return;
+	}
+	int index = cursors.lowerBound(found.selectionStart());
+	if (index < cursors.size() && cursors.at(index).start == found.selectionStart())
+	{
+		return;
+	}
+	cursors.add(CursorSet::Range(found.selectionStart(), found.selectionEnd()));
+	setTextCursor(found);
+	viewport()->update();
+}
+
+void MdiChild::selectAllOccurrences()
+{
+	QTextCursor cursor = textCursor();
+	if (!cursor.hasSelection())
+	{
+		cursor.select(QTextCursor::WordUnderCursor);
+	}
+	QString needle = cursor.selectedText();
+	if (needle.isEmpty() || isReadOnly())
+	{
+		return;
+	}
+
+	//先收集全部匹配，再一次性建立光标集合
+	QVector<CursorSet::Range> ranges;
+	QTextCursor found = document()->find(needle, 0, QTextDocument::FindCaseSensitively);
+	while (!found.isNull())
+	{
+		ranges.append(CursorSet::Range(found.selectionStart(), found.selectionEnd()));
+		found = document()->find(needle, found, QTextDocument::FindCaseSensitively);
+	}
+	cursors.setRanges(ranges);
+	setTextCursor(cursor);
+	viewport()->update();
+}
+
+void MdiChild::clearCursors()
+{
+	if (!cursors.isEmpty())
+	{
+		cursors.clear();
+		viewport()->update();
+	}
+}
+
+void MdiChild::shiftCursors(int position, int charsRemoved, int charsAdded)
+{
+	if (!applyingEdits && !cursors.isEmpty())
+	{
+		cursors.shift(position, charsRemoved, charsAdded);
+	}
+	//列选区以行号表示，其他途径（如撤销）可能增删行，直接退出列选择模式
+	if (!applyingEdits && columnSelection.active)
+	{
+		clearBlockSelection();
+	}
+}
+
+void MdiChild::keyPressEvent(QKeyEvent *e)
+{
+	//单独按下修饰键不会改变画面
+	if (LatencyHistogram::isEnabled() && e->key() != Qt::Key_Shift && e->key() != Qt::Key_Control
+		&& e->key() != Qt::Key_Alt && e->key() != Qt::Key_Meta)
+	{
+		markKeyEvent();
+	}
+	//候选列表显示时，确认和取消的按键交给补全器处理
+	if (completer && completer->popup()->isVisible())
+	{
+		switch (e->key())
+		{
+		case Qt::Key_Enter:
+		case Qt::Key_Return:
+		case Qt::Key_Escape:
+		case Qt::Key_Tab:
+		case Qt::Key_Backtab:
+			e->ignore();
+			return;
+		default:
+			completer->popup()->hide();
+			break;
+		}
+	}
+	if (columnSelection.active && blockKeyPress(e))
+	{
+		return;
+	}
+	if (cursors.size() > 1 && multiCursorKeyPress(e))
+	{
+		return;
+	}
+	if (e->matches(QKeySequence::Cut))
+	{
+		cut();
+		return;
+	}
+	if (e->matches(QKeySequence::Undo) || e->matches(QKeySequence::Redo) || cursors.size() > 1)
+	{
+		prepareEdit(0, document()->characterCount());
+	}
+	else
+	{
+		//普通按键只会修改光标所在的行，退格和删除可能与相邻的行合并
+		QTextCursor cursor = textCursor();
+		QTextBlock last = document()->findBlock(cursor.selectionEnd());
+		prepareEdit(document()->findBlock(cursor.selectionStart()).position() - 1, last.position() + last.length());
+	}
+	QTextEdit::keyPressEvent(e);
+}
+
+void MdiChild::inputMethodEvent(QInputMethodEvent *e)
+{
+	if (LatencyHistogram::isEnabled() && !e->commitString().isEmpty())
+	{
+		markKeyEvent();
+	}
+	QTextCursor cursor = textCursor();
+	QTextBlock last = document()->findBlock(cursor.selectionEnd());
+	prepareEdit(document()->findBlock(cursor.selectionStart()).position(), last.position() + last.length());
+	QTextEdit::inputMethodEvent(e);
+}
+
+bool MdiChild::multiCursorKeyPress(QKeyEvent *e)
+{
+	Qt::KeyboardModifiers modifiers = e->modifiers() & ~(Qt::ShiftModifier | Qt::KeypadModifier);
+	if (e->key() == Qt::Key_Escape)
+	{
+		clearCursors();
+		return true;
+	}
+
+	//确定每个光标处要插入的文本
+	QString text;
+	if (modifiers == Qt::NoModifier)
+	{
+		if (e->key() == Qt::Key_Return || e->key() == Qt::Key_Enter)
+			text = QString(QLatin1Char('\n'));
+		else if (e->key() == Qt::Key_Tab)
+			text = QString(QLatin1Char('\t'));
+		else if (!e->text().isEmpty() && e->text().at(0).isPrint())
+			text = e->text();
+	}
+
+	bool backspace = (e->key() == Qt::Key_Backspace && modifiers == Qt::NoModifier);
+	bool del = (e->key() == Qt::Key_Delete && modifiers == Qt::NoModifier);
+	QVector<CursorSet::Range> ranges = cursors.ranges();
+
+	if (text.isEmpty() && !backspace && !del)
+	{
+		if (modifiers == Qt::NoModifier && (e->key() == Qt::Key_Left || e->key() == Qt::Key_Right))
+		{
+			//左右方向键同时移动所有光标
+			int limit = document()->characterCount() - 1;
+			for (CursorSet::Range &range : ranges)
+			{
+				int position = (e->key() == Qt::Key_Left)
+					? (range.start < range.end ? range.start : qMax(0, range.start - 1))
+					: (range.start < range.end ? range.end : qMin(limit, range.end + 1));
+				range = CursorSet::Range(position, position);
+			}
+			cursors.setRanges(ranges);
+			viewport()->update();
+			return true;
+		}
+		//其他导航键回到单光标模式，组合键（如撤销）交给默认处理
+		if (modifiers == Qt::NoModifier)
+		{
+			clearCursors();
+		}
+		return false;
+	}
+
+	//合并视图和分块粘贴期间不能修改，QTextCursor的编辑不受只读限制，所以要在这里拦下
+	if (isReadOnly())
+	{
+		return true;
+	}
+
+	//每个光标对应一处修改，没有可删除内容的光标对应一处空修改，便于统一计算新位置
+	QVector<EditOperation> edits;
+	edits.reserve(ranges.size());
+	int limit = document()->characterCount() - 1;
+	int previousEnd = 0;
+	for (int i = 0; i < ranges.size(); ++i)
+	{
+		const CursorSet::Range &range = ranges.at(i);
+		int nextStart = (i + 1 < ranges.size()) ? ranges.at(i + 1).start : limit;
+		if (!text.isEmpty() || range.start < range.end)
+			edits.append(EditOperation(range.start, range.end, text));
+		else if (backspace && range.start > previousEnd)
+			edits.append(EditOperation(range.start - 1, range.start, QString()));
+		else if (del && range.end < nextStart)
+			edits.append(EditOperation(range.start, range.end + 1, QString()));
+		else
+			edits.append(EditOperation(range.start, range.start, QString()));
+		previousEnd = edits.last().end;
+	}
+	applyEdits(edits);
+
+	//修改完成后每个光标都位于自己插入的文本之后
+	QVector<CursorSet::Range> after;
+	after.reserve(edits.size());
+	int delta = 0;
+	for (const EditOperation &edit : edits)
+	{
+		int position = edit.start + delta + edit.text.size();
+		after.append(CursorSet::Range(position, position));
+		delta += edit.text.size() - (edit.end - edit.start);
+	}
+	cursors.setRanges(after);
+
+	QTextCursor cursor = textCursor();
+	cursor.setPosition(after.last().start);
+	setTextCursor(cursor);
+	viewport()->update();
+	return true;
+}
+
+void MdiChild::mousePressEvent(QMouseEvent *e)
+{
+	//Ctrl+单击在点击处添加一个光标，只读时不添加
+	if (e->button() == Qt::LeftButton && (e->modifiers() & Qt::ControlModifier) && !isReadOnly())
+	{
+		QTextCursor cursor = textCursor();
+		if (cursors.isEmpty())
+		{
+			cursors.add(CursorSet::Range(cursor.selectionStart(), cursor.selectionEnd()));
+		}
+		int position = cursorForPosition(e->pos()).position();
+		cursors.add(CursorSet::Range(position, position));
+		cursor.setPosition(position);
+		setTextCursor(cursor);
+		viewport()->update();
+		return;
+	}
+	//Alt+按下开始列选择
+	if (e->button() == Qt::LeftButton && (e->modifiers() & Qt::AltModifier))
+	{
+		clearCursors();
+		int line, column;
+		lineColumnAt(e->pos(), &line, &column);
+		columnSelection.anchorLine = columnSelection.line = line;
+		columnSelection.anchorColumn = columnSelection.column = column;
+		columnSelection.dragging = true;
+		setTextCursor(cursorForPosition(e->pos()));
+		if (!columnSelection.active)
+		{
+			columnSelection.active = true;
+			emit copyAvailable(true);
+		}
+		viewport()->update();
+		return;
+	}
+	clearCursors();
+	clearBlockSelection();
+	QTextEdit::mousePressEvent(e);
+}
+
+void MdiChild::mouseMoveEvent(QMouseEvent *e)
+{
+	if (columnSelection.dragging)
+	{
+		lineColumnAt(e->pos(), &columnSelection.line, &columnSelection.column);
+		ensureCursorVisible();
+		viewport()->update();
+		return;
+	}
+	//拖动选中的文本时，移动后原文会被删除，拖动的内容需要立即生成
+	eagerCopy = true;
+	QTextEdit::mouseMoveEvent(e);
+	eagerCopy = false;
+}
+
+void MdiChild::mouseReleaseEvent(QMouseEvent *e)
+{
+	if (columnSelection.dragging)
+	{
+		columnSelection.dragging = false;
+		return;
+	}
+	QTextEdit::mouseReleaseEvent(e);
+}
+
+void MdiChild::lineColumnAt(const QPoint &pos, int *line, int *column)
+{
+	//按等宽字体计算列号，列号可以超出行尾，编辑时再用空格补齐
+	QTextCursor cursor = cursorForPosition(pos);
+	QTextCursor lineStart(cursor.block());
+	qreal charWidth = spaceWidth();
+	*line = cursor.blockNumber();
+	*column = qMax(0, qRound((pos.x() - cursorRect(lineStart).left()) / charWidth));
+}
+
+void MdiChild::clearBlockSelection()
+{
+	if (columnSelection.active)
+	{
+		columnSelection = BlockSelection();
+		emit copyAvailable(textCursor().hasSelection());
+		viewport()->update();
+	}
+}
+
+MdiChild::EditOperation MdiChild::columnEdit(const QTextBlock &line, int startColumn, int endColumn, const QString &text) const
+{
+	int position = line.position();
+	int length = line.length() - 1;
+	if (length < startColumn)
+	{
+		//行比起始列短，删除时什么也不做，插入时先补齐空格
+		if (text.isEmpty())
+			return EditOperation(position + length, position + length, QString());
+		return EditOperation(position + length, position + length, QString(startColumn - length, QLatin1Char(' ')) + text);
+	}
+	return EditOperation(position + startColumn, position + qMin(endColumn, length), text);
+}
+
+void MdiChild::blockEdit(int startColumn, int endColumn, const QString &text)
+{
+	//每一行对应一处修改，全部交给applyEdits一次完成
+	QVector<EditOperation> edits;
+	edits.reserve(columnSelection.lastLine() - columnSelection.firstLine() + 1);
+	QTextBlock line = document()->findBlockByNumber(columnSelection.firstLine());
+	for (int i = columnSelection.firstLine(); i <= columnSelection.lastLine() && line.isValid(); ++i, line = line.next())
+	{
+		edits.append(columnEdit(line, startColumn, endColumn, text));
+	}
+	applyEdits(edits);
+}
+
+void MdiChild::copyBlock()
+{
+	if (!columnSelection.active)
+	{
+		return;
+	}
+	QStringList lines;
+	QTextBlock line = document()->findBlockByNumber(columnSelection.firstLine());
+	for (int i = columnSelection.firstLine(); i <= columnSelection.lastLine() && line.isValid(); ++i, line = line.next())
+	{
+		lines.append(line.text().mid(columnSelection.startColumn(), columnSelection.endColumn() - columnSelection.startColumn()));
+	}
+
+	//同时放入普通文本和矩形格式，本程序粘贴时按列粘贴，其他程序按多行文本粘贴
+	QString text = lines.join(QLatin1Char('\n'));
+	QMimeData * data = new QMimeData;
+	data->setText(text);
+	data->setData(QLatin1String(BlockMimeType), text.toUtf8());
+	QApplication::clipboard()->setMimeData(data);
+}
+
+void MdiChild::cutBlock()
+{
+	if (!columnSelection.active || isReadOnly())
+	{
+		return;
+	}
+	copyBlock();
+	blockEdit(columnSelection.startColumn(), columnSelection.endColumn(), QString());
+	columnSelection.anchorColumn = columnSelection.column = columnSelection.startColumn();
+	viewport()->update();
+}
+
+void MdiChild::insertFromMimeData(const QMimeData *source)
+{
+	if (source->hasFormat(QLatin1String(BlockMimeType)))
+	{
+		pasteBlock(QString::fromUtf8(source->data(QLatin1String(BlockMimeType))).split(QLatin1Char('\n')));
+		return;
+	}
+	//单行文本粘贴到列选区的每一行
+	QString text = source->text();
+	if (columnSelection.active && !text.contains(QLatin1Char('\n')))
+	{
+		blockEdit(columnSelection.startColumn(), columnSelection.endColumn(), text);
+		columnSelection.anchorColumn = columnSelection.column = columnSelection.startColumn() + text.size();
+		viewport()->update();
+		return;
+	}
+	clearBlockSelection();
+	//大段纯文本不经过QTextEdit的MIME处理，取出一次后分块插入
+	if (source->hasText() && text.size() >= LargePasteSize)
+	{
+		startChunkedPaste(text);
+		return;
+	}
+	QTextCursor cursor = textCursor();
+	prepareEdit(cursor.selectionStart(), cursor.selectionEnd());
+	QTextEdit::insertFromMimeData(source);
+}
+
+QMimeData * MdiChild::createMimeDataFromSelection() const
+{
+	QTextCursor cursor = textCursor();
+	if (eagerCopy || cursor.selectionEnd() - cursor.selectionStart() < LazyCopySize)
+	{
+		return QTextEdit::createMimeDataFromSelection();
+	}
+	//只记录范围，其他程序请求时才生成纯文本或HTML；已被剪贴板删除或已保存的不再跟踪
+	for (int i = pendingCopies.size() - 1; i >= 0; --i)
+	{
+		if (!pendingCopies.at(i) || pendingCopies.at(i)->isMaterialized())
+			pendingCopies.removeAt(i);
+	}
+	LazyMimeData * copy = new LazyMimeData(document(), cursor.selectionStart(), cursor.selectionEnd());
+	pendingCopies.append(copy);
+	return copy;
+}
+
+void MdiChild::markKeyEvent()
+{
+	if (!latencyClock.isValid())
+	{
+		latencyClock.start();
+	}
+	//超过一秒还没有绘制的按键多半没有改变画面，不计入统计
+	qint64 now = latencyClock.nsecsElapsed();
+	while (!pendingKeys.isEmpty() && now - pendingKeys.first() > 1000000000LL)
+	{
+		pendingKeys.removeFirst();
+	}
+	pendingKeys.append(now);
+}
+
+void MdiChild::prepareEdit(int start, int end)
+{
+	for (const QPointer<LazyMimeData> &copy : pendingCopies)
+	{
+		if (copy && copy->overlaps(start, end))
+			copy->materialize();
+	}
+}
+
+void MdiChild::cut()
+{
+	eagerCopy = true;
+	QTextEdit::cut();
+	eagerCopy = false;
+}
+
+void MdiChild::undo()
+{
+	//分块粘贴期间撤销会撤掉还没有结束的编辑块，下一块就会插入到错误的位置
+	if (isPasting())
+	{
+		return;
+	}
+	//撤销的位置事先无法确定，按整个文档处理
+	prepareEdit(0, document()->characterCount());
+	QTextEdit::undo();
+}
+
+void MdiChild::redo()
+{
+	if (isPasting())
+	{
+		return;
+	}
+	prepareEdit(0, document()->characterCount());
+	QTextEdit::redo();
+}
+
+void MdiChild::clear()
+{
+	if (isPasting())
+	{
+		return;
+	}
+	prepareEdit(0, document()->characterCount());
+	QTextEdit::clear();
+}
+
+void MdiChild::startChunkedPaste(const QString &text)
+{
+	if (!pasteBuffer.isEmpty())
+	{
+		return;
+	}
+	QTextCursor cursor = textCursor();
+	pasteStart = cursor.selectionStart();
+	pasteEnd = cursor.selectionEnd();
+	pasteBuffer = text;
+	pasteOffset = 0;
+
+	//粘贴期间禁止编辑，避免用户的修改夹在各块之间
+	pasteWasReadOnly = isReadOnly();
+	setReadOnly(true);
+	if (text.size() >= PasteProgressSize)
+	{
+		pasteProgress = new QProgressDialog(QString::fromLocal8Bit("正在粘贴..."),
+			QString::fromLocal8Bit("停止"), 0, text.size() / 1024, this);
+		pasteProgress->setMinimumDuration(500);
+		pasteProgress->setValue(0);
+	}
+	emit pastingChanged();
+	QTimer::singleShot(0, this, SLOT(pasteNextChunk()));
+}
+
+void MdiChild::pasteNextChunk()
+{
+	if (pasteProgress && pasteProgress->wasCanceled())
+	{
+		finishChunkedPaste();
+		return;
+	}
+
+	//不要把代理对拆到两块中
+	int size = qMin(int(PasteChunkSize), pasteBuffer.size() - pasteOffset);
+	if (pasteOffset + size < pasteBuffer.size() && pasteBuffer.at(pasteOffset + size - 1).isHighSurrogate())
+	{
+		++size;
+	}
+
+	prepareEdit(pasteStart + pasteOffset, pasteOffset == 0 ? pasteEnd : pasteStart + pasteOffset);
+
+	//第一块替换选区并开始一个编辑块，之后各块并入同一个编辑块，整个粘贴只有一个撤销步骤
+	QTextCursor cursor(document());
+	if (pasteOffset == 0)
+	{
+		cursor.setPosition(pasteStart);
+		cursor.setPosition(pasteEnd, QTextCursor::KeepAnchor);
+		cursor.beginEditBlock();
+	}
+	else
+	{
+		cursor.setPosition(pasteStart + pasteOffset);
+		cursor.joinPreviousEditBlock();
+	}
+	cursor.insertText(pasteBuffer.mid(pasteOffset, size));
+	cursor.endEditBlock();
+	pasteOffset += size;
+
+	if (pasteProgress)
+	{
+		pasteProgress->setValue(pasteOffset / 1024);
+	}
+	if (pasteOffset >= pasteBuffer.size())
+	{
+		finishChunkedPaste();
+		return;
+	}
+	//回到事件循环处理界面事件后再插入下一块
+	QTimer::singleShot(0, this, SLOT(pasteNextChunk()));
+}
+
+void MdiChild::finishChunkedPaste()
+{
+	QTextCursor cursor = textCursor();
+	cursor.setPosition(pasteStart + pasteOffset);
+	setTextCursor(cursor);
+	ensureCursorVisible();
 
+	pasteBuffer.clear();
+	pasteOffset = 0;
+	setReadOnly(pasteWasReadOnly);
+	delete pasteProgress;
+	pasteProgress = nullptr;
+	emit pastingChanged();
+}
 
+void MdiChild::pasteBlock(const QStringList &lines)
+{
+	//从列选区左上角开始粘贴并替换选区内容，没有列选区时从光标处开始
+	int firstLine, startColumn, endColumn, lastLine;
+	int selectionStart = -1;
+	int selectionEnd = -1;
+	if (columnSelection.active)
+	{
+		firstLine = columnSelection.firstLine();
+		lastLine = columnSelection.lastLine();
+		startColumn = columnSelection.startColumn();
+		endColumn = columnSelection.endColumn();
+	}
+	else
+	{
+		//选中的文本与第一行的粘贴合为一处修改，整个粘贴只产生一个撤销步骤
+		QTextCursor cursor = textCursor();
+		selectionStart = cursor.selectionStart();
+		selectionEnd = cursor.selectionEnd();
+		QTextBlock block = document()->findBlock(selectionStart);
+		firstLine = lastLine = block.blockNumber();
+		startColumn = endColumn = selectionStart - block.position();
+	}
 
+	QVector<EditOperation> edits;
+	edits.reserve(qMax(lines.size(), lastLine - firstLine + 1));
+	QTextBlock line = document()->findBlockByNumber(firstLine);
+	int i = 0;
+	if (selectionStart >= 0)
+	{
+		//其余各行从选区末尾所在行的下一行开始
+		edits.append(EditOperation(selectionStart, selectionEnd, lines.first()));
+		line = document()->findBlock(selectionEnd).next();
+		i = 1;
+	}
+	for (; (i < lines.size() || firstLine + i <= lastLine) && line.isValid(); ++i, line = line.next())
+	{
+		bool inSelection = (firstLine + i <= lastLine);
+		edits.append(columnEdit(line, startColumn, inSelection ? endColumn : startColumn, i < lines.size() ? lines.at(i) : QString()));
+	}
 
+	//超出文档末尾的行合并为一处修改追加在末尾
+	if (i < lines.size())
+	{
+		QString tail;
+		for (; i < lines.size(); ++i)
+		{
+			tail.append(QLatin1Char('\n'));
+			tail.append(QString(startColumn, QLatin1Char(' ')));
+			tail.append(lines.at(i));
+		}
+		int end = document()->characterCount() - 1;
+		if (!edits.isEmpty() && edits.last().start == end)
+			edits.last().text.append(tail);
+		else
+			edits.append(EditOperation(end, end, tail));
+	}
+	applyEdits(edits);
 
+	//粘贴后退出列选择模式，光标放在第一行粘贴内容之后
+	clearBlockSelection();
+	QTextBlock first = document()->findBlockByNumber(firstLine);
+	QTextCursor cursor(first);
+	cursor.setPosition(qMin(first.position() + startColumn + lines.first().size(), first.position() + first.length() - 1));
+	setTextCursor(cursor);
+}
 
+bool MdiChild::blockKeyPress(QKeyEvent *e)
+{
+	if (e->matches(QKeySequence::Copy))
+	{
+		copyBlock();
+		return true;
+	}
+	if (e->matches(QKeySequence::Cut))
+	{
+		cutBlock();
+		return true;
+	}
+	if (e->matches(QKeySequence::Paste))
+	{
+		paste();
+		return true;
+	}
 
+	Qt::KeyboardModifiers modifiers = e->modifiers() & ~Qt::KeypadModifier;
+	bool shift = (modifiers == Qt::ShiftModifier);
+	int startColumn = columnSelection.startColumn();
+	int endColumn = columnSelection.endColumn();
 
+	//Shift+方向键调整选区，左右方向键移动列
+	if (shift || modifiers == Qt::NoModifier)
+	{
+		int key = e->key();
+		if (key == Qt::Key_Left || key == Qt::Key_Right)
+		{
+			columnSelection.column = qMax(0, columnSelection.column + (key == Qt::Key_Left ? -1 : 1));
+			if (!shift)
+				columnSelection.anchorColumn = columnSelection.column;
+			viewport()->update();
+			return true;
+		}
+		if (shift && (key == Qt::Key_Up || key == Qt::Key_Down))
+		{
+			columnSelection.line = qBound(0, columnSelection.line + (key == Qt::Key_Up ? -1 : 1), document()->blockCount() - 1);
+			viewport()->update();
+			return true;
+		}
+	}
+	if (isReadOnly())
+	{
+		return false;
+	}
 
+	//输入文本时替换选中的列，没有选中列时在该列插入
+	QString text;
+	if (modifiers == Qt::NoModifier || shift)
+	{
+		if (e->key() == Qt::Key_Tab)
+			text = QString(QLatin1Char('\t'));
+		else if (!e->text().isEmpty() && e->text().at(0).isPrint())
+			text = e->text();
+	}
+	if (!text.isEmpty())
+	{
+		blockEdit(startColumn, endColumn, text);
+		columnSelection.anchorColumn = columnSelection.column = startColumn + text.size();
+		viewport()->update();
+		return true;
+	}
 
+	//删除选中的列，没有选中列时删除前一列或后一列
+	if (modifiers == Qt::NoModifier && (e->key() == Qt::Key_Backspace || e->key() == Qt::Key_Delete))
+	{
+		if (startColumn == endColumn)
+		{
+			if (e->key() == Qt::Key_Backspace)
+			{
+				if (startColumn == 0)
+					return true;
+				--startColumn;
+			}
+			else
+			{
+				++endColumn;
+			}
+		}
+		blockEdit(startColumn, endColumn, QString());
+		columnSelection.anchorColumn = columnSelection.column = startColumn;
+		viewport()->update();
+		return true;
+	}
 
+	//其他按键退出列选择模式，组合键（如撤销）交给默认处理
+	clearBlockSelection();
+	return modifiers == Qt::NoModifier && e->key() == Qt::Key_Escape;
+}
 
+void MdiChild::paintEvent(QPaintEvent *e)
+{
+	TRACE_SCOPE_CATEGORY("MdiChild::paintEvent", "paint");
+	{
+		//文档的布局推迟到绘制时才进行，这一段包括布局和绘制文本
+		TRACE_SCOPE_CATEGORY("QTextEdit::paintEvent", "layout");
+		QTextEdit::paintEvent(e);
+	}
+	paintFoldMarkers();
+	paintMisspellings();
 
+	//布局和高亮都已在上面完成，这次绘制显示出了之前所有按键的结果
+	if (!pendingKeys.isEmpty())
+	{
+		qint64 now = latencyClock.nsecsElapsed();
+		for (qint64 pressed : pendingKeys)
+		{
+			latency.add((now - pressed) / 1000);
+		}
+		pendingKeys.clear();
+	}
+	if (columnSelection.active)
+	{
+		//只绘制可见的行，列选区可以超出行尾
+		QPainter painter(viewport());
+		QColor selectionColor = palette().color(QPalette::Highlight);
+		selectionColor.setAlpha(96);
+		qreal charWidth = spaceWidth();
+		QTextBlock line = cursorForPosition(QPoint(0, 0)).block();
+		if (line.blockNumber() < columnSelection.firstLine())
+			line = document()->findBlockByNumber(columnSelection.firstLine());
+		for (; line.isValid() && line.blockNumber() <= columnSelection.lastLine(); line = line.next())
+		{
+			QRect rect = cursorRect(QTextCursor(line));
+			if (rect.top() > viewport()->height())
+				break;
+			int left = rect.left() + qRound(columnSelection.startColumn() * charWidth);
+			int right = rect.left() + qRound(columnSelection.endColumn() * charWidth);
+			painter.fillRect(QRect(left, rect.top(), qMax(2, right - left), rect.height()), selectionColor);
+		}
+		return;
+	}
+	if (cursors.size() < 2)
+	{
+		return;
+	}
 
+	//只绘制可见区域内的光标和选区，用二分查找定位第一个可见的光标
+	QPainter painter(viewport());
+	int first = cursorForPosition(QPoint(0, 0)).position();
+	int last = cursorForPosition(QPoint(viewport()->width(), viewport()->height())).position();
+	QColor selectionColor = palette().color(QPalette::Highlight);
+	selectionColor.setAlpha(96);
+	int right = viewport()->width();
+	QTextCursor cursor(document());
+	for (int i = qMax(0, cursors.lowerBound(first) - 1); i < cursors.size(); ++i)
+	{
+		CursorSet::Range range = cursors.at(i);
+		if (range.start > last)
+		{
+			break;
+		}
+		cursor.setPosition(range.start);
+		QRect startRect = cursorRect(cursor);
+		cursor.setPosition(range.end);
+		QRect endRect = cursorRect(cursor);
+		if (range.start < range.end)
+		{
+			if (startRect.top() == endRect.top())
+			{
+				painter.fillRect(QRect(startRect.topLeft(), QPoint(endRect.left(), startRect.bottom())), selectionColor);
+			}
+			else
+			{
+				painter.fillRect(QRect(startRect.topLeft(), QPoint(right, startRect.bottom())), selectionColor);
+				painter.fillRect(QRect(QPoint(0, startRect.bottom() + 1), QPoint(right, endRect.top() - 1)), selectionColor);
+				painter.fillRect(QRect(endRect.topLeft() - QPoint(endRect.left(), 0), endRect.bottomLeft()), selectionColor);
+			}
+		}
+		painter.fillRect(QRect(endRect.left(), endRect.top(), 2, endRect.height()), palette().color(QPalette::Text));
+	}
+}
 
+int MdiChild::bracketAtCursor() const
+{
+	//优先取光标后面的括号，其次是光标前面的
+	int position = textCursor().position();
+	QChar after = document()->characterAt(position);
+	if (BracketIndex::isOpening(after) || BracketIndex::isClosing(after))
+	{
+		return position;
+	}
+	QChar before = document()->characterAt(position - 1);
+	if (position > 0 && (BracketIndex::isOpening(before) || BracketIndex::isClosing(before)))
+	{
+		return position - 1;
+	}
+	return -1;
+}
 
+void MdiChild::matchBrackets()
+{
+	if (dormant)
+	{
+		return;
+	}
+	QList<QTextEdit::ExtraSelection> selections;
+	int bracket = bracketIndex->isReady() && !textCursor().hasSelection() ? bracketAtCursor() : -1;
+	if (bracket >= 0)
+	{
+		//找到匹配时用绿色标出两个括号，否则用红色标出不配对的括号
+		int match = bracketIndex->match(bracket);
+		QTextEdit::ExtraSelection selection;
+		selection.format.setBackground(match >= 0 ? QColor(180, 238, 180) : QColor(255, 180, 180));
+		selection.cursor = QTextCursor(document());
+		selection.cursor.setPosition(bracket);
+		selection.cursor.setPosition(bracket + 1, QTextCursor::KeepAnchor);
+		selections.append(selection);
+		if (match >= 0)
+		{
+			selection.cursor.setPosition(match);
+			selection.cursor.setPosition(match + 1, QTextCursor::KeepAnchor);
+			selections.append(selection);
+		}
+	}
+	setExtraSelections(selections);
+}
+
+bool MdiChild::gotoMatchingBracket()
+{
+	int bracket = bracketIndex->isReady() ? bracketAtCursor() : -1;
+	int match = bracket >= 0 ? bracketIndex->match(bracket) : -1;
+	if (match < 0)
+	{
+		return false;
+	}
+	//跳到右括号时光标放在它后面，跳到左括号时放在它前面
+	QTextCursor cursor = textCursor();
+	cursor.setPosition(match > bracket ? match + 1 : match);
+	setTextCursor(cursor);
+	return true;
+}
 
+void MdiChild::foldAtCursor()
+{
+	if (!bracketIndex->isReady())
+	{
+		return;
+	}
+	QTextBlock block = textCursor().block();
+	BlockData *data = BlockData::get(block);
+	int end = bracketIndex->foldEnd(block);
+	//隐藏两个括号之间的行，右括号所在的行保持可见
+	int count = end - block.blockNumber() - 1;
+	if (end < 0 || count <= 0 || data->foldedLines > 0)
+	{
+		return;
+	}
+	data->foldedLines = count;
+	setLinesVisible(block.next(), count, false);
+}
+
+void MdiChild::unfoldAtCursor()
+{
+	QTextBlock block = textCursor().block();
+	BlockData *data = BlockData::get(block);
+	if (data->foldedLines == 0)
+	{
+		return;
+	}
+	int count = data->foldedLines;
+	data->foldedLines = 0;
+	setLinesVisible(block.next(), count, true);
+}
+
+void MdiChild::unfoldAll()
+{
+	bool changed = false;
+	for (QTextBlock block = document()->begin(); block.isValid(); block = block.next())
+	{
+		BlockData *data = static_cast<BlockData *>(block.userData());
+		if (data && data->foldedLines > 0)
+		{
+			data->foldedLines = 0;
+		}
+		if (!block.isVisible())
+		{
+			block.setVisible(true);
+			changed = true;
+		}
+	}
+	if (changed)
+	{
+		document()->markContentsDirty(0, document()->characterCount());
+		viewport()->update();
+	}
+}
+
+void MdiChild::setLinesVisible(QTextBlock first, int count, bool visible)
+{
+	int start = first.position();
+	int end = start;
+	QTextBlock block = first;
+	for (int i = 0; i < count && block.isValid(); ++i, block = block.next())
+	{
+		block.setVisible(visible);
+		end = block.position() + block.length();
+		//展开时内层仍处于折叠状态的范围保持隐藏，直接跳过
+		BlockData *data = static_cast<BlockData *>(block.userData());
+		if (visible && data && data->foldedLines > 0)
+		{
+			for (int hidden = 0; hidden < data->foldedLines && block.next().isValid(); ++hidden, ++i)
+			{
+				block = block.next();
+			}
+		}
+	}
+	//可见性改变后要让布局重新计算这些行
+	document()->markContentsDirty(start, end - start);
+	viewport()->update();
+}
 
+void MdiChild::paintFoldMarkers()
+{
+	//只检查可见的行，跳过折叠的范围
+	QPainter painter(viewport());
+	QFontMetrics metrics(font());
+	QString marker = QString::fromLocal8Bit(" … ");
+	QColor color = palette().color(QPalette::Mid);
+	for (QTextBlock block = cursorForPosition(QPoint(0, 0)).block(); block.isValid(); block = block.next())
+	{
+		QTextCursor end(block);
+		end.movePosition(QTextCursor::EndOfBlock);
+		QRect rect = cursorRect(end);
+		if (rect.top() > viewport()->height())
+		{
+			break;
+		}
+		BlockData *data = static_cast<BlockData *>(block.userData());
+		if (!data || data->foldedLines == 0)
+		{
+			continue;
+		}
+		QRect box(rect.left() + 4, rect.top() + 1, metrics.horizontalAdvance(marker), rect.height() - 2);
+		painter.setPen(color);
+		painter.drawRect(box);
+		painter.drawText(box, Qt::AlignCenter, marker);
+		block = document()->findBlockByNumber(block.blockNumber() + data->foldedLines);
+	}
+}
 
+bool MdiChild::completeWord()
+{
+	if (!wordIndex)
+	{
+		return false;
+	}
+	QTextCursor cursor = textCursor();
+	QString line = cursor.block().text();
+	int column = cursor.positionInBlock();
+	int start = column;
+	while (start > 0 && WordIndex::isWordChar(line.at(start - 1)))
+	{
+		--start;
+	}
+	QStringList words = wordIndex->complete(line.mid(start, column - start), 50);
+	if (words.isEmpty())
+	{
+		return false;
+	}
+	completionStart = cursor.block().position() + start;
+	if (words.size() == 1)
+	{
+		insertCompletion(words.first());
+		return true;
+	}
 
+	if (!completer)
+	{
+		//候选已经按出现次数排好序，补全器不再过滤和排序
+		completer = new QCompleter(this);
+		completer->setWidget(this);
+		completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+		completer->setModel(new QStringListModel(completer));
+		connect(completer, SIGNAL(activated(QString)), this, SLOT(insertCompletion(QString)));
+	}
+	static_cast<QStringListModel *>(completer->model())->setStringList(words);
+	QRect rect = cursorRect();
+	rect.setWidth(completer->popup()->sizeHintForColumn(0) + completer->popup()->verticalScrollBar()->sizeHint().width());
+	completer->complete(rect);
+	completer->popup()->setCurrentIndex(completer->model()->index(0, 0));
+	return true;
+}
 
+void MdiChild::insertCompletion(const QString &word)
+{
+	//模糊匹配的候选不一定以已输入的部分开头，整个替换
+	int end = textCursor().position();
+	if (end < completionStart)
+	{
+		return;
+	}
+	replaceRange(completionStart, end, word);
+	QTextCursor cursor = textCursor();
+	cursor.setPosition(completionStart + word.size());
+	setTextCursor(cursor);
+}
 
+void MdiChild::paintMisspellings()
+{
+	if (!spellChecker)
+	{
+		return;
+	}
+	QPainter painter(viewport());
+	painter.setPen(QColor(Qt::red));
+	QTextCursor cursor(document());
+	for (QTextBlock block = cursorForPosition(QPoint(0, 0)).block(); block.isValid(); block = block.next())
+	{
+		if (cursorRect(QTextCursor(block)).top() > viewport()->height())
+		{
+			break;
+		}
+		BlockData *data = static_cast<BlockData *>(block.userData());
+		if (!data || !block.isVisible())
+		{
+			continue;
+		}
+		for (int i = 0; i + 1 < data->misspelled.size(); i += 2)
+		{
+			cursor.setPosition(block.position() + data->misspelled.at(i));
+			QRect start = cursorRect(cursor);
+			cursor.setPosition(block.position() + data->misspelled.at(i) + data->misspelled.at(i + 1));
+			QRect end = cursorRect(cursor);
+			//自动换行把单词拆开时只画第一段
+			int right = start.top() == end.top() ? end.left() : viewport()->width();
+			QPolygon wave;
+			for (int x = start.left(), up = 0; x <= right; x += 2, up ^= 1)
+			{
+				wave << QPoint(x, start.bottom() - 1 - up * 2);
+			}
+			painter.drawPolyline(wave);
+		}
+	}
+}
@@ -9,9 +9,27 @@
 #include <QCloseEvent>
 #include <QPushButton>
 #include <QTextEdit>
+#include <QTextBlock>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QPointer>
+#include "searchengine.h"
+#include "lineindex.h"
+#include "cursorset.h"
+#include "lineoperations.h"
+#include "latencyhistogram.h"
+#include "textfile.h"
 
 #include <QWidget>
 
+class TrigramIndex;
+class QProgressDialog;
+class LazyMimeData;
+class BracketIndex;
+class WordIndex;
+class QCompleter;
+class SpellChecker;
+
 class MdiChild : public QTextEdit
 {
     Q_OBJECT
@@ -19,6 +37,17 @@ class MdiChild : public QTextEdit
 public:
 
     MdiChild();
+    ~MdiChild();
+
+    //一处文本修改：把[start, end)替换为text
+    struct EditOperation
+    {
+        EditOperation() : start(0), end(0) {}
+        EditOperation(int s, int e, const QString &t) : start(s), end(e), text(t) {}
+        int start;
+        int end;
+        QString text;
+    };
 
     void newFile();                             //新建操作
     bool loadFile(const QString &fileName);     //加载文件
@@ -27,19 +56,168 @@ public:
     bool saveFile(const QString &fileName);     //保存文件
     QString userFriendlyCurrentFile();          //提取文件名
     QString currentFile(){return curFile;}      //返回当前文件路径
+    TextFile::Format fileFormat() const { return format; }    //文件的编码和换行符
+
+    bool findNext(const QString &pattern, const SearchEngine::Options &options);   //查找下一个
+    void replaceAll(const QString &pattern, const QString &replacement,
+                    const SearchEngine::Options &options);  //全部替换，在工作线程中计算
+    void replaceRange(int start, int end, const QString &text);    //以一次编辑替换一段文本
+    void applyEdits(const QVector<EditOperation> &edits);          //把多处有序且不重叠的修改合并为一次编辑
+    QString textInRange(int start, int end) const;                 //取出一段纯文本，换行为'\n'
+    int countMatches(const QString &pattern, const SearchEngine::Options &options);  //统计匹配的数量
+    void updateSearchIndex();                   //根据设置和文档大小建立或删除搜索索引
+    void updateSpellCheck();                    //根据设置启用或停用拼写检查
+    qint64 searchIndexMemory() const;           //搜索索引占用的内存，没有索引时为0
+    TextStatistics statistics() const;          //全文的行数、单词数、字符数和字节数
+    TextStatistics selectionStatistics() const; //选中文本的统计
+
+    bool gotoMatchingBracket();                 //光标移到匹配的括号处
+    void foldAtCursor();                        //折叠光标所在行的括号范围
+    void unfoldAtCursor();                      //展开光标所在行的折叠
+    void unfoldAll();                           //展开全部折叠
+
+    void setWordIndex(WordIndex *index) { wordIndex = index; }  //设置共享的单词补全索引
+
+    //休眠：标签页模式下不可见的标签只保留文档和已有的布局，不跟随窗口改变大小重新布局，
+    //也不更新括号高亮等只与显示有关的状态；唤醒时只有宽度变了才重新布局
+    void setDormant(bool dormant);
+    bool isDormant() const { return dormant; }
+    bool completeWord();                        //补全光标前的单词，没有候选时返回false
+
+    //对选中的各行（没有选中时为全文）执行行操作，在工作线程中计算
+    void transformLines(LineOperations::Operation operation, const QString &pattern = QString(),
+                        const SearchEngine::Options &options = SearchEngine::Options());
+
+    void selectNextOccurrence();                //选中下一处相同的文本，并为它添加一个光标
+    void selectAllOccurrences();                //为所有相同的文本各添加一个光标
+    void clearCursors();                        //退出多光标模式
+    int cursorCount() const { return cursors.size(); }  //多光标的数量
+
+    const LatencyHistogram &keyLatency() const { return latency; }  //从按键到画面更新的延迟统计
+    void clearKeyLatency() { latency.clear(); }
+
+    bool hasBlockSelection() const { return columnSelection.active; }    //是否有矩形（列）选区
+    void copyBlock();                           //按矩形形状复制列选区
+    void cutBlock();                            //按矩形形状剪切列选区
+    static const char * BlockMimeType;          //剪贴板中标记矩形文本的格式
+    static const QFont &editorFont();           //编辑器字体，每个进程只解析一次
+    bool isPasting() const { return !pasteBuffer.isEmpty(); }  //是否正在分块粘贴，期间不能撤销和恢复
+
+public slots:
+    //以下操作会修改文档，执行前先保存延迟复制的内容
+    void cut();                                 //剪切，复制的内容立即生成
+    void undo();                                //撤销
+    void redo();                                //恢复
+    void clear();                               //清空
+
+signals:
+    void replaceAllFinished(int count, qint64 elapsed);  //全部替换完成，给出替换次数和耗时
+    void replaceAllFailed(const QString &reason);        //全部替换失败
+    void linesTransformed(int linesBefore, int linesAfter, qint64 elapsed);  //行操作完成
+    void transformLinesFailed(const QString &reason);    //行操作失败
+    void searchIndexReady(qint64 bytes);                 //搜索索引建立完成
+    void statisticsChanged();                            //文档统计发生变化
+    void pastingChanged();                               //分块粘贴开始或结束
 
 protected:
     void closeEvent(QCloseEvent *event);        //关闭事件
 	void contextMenuEvent(QContextMenuEvent * e);	//右键菜单事件
+    void keyPressEvent(QKeyEvent *e);           //按键事件，多光标时批量编辑
+    void mousePressEvent(QMouseEvent *e);       //鼠标按下事件，Ctrl+单击添加光标，Alt+按下开始列选择
+    void mouseMoveEvent(QMouseEvent *e);        //鼠标移动事件，Alt+拖动扩展列选区
+    void mouseReleaseEvent(QMouseEvent *e);     //鼠标释放事件
+    void insertFromMimeData(const QMimeData *source);   //粘贴，矩形文本按列粘贴
+    QMimeData * createMimeDataFromSelection() const;    //复制，大段选区延迟生成剪贴板内容
+    void inputMethodEvent(QInputMethodEvent *e);        //输入法事件
+    void paintEvent(QPaintEvent *e);            //绘制事件，绘制额外的光标和选区
+    void resizeEvent(QResizeEvent *e);          //改变大小事件，休眠时推迟重新布局
 
 private slots:
     void documentWasModified();                 //文档被更改时，窗口显示更改状态标志
+    void replaceAllComputed();                  //工作线程计算完全部替换的结果
+    void linesComputed();                       //工作线程计算完行操作的结果
+    void pasteNextChunk();                      //插入大段粘贴内容的下一块
+    void matchBrackets();                       //高亮光标处的括号及其匹配括号
+    void insertCompletion(const QString &word); //用选中的候选替换光标前的单词
+    void updateVisibleLines();                  //把可见的行告诉拼写检查，优先检查
+    void spellingChecked(int first, int last);  //拼写检查结果更新，重绘可见的部分
+    void shiftCursors(int position, int charsRemoved, int charsAdded);  //文档改变时平移多光标
 
 private:
     bool maybeSave();                            //是否需要保存
     void setCurrentFile(const QString &fileName);   //设置当前文件
+    bool multiCursorKeyPress(QKeyEvent *e);     //多光标模式下处理按键，返回是否已处理
+    bool blockKeyPress(QKeyEvent *e);           //列选择模式下处理按键，返回是否已处理
+    void lineColumnAt(const QPoint &pos, int *line, int *column);  //鼠标位置对应的行号和列号，列可以超出行尾
+    qreal spaceWidth() const;                   //当前字体中空格的宽度，同一种字体只计算一次
+    EditOperation columnEdit(const QTextBlock &line, int startColumn, int endColumn, const QString &text) const;  //替换一行中的若干列，行太短时用空格补齐
+    void blockEdit(int startColumn, int endColumn, const QString &text);   //对矩形选区的每一行做同样的列修改
+    void clearBlockSelection();                 //退出列选择模式
+    void pasteBlock(const QStringList &lines);  //从矩形左上角（或光标处）开始逐行粘贴
+    void startChunkedPaste(const QString &text);    //分块插入大段粘贴内容，期间界面保持响应
+    void finishChunkedPaste();                  //结束分块粘贴
+    int bracketAtCursor() const;                //光标前后的括号位置，没有时为-1
+    void setLinesVisible(QTextBlock first, int count, bool visible);   //显示或隐藏从first开始的count行，已折叠的内层范围保持隐藏
+    void paintFoldMarkers();                    //在折叠行的末尾绘制省略标记
+    void paintMisspellings();                   //在拼错的单词下绘制波浪线
+    void markKeyEvent();                        //记下按键的时间，等显示它的绘制完成后计入延迟统计
+    void prepareEdit(int start, int end);       //即将修改[start, end)，与延迟复制的范围相交时先保存复制的内容
+    QTextCursor findInBlocks(const QVector<QTextBlock> &blocks, const QRegularExpression &re, int from);  //在候选块中查找
     QString curFile;                            //保存当前文件路径
     bool isUntitled;                            //作为当前文件是否被保存到硬盘上的标志
+    TextFile::Format format;                    //打开时识别出的编码和换行符，新文件为默认格式
+
+    QFutureWatcher<SearchEngine::ReplaceResult> * replaceWatcher;   //全部替换的计算任务
+    int replaceRevision;                        //开始计算时的文档版本，用于检测期间是否被修改
+    QElapsedTimer replaceTimer;                 //全部替换的总耗时
+    QFutureWatcher<LineOperations::Result> * lineWatcher;   //行操作的计算任务
+    int lineRevision;                           //开始行操作时的文档版本
+    int lineStart, lineEnd;                     //行操作的范围
+    QElapsedTimer lineTimer;                    //行操作的总耗时
+
+    //大段粘贴：超过LargePasteSize个字符时按PasteChunkSize分块插入
+    enum { LargePasteSize = 4 * 1024 * 1024, PasteChunkSize = 1024 * 1024, PasteProgressSize = 16 * 1024 * 1024 };
+    QString pasteBuffer;                        //剪贴板内容，只取一次
+    int pasteOffset;                            //已插入的字符数
+    int pasteStart, pasteEnd;                   //被粘贴内容替换的选区
+    bool pasteWasReadOnly;                      //粘贴前的只读状态
+    QProgressDialog * pasteProgress;            //粘贴进度，内容较少时不显示
+
+    //大段复制：超过LazyCopySize个字符时剪贴板只记录范围
+    enum { LazyCopySize = 1024 * 1024 };
+    //还依赖本文档的剪贴板数据，被剪贴板替换后自动置空；
+    //X11上鼠标选择也会生成一份（QClipboard::Selection），所以可能同时有多份
+    mutable QList<QPointer<LazyMimeData> > pendingCopies;
+    bool eagerCopy;                             //剪切和拖动时复制的内容马上会被删除，需要立即生成
+    TrigramIndex * searchIndex;                 //三元组搜索索引，小文档或未启用时为空
+    LineIndex * lineIndex;                      //行索引，增量维护文档统计
+    BracketIndex * bracketIndex;                //括号索引，用于括号匹配和折叠
+    WordIndex * wordIndex;                      //所有文档共享的单词补全索引，由主窗口所有
+    SpellChecker * spellChecker;                //后台拼写检查，未启用时为空
+    QCompleter * completer;                     //补全候选列表，第一次补全时创建
+    int completionStart;                        //被补全的单词的起点
+    CursorSet cursors;                          //多光标，少于两个时为普通编辑模式
+    LatencyHistogram latency;                   //输入延迟统计，只在开启测量时记录
+    QElapsedTimer latencyClock;                 //延迟测量的时钟
+    QVector<qint64> pendingKeys;                //还没有被绘制出来的按键时间（纳秒）
+    bool applyingEdits;                         //正在应用批量修改，光标位置由批量修改自己计算
+    bool dormant;                               //是否休眠
+    QSize dormantSize;                          //开始休眠时视口的大小，文档按这个大小布局
+
+    //矩形选区，以行号和列号表示，列可以超出行尾
+    struct BlockSelection
+    {
+        BlockSelection() : active(false), dragging(false), anchorLine(0), anchorColumn(0), line(0), column(0) {}
+        bool active;
+        bool dragging;                          //正在Alt+拖动
+        int anchorLine, anchorColumn;           //起始的行和列
+        int line, column;                       //当前的行和列
+        int firstLine() const { return qMin(anchorLine, line); }
+        int lastLine() const { return qMax(anchorLine, line); }
+        int startColumn() const { return qMin(anchorColumn, column); }
+        int endColumn() const { return qMax(anchorColumn, column); }
+    };
+    BlockSelection columnSelection;
 };
 
 #endif // MDICHILD_H
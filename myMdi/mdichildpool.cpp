@@ -0,0 +1,52 @@
+﻿#include <QTimer>
+#include "mdichildpool.h"
+#include "mdichild.h"
+#include "tracer.h"
+
+MdiChildPool::MdiChildPool(int capacity, QObject *parent) :
+	QObject(parent),
+	capacity(capacity)
+{
+	//零间隔的定时器在事件队列处理完之后才触发，相当于空闲时执行
+	idleTimer = new QTimer(this);
+	idleTimer->setSingleShot(true);
+	idleTimer->setInterval(0);
+	connect(idleTimer, SIGNAL(timeout()), this, SLOT(createOne()));
+}
+
+MdiChildPool::~MdiChildPool()
+{
+	//池中的子窗口还没有父对象
+	qDeleteAll(children);
+}
+
+MdiChild * MdiChildPool::take()
+{
+	MdiChild * child = children.isEmpty() ? create() : children.takeFirst();
+	refill();
+	return child;
+}
+
+void MdiChildPool::refill()
+{
+	if (children.size() < capacity && !idleTimer->isActive())
+	{
+		idleTimer->start();
+	}
+}
+
+void MdiChildPool::createOne()
+{
+	children.append(create());
+	refill();
+}
+
+MdiChild * MdiChildPool::create()
+{
+	TRACE_SCOPE_CATEGORY("MdiChildPool::create", "ui");
+	MdiChild * child = new MdiChild;
+	//提前完成样式初始化，显示时不再需要
+	child->ensurePolished();
+	emit created(child);
+	return child;
+}
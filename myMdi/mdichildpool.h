@@ -0,0 +1,38 @@
+﻿#ifndef MDICHILDPOOL_H
+#define MDICHILDPOOL_H
+#include <QObject>
+#include <QList>
+
+class MdiChild;
+class QTimer;
+
+//子窗口池：空闲时预先创建几个子窗口，连接好信号并完成样式初始化，
+//新建和打开文件时直接取用，不必在用户操作时才构造编辑器
+class MdiChildPool : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit MdiChildPool(int capacity, QObject *parent = nullptr);
+	~MdiChildPool();
+
+	MdiChild * take();                          //取出一个子窗口，池空时当场创建
+
+signals:
+	void created(MdiChild *child);              //新创建了一个子窗口，接收者在这里连接信号
+
+public slots:
+	void refill();                              //开始在空闲时补充子窗口
+
+private slots:
+	void createOne();                           //补充一个，每次只创建一个，避免长时间占用界面线程
+
+private:
+	MdiChild * create();
+
+	int capacity;                               //池中保留的子窗口数
+	QList<MdiChild *> children;
+	QTimer * idleTimer;
+};
+
+#endif // MDICHILDPOOL_H
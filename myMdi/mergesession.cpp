@@ -0,0 +1,184 @@
+﻿#include <algorithm>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QAbstractTextDocumentLayout>
+#include <QtConcurrent>
+#include "mergesession.h"
+#include "mdichild.h"
+
+MergeSession::MergeSession(QObject *parent) :
+	QObject(parent),
+	syncing(false)
+{
+	watcher = new QFutureWatcher<ThreeWayMerge::Result>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(mergeFinished()));
+}
+
+void MergeSession::start(MdiChild *base, MdiChild *ours, MdiChild *theirs)
+{
+	views[ThreeWayMerge::Base] = base;
+	views[ThreeWayMerge::Ours] = ours;
+	views[ThreeWayMerge::Theirs] = theirs;
+	watcher->setFuture(QtConcurrent::run(&ThreeWayMerge::merge, base->toPlainText(), ours->toPlainText(), theirs->toPlainText()));
+}
+
+void MergeSession::mergeFinished()
+{
+	result = watcher->result();
+	emit mergeReady();
+}
+
+void MergeSession::setMergedView(MdiChild *merged)
+{
+	views[ThreeWayMerge::Merged] = merged;
+	merged->setPlainText(result.merged);
+	merged->document()->setModified(true);
+	result.merged.clear();
+
+	//冲突标记的位置由合并结果中的区域直接给出，不需要再扫描文本
+	QTextDocument * document = merged->document();
+	for (const ThreeWayMerge::Region &region : result.regions)
+	{
+		if (region.type == ThreeWayMerge::Region::Conflict)
+		{
+			conflicts.append(QTextCursor(document->findBlockByNumber(region.start[ThreeWayMerge::Merged])));
+		}
+	}
+
+	//任何一个窗口关闭后会话随之结束
+	for (int side = 0; side < ThreeWayMerge::SideCount; ++side)
+	{
+		if (!views[side])
+		{
+			deleteLater();
+			return;
+		}
+		connect(views[side]->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewScrolled()));
+		connect(views[side], SIGNAL(destroyed()), this, SLOT(deleteLater()));
+	}
+}
+
+bool MergeSession::contains(QObject *view) const
+{
+	for (int side = 0; side < ThreeWayMerge::SideCount; ++side)
+	{
+		if (views[side] == view)
+			return true;
+	}
+	return false;
+}
+
+int MergeSession::topLine(MdiChild *view) const
+{
+	return view->cursorForPosition(QPoint(0, 0)).blockNumber();
+}
+
+void MergeSession::scrollToLine(MdiChild *view, int line)
+{
+	QTextBlock block = view->document()->findBlockByNumber(line);
+	if (block.isValid())
+	{
+		view->verticalScrollBar()->setValue(int(view->document()->documentLayout()->blockBoundingRect(block).top()));
+	}
+}
+
+void MergeSession::viewScrolled()
+{
+	if (syncing)
+	{
+		return;
+	}
+	int source = -1;
+	for (int side = 0; side < ThreeWayMerge::SideCount; ++side)
+	{
+		if (views[side] && views[side]->verticalScrollBar() == sender())
+			source = side;
+	}
+	if (source < 0 || result.regions.isEmpty())
+	{
+		return;
+	}
+
+	//找到源窗口顶行所在的区域，其他窗口滚动到同一区域中相同的偏移处
+	int line = topLine(views[source]);
+	const ThreeWayMerge::Region &region = result.regions.at(
+		ThreeWayMerge::regionAt(result.regions, ThreeWayMerge::Side(source), line));
+	int offset = line - region.start[source];
+	syncing = true;
+	for (int side = 0; side < ThreeWayMerge::SideCount; ++side)
+	{
+		if (side != source && views[side])
+		{
+			int length = region.end[side] - region.start[side];
+			scrollToLine(views[side], region.start[side] + qBound(0, offset, qMax(0, length - 1)));
+		}
+	}
+	syncing = false;
+}
+
+bool MergeSession::isConflictAt(const QTextCursor &cursor) const
+{
+	return cursor.block().text().startsWith(QLatin1String("<<<<<<<"));
+}
+
+void MergeSession::selectConflict(int index)
+{
+	MdiChild * merged = views[ThreeWayMerge::Merged];
+	QTextCursor cursor = conflicts.at(index);
+	cursor.movePosition(QTextCursor::StartOfBlock);
+	merged->setTextCursor(cursor);
+	merged->setFocus();
+	scrollToLine(merged, cursor.blockNumber());
+}
+
+bool MergeSession::nextConflict()
+{
+	MdiChild * merged = views[ThreeWayMerge::Merged];
+	if (!merged)
+	{
+		return false;
+	}
+	//光标按位置有序，二分查找当前行之后的第一个冲突；已经解决的冲突从索引中去掉
+	int position = merged->textCursor().block().position() + merged->textCursor().block().length();
+	for (;;)
+	{
+		QVector<QTextCursor>::iterator it = std::lower_bound(conflicts.begin(), conflicts.end(), position,
+			[](const QTextCursor &cursor, int value) { return cursor.position() < value; });
+		if (it == conflicts.end())
+		{
+			return false;
+		}
+		if (isConflictAt(*it))
+		{
+			selectConflict(int(it - conflicts.begin()));
+			return true;
+		}
+		conflicts.erase(it);
+	}
+}
+
+bool MergeSession::previousConflict()
+{
+	MdiChild * merged = views[ThreeWayMerge::Merged];
+	if (!merged)
+	{
+		return false;
+	}
+	int position = merged->textCursor().block().position();
+	for (;;)
+	{
+		QVector<QTextCursor>::iterator it = std::lower_bound(conflicts.begin(), conflicts.end(), position,
+			[](const QTextCursor &cursor, int value) { return cursor.position() < value; });
+		if (it == conflicts.begin())
+		{
+			return false;
+		}
+		--it;
+		if (isConflictAt(*it))
+		{
+			selectConflict(int(it - conflicts.begin()));
+			return true;
+		}
+		conflicts.erase(it);
+	}
+}
@@ -0,0 +1,52 @@
+﻿#ifndef MERGESESSION_H
+#define MERGESESSION_H
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QTextCursor>
+#include <QFutureWatcher>
+#include "threewaymerge.h"
+
+class MdiChild;
+
+//三方合并会话：基础、我方、对方和合并结果四个子窗口共用一个滚动模型，
+//滚动任一窗口时其他窗口滚动到对应的行；冲突的位置用跟随文档修改的光标索引，可以快速跳转
+class MergeSession : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit MergeSession(QObject *parent = nullptr);
+
+	//在工作线程中合并三个窗口的内容，完成后发射mergeReady()
+	void start(MdiChild *base, MdiChild *ours, MdiChild *theirs);
+	void setMergedView(MdiChild *merged);       //把合并结果放入merged窗口，开始同步滚动
+	bool contains(QObject *view) const;         //view是否属于这个会话
+	int conflictCount() const { return conflicts.size(); }
+	qint64 elapsed() const { return result.elapsed; }
+
+public slots:
+	bool nextConflict();                        //跳到合并结果中的下一个冲突
+	bool previousConflict();                    //跳到上一个冲突
+
+signals:
+	void mergeReady();                          //合并计算完成
+
+private slots:
+	void mergeFinished();                       //工作线程合并完成
+	void viewScrolled();                        //某个窗口滚动，同步其他窗口
+
+private:
+	int topLine(MdiChild *view) const;          //窗口中第一个可见的行
+	void scrollToLine(MdiChild *view, int line);
+	bool isConflictAt(const QTextCursor &cursor) const;   //该位置是否还是一个未解决的冲突
+	void selectConflict(int index);
+
+	QPointer<MdiChild> views[ThreeWayMerge::SideCount];
+	ThreeWayMerge::Result result;
+	QVector<QTextCursor> conflicts;             //各个冲突起始处的光标，文档修改时由文档自动调整位置
+	QFutureWatcher<ThreeWayMerge::Result> * watcher;
+	bool syncing;                               //正在同步滚动，忽略由此引起的滚动信号
+};
+
+#endif // MERGESESSION_H
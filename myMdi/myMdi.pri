@@ -8,9 +8,69 @@ message("You are running qmake on a generated .pro file. This may not work!")
 
 
 HEADERS += ./mainwindow.h \
-    ./mdichild.h
+    ./mdichild.h \
+    ./searchengine.h \
+    ./findreplacedialog.h \
+    ./blockdata.h \
+    ./trigramindex.h \
+    ./lineindex.h \
+    ./cursorset.h \
+    ./lineoperations.h \
+    ./lazymimedata.h \
+    ./linediff.h \
+    ./diffview.h \
+    ./threewaymerge.h \
+    ./mergesession.h \
+    ./bracketindex.h \
+    ./wordindex.h \
+    ./dictionary.h \
+    ./spellchecker.h \
+    ./latencyhistogram.h \
+    ./performancedialog.h \
+    ./tracer.h \
+    ./benchmark.h \
+    ./textfile.h \
+    ./batchprocessor.h \
+    ./iconatlas.h \
+    ./singleinstance.h \
+    ./mdichildpool.h \
+    ./windowlist.h \
+    ./quickswitcher.h \
+    ./uistateaggregator.h \
+    ./tabrealizer.h \
+    ./windowlayout.h
 SOURCES += ./main.cpp \
     ./mainwindow.cpp \
-    ./mdichild.cpp
+    ./mdichild.cpp \
+    ./searchengine.cpp \
+    ./findreplacedialog.cpp \
+    ./blockdata.cpp \
+    ./trigramindex.cpp \
+    ./lineindex.cpp \
+    ./cursorset.cpp \
+    ./lineoperations.cpp \
+    ./lazymimedata.cpp \
+    ./linediff.cpp \
+    ./diffview.cpp \
+    ./threewaymerge.cpp \
+    ./mergesession.cpp \
+    ./bracketindex.cpp \
+    ./wordindex.cpp \
+    ./dictionary.cpp \
+    ./spellchecker.cpp \
+    ./latencyhistogram.cpp \
+    ./performancedialog.cpp \
+    ./tracer.cpp \
+    ./benchmark.cpp \
+    ./textfile.cpp \
+    ./batchprocessor.cpp \
+    ./iconatlas.cpp \
+    ./singleinstance.cpp \
+    ./mdichildpool.cpp \
+    ./windowlist.cpp \
+    ./quickswitcher.cpp \
+    ./uistateaggregator.cpp \
+    ./tabrealizer.cpp \
+    ./windowlayout.cpp
 FORMS += ./mainwindow.ui
 RESOURCES += mymdi.qrc
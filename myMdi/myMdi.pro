@@ -5,9 +5,9 @@
 TEMPLATE = app
 TARGET = myMdi
 DESTDIR = ../x64/Debug
-QT += core gui widgets
+QT += core gui widgets concurrent network
 CONFIG += debug
-DEFINES += _UNICODE _ENABLE_EXTENDED_ALIGNED_STORAGE WIN64 QT_DLL QT_WIDGETS_LIB
+DEFINES += _UNICODE _ENABLE_EXTENDED_ALIGNED_STORAGE WIN64 QT_DLL QT_WIDGETS_LIB QT_CONCURRENT_LIB QT_NETWORK_LIB
 INCLUDEPATH += ./GeneratedFiles \
     . \
     ./GeneratedFiles/$(ConfigurationName)
@@ -17,3 +17,4 @@ OBJECTS_DIR += debug
 UI_DIR += ./GeneratedFiles
 RCC_DIR += ./GeneratedFiles
 include(myMdi.pri)
+win32: LIBS += -lshell32
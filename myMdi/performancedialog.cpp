@@ -0,0 +1,145 @@
+﻿#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "performancedialog.h"
+
+//微秒转为毫秒显示
+static QString millis(qint64 micros)
+{
+	return QString::number(micros / 1000.0, 'f', 2);
+}
+
+PerformanceDialog::PerformanceDialog(QWidget *parent) :
+	QDialog(parent)
+{
+	setWindowTitle(QString::fromLocal8Bit("性能"));
+	resize(640, 320);
+
+	table = new QTableWidget(0, 6, this);
+	table->setHorizontalHeaderLabels(QStringList()
+		<< QString::fromLocal8Bit("文档") << QString::fromLocal8Bit("按键数")
+		<< QString::fromLocal8Bit("p50(毫秒)") << QString::fromLocal8Bit("p99(毫秒)")
+		<< QString::fromLocal8Bit("最大(毫秒)") << QString::fromLocal8Bit("平均(毫秒)"));
+	table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+	table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	table->verticalHeader()->hide();
+
+	QPushButton * refreshBtn = new QPushButton(QString::fromLocal8Bit("刷新（&R）"), this);
+	QPushButton * clearBtn = new QPushButton(QString::fromLocal8Bit("清除（&L）"), this);
+	QPushButton * csvBtn = new QPushButton(QString::fromLocal8Bit("导出CSV（&C）..."), this);
+	QPushButton * jsonBtn = new QPushButton(QString::fromLocal8Bit("导出JSON（&J）..."), this);
+	QPushButton * closeBtn = new QPushButton(QString::fromLocal8Bit("关闭"), this);
+
+	QVBoxLayout * layout = new QVBoxLayout(this);
+	layout->addWidget(new QLabel(QString::fromLocal8Bit("从按键到显示出结果的延迟，包括布局、高亮和状态栏的更新："), this));
+	layout->addWidget(table);
+	uiUpdateLabel = new QLabel(this);
+	uiUpdateLabel->setWordWrap(true);
+	layout->addWidget(uiUpdateLabel);
+	QHBoxLayout * buttonLayout = new QHBoxLayout;
+	buttonLayout->addWidget(refreshBtn);
+	buttonLayout->addWidget(clearBtn);
+	buttonLayout->addStretch();
+	buttonLayout->addWidget(csvBtn);
+	buttonLayout->addWidget(jsonBtn);
+	buttonLayout->addWidget(closeBtn);
+	layout->addLayout(buttonLayout);
+
+	connect(refreshBtn, SIGNAL(clicked()), this, SIGNAL(refreshRequested()));
+	connect(clearBtn, SIGNAL(clicked()), this, SIGNAL(clearRequested()));
+	connect(csvBtn, SIGNAL(clicked()), this, SLOT(exportCsv()));
+	connect(jsonBtn, SIGNAL(clicked()), this, SLOT(exportJson()));
+	connect(closeBtn, SIGNAL(clicked()), this, SLOT(close()));
+}
+
+void PerformanceDialog::setRows(const QList<Row> &rows)
+{
+	current = rows;
+	table->setRowCount(rows.size());
+	for (int i = 0; i < rows.size(); ++i)
+	{
+		const LatencyHistogram &latency = rows.at(i).latency;
+		table->setItem(i, 0, new QTableWidgetItem(rows.at(i).document));
+		table->setItem(i, 1, new QTableWidgetItem(QString::number(latency.count())));
+		table->setItem(i, 2, new QTableWidgetItem(millis(latency.percentile(50))));
+		table->setItem(i, 3, new QTableWidgetItem(millis(latency.percentile(99))));
+		table->setItem(i, 4, new QTableWidgetItem(millis(latency.maximum())));
+		table->setItem(i, 5, new QTableWidgetItem(millis(latency.mean())));
+	}
+}
+
+void PerformanceDialog::setUiUpdateSummary(const QString &summary)
+{
+	uiUpdateLabel->setText(QString::fromLocal8Bit("界面状态的更新次数/请求次数：") + summary);
+}
+
+void PerformanceDialog::exportCsv()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, QString::fromLocal8Bit("导出CSV"),
+		"latency.csv", QString::fromLocal8Bit("CSV文件 (*.csv)"));
+	if (fileName.isEmpty())
+	{
+		return;
+	}
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly | QFile::Text))
+	{
+		QMessageBox::warning(this, QString::fromLocal8Bit("导出CSV"), file.errorString());
+		return;
+	}
+	QTextStream out(&file);
+	out.setCodec("UTF-8");
+	out << "document,count,p50_us,p99_us,max_us,mean_us\n";
+	for (const Row &row : current)
+	{
+		QString name = row.document;
+		name.replace('"', "\"\"");
+		out << '"' << name << "\"," << row.latency.count() << ',' << row.latency.percentile(50) << ','
+			<< row.latency.percentile(99) << ',' << row.latency.maximum() << ',' << row.latency.mean() << '\n';
+	}
+}
+
+void PerformanceDialog::exportJson()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, QString::fromLocal8Bit("导出JSON"),
+		"latency.json", QString::fromLocal8Bit("JSON文件 (*.json)"));
+	if (fileName.isEmpty())
+	{
+		return;
+	}
+	QJsonArray documents;
+	for (const Row &row : current)
+	{
+		QJsonObject object;
+		object["document"] = row.document;
+		object["count"] = row.latency.count();
+		object["p50_us"] = row.latency.percentile(50);
+		object["p99_us"] = row.latency.percentile(99);
+		object["max_us"] = row.latency.maximum();
+		object["mean_us"] = row.latency.mean();
+		//各个非空桶：[上界（微秒）, 次数]
+		QJsonArray buckets;
+		for (const QPair<qint64, qint64> &bucket : row.latency.buckets())
+			buckets.append(QJsonArray() << bucket.first << bucket.second);
+		object["buckets"] = buckets;
+		documents.append(object);
+	}
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly))
+	{
+		QMessageBox::warning(this, QString::fromLocal8Bit("导出JSON"), file.errorString());
+		return;
+	}
+	QJsonObject root;
+	root["documents"] = documents;
+	file.write(QJsonDocument(root).toJson());
+}
@@ -0,0 +1,41 @@
+﻿#ifndef PERFORMANCEDIALOG_H
+#define PERFORMANCEDIALOG_H
+#include <QDialog>
+#include <QList>
+#include "latencyhistogram.h"
+
+class QTableWidget;
+class QLabel;
+
+//性能对话框：列出每个文档从按键到画面更新的延迟统计，可以导出为CSV或JSON
+class PerformanceDialog : public QDialog
+{
+	Q_OBJECT
+
+public:
+	explicit PerformanceDialog(QWidget *parent = nullptr);
+
+	//一个文档的延迟统计
+	struct Row
+	{
+		QString document;
+		LatencyHistogram latency;
+	};
+	void setRows(const QList<Row> &rows);       //显示各文档的统计
+	void setUiUpdateSummary(const QString &summary);    //显示界面状态的更新数和请求数
+
+signals:
+	void refreshRequested();                    //请求重新收集统计
+	void clearRequested();                      //请求清除所有文档的统计
+
+private slots:
+	void exportCsv();                           //导出为CSV
+	void exportJson();                          //导出为JSON，包含直方图的各个桶
+
+private:
+	QTableWidget * table;
+	QLabel * uiUpdateLabel;                     //界面状态更新的合并情况
+	QList<Row> current;                         //当前显示的统计，导出时使用
+};
+
+#endif // PERFORMANCEDIALOG_H
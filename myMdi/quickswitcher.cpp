@@ -0,0 +1,219 @@
+﻿#include <algorithm>
+#include <QVBoxLayout>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QKeyEvent>
+#include <QFileInfo>
+#include <QDir>
+#include <QApplication>
+#include "quickswitcher.h"
+#include "tracer.h"
+
+QuickSwitcher::QuickSwitcher(QWidget *parent) :
+	QFrame(parent, Qt::Popup)
+{
+	setFrameStyle(QFrame::StyledPanel | QFrame::Raised);
+	edit = new QLineEdit;
+	edit->setPlaceholderText(QString::fromLocal8Bit("输入文件名或路径的一部分"));
+	edit->installEventFilter(this);
+	list = new QListWidget;
+	list->setUniformItemSizes(true);
+	QVBoxLayout * layout = new QVBoxLayout(this);
+	layout->setContentsMargins(4, 4, 4, 4);
+	layout->addWidget(edit);
+	layout->addWidget(list);
+
+	connect(edit, SIGNAL(textChanged(QString)), this, SLOT(filter(QString)));
+	connect(edit, SIGNAL(returnPressed()), this, SLOT(activate()));
+	connect(list, SIGNAL(itemActivated(QListWidgetItem *)), this, SLOT(activate()));
+}
+
+void QuickSwitcher::clear()
+{
+	candidates.clear();
+	matches.clear();
+	lastQuery.clear();
+}
+
+void QuickSwitcher::addWindow(QMdiSubWindow *window, const QString &name, const QString &path)
+{
+	Candidate candidate;
+	candidate.name = name;
+	candidate.path = QDir::toNativeSeparators(path);
+	candidate.lowerName = lowerCase(name);
+	candidate.lowerPath = lowerCase(candidate.path);
+	candidate.mask = charMask(candidate.lowerName) | charMask(candidate.lowerPath);
+	candidate.window = window;
+	candidates.append(candidate);
+}
+
+void QuickSwitcher::addFile(const QString &path)
+{
+	addWindow(nullptr, QFileInfo(path).fileName(), path);
+}
+
+void QuickSwitcher::popup()
+{
+	QWidget * owner = parentWidget();
+	resize(qMax(400, owner->width() / 2), qMin(400, owner->height() - 40));
+	move(owner->mapToGlobal(QPoint((owner->width() - width()) / 2, 30)));
+	edit->clear();
+	filter(QString());
+	show();
+	edit->setFocus();
+}
+
+QString QuickSwitcher::lowerCase(const QString &text)
+{
+	//QString::toLower()可能改变长度（如U+0130），match()要用同一个下标访问原文
+	QString lower = text;
+	for (QChar &c : lower)
+	{
+		c = c.toLower();
+	}
+	return lower;
+}
+
+quint64 QuickSwitcher::charMask(const QString &lower)
+{
+	//字母和数字各占一位，其他字符按编码分到剩下的位中
+	quint64 mask = 0;
+	for (QChar c : lower)
+	{
+		ushort u = c.unicode();
+		int bit = u >= 'a' && u <= 'z' ? u - 'a' : u >= '0' && u <= '9' ? 26 + u - '0' : 36 + u % 28;
+		mask |= quint64(1) << bit;
+	}
+	return mask;
+}
+
+int QuickSwitcher::match(const QString &query, const QString &lower, const QString &text)
+{
+	//按顺序逐个查找查询中的字符，连续的字符和单词开头的字符得分更高
+	int score = 0;
+	int from = 0;
+	int last = -2;
+	for (QChar c : query)
+	{
+		int i = lower.indexOf(c, from);
+		if (i < 0)
+		{
+			return -1;
+		}
+		score += 1;
+		if (i == last + 1)
+			score += 5;
+		if (i == 0 || !text.at(i - 1).isLetterOrNumber() || (text.at(i - 1).isLower() && text.at(i).isUpper()))
+			score += 8;
+		last = i;
+		from = i + 1;
+	}
+	//同样的匹配，文本越短越好
+	return score * 16 - qMin(15, text.size() / 8);
+}
+
+int QuickSwitcher::score(const Candidate &candidate, const QString &query) const
+{
+	//文件名中的匹配优先于路径中的匹配，打开的窗口优先于最近的文件
+	int bonus = candidate.window ? 8 : 0;
+	int nameScore = match(query, candidate.lowerName, candidate.name);
+	if (nameScore >= 0)
+	{
+		return nameScore * 2 + bonus;
+	}
+	int pathScore = match(query, candidate.lowerPath, candidate.path);
+	return pathScore >= 0 ? pathScore + bonus : -1;
+}
+
+void QuickSwitcher::filter(const QString &text)
+{
+	TRACE_SCOPE_CATEGORY("QuickSwitcher::filter", "ui");
+	QString query = lowerCase(text).remove(QLatin1Char(' '));
+	quint64 queryMask = charMask(query);
+
+	//查询变长时，匹配的候选项只会变少
+	QVector<int> pool;
+	if (!lastQuery.isEmpty() && query.startsWith(lastQuery))
+	{
+		pool = matches;
+	}
+	else
+	{
+		pool.resize(candidates.size());
+		for (int i = 0; i < pool.size(); ++i)
+			pool[i] = i;
+	}
+
+	QVector<QPair<int, int> > ranked;           //得分取负，和候选项下标一起排序
+	matches.clear();
+	for (int index : pool)
+	{
+		const Candidate &candidate = candidates.at(index);
+		if ((candidate.mask & queryMask) != queryMask)
+			continue;
+		int value = query.isEmpty() ? 0 : score(candidate, query);
+		if (value < 0)
+			continue;
+		matches.append(index);
+		ranked.append(qMakePair(-value, index));
+	}
+	lastQuery = query;
+
+	//只需要前面的结果有序
+	int count = qMin<int>(MaxResults, ranked.size());
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+
+	list->setUpdatesEnabled(false);
+	list->clear();
+	for (int i = 0; i < count; ++i)
+	{
+		const Candidate &candidate = candidates.at(ranked.at(i).second);
+		QString label = candidate.path.isEmpty() || candidate.path == candidate.name ? candidate.name
+			: QString("%1    %2").arg(candidate.name, candidate.path);
+		if (!candidate.window)
+			label += QString::fromLocal8Bit("    （最近）");
+		QListWidgetItem * item = new QListWidgetItem(label, list);
+		item->setData(Qt::UserRole, ranked.at(i).second);
+	}
+	list->setCurrentRow(0);
+	list->setUpdatesEnabled(true);
+}
+
+void QuickSwitcher::activate()
+{
+	QListWidgetItem * item = list->currentItem();
+	hide();
+	if (!item)
+	{
+		return;
+	}
+	const Candidate &candidate = candidates.at(item->data(Qt::UserRole).toInt());
+	if (candidate.window)
+		emit windowSelected(candidate.window);
+	else
+		emit fileSelected(candidate.path);
+}
+
+bool QuickSwitcher::eventFilter(QObject *watched, QEvent *event)
+{
+	if (watched == edit && event->type() == QEvent::KeyPress)
+	{
+		QKeyEvent * key = static_cast<QKeyEvent *>(event);
+		switch (key->key())
+		{
+		case Qt::Key_Up:
+		case Qt::Key_Down:
+		case Qt::Key_PageUp:
+		case Qt::Key_PageDown:
+			//方向键交给列表，焦点留在输入框
+			QApplication::sendEvent(list, event);
+			return true;
+		case Qt::Key_Escape:
+			hide();
+			return true;
+		default:
+			break;
+		}
+	}
+	return QFrame::eventFilter(watched, event);
+}
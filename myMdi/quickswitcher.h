@@ -0,0 +1,61 @@
+﻿#ifndef QUICKSWITCHER_H
+#define QUICKSWITCHER_H
+#include <QFrame>
+#include <QVector>
+
+class QLineEdit;
+class QListWidget;
+class QMdiSubWindow;
+
+//快速切换（Ctrl+P）：在打开的窗口和最近的文件中模糊匹配文件名和路径。
+//每个候选项在加入时预先计算小写文本和字符集合的位掩码，掩码不包含查询中的全部字符时直接跳过；
+//新的查询是上一次查询的延续时只在上一次匹配的候选项中查找，所以每次按键只需要很少的计算
+class QuickSwitcher : public QFrame
+{
+	Q_OBJECT
+
+public:
+	explicit QuickSwitcher(QWidget *parent);
+
+	void clear();                               //清空候选项
+	void addWindow(QMdiSubWindow *window, const QString &name, const QString &path);  //打开的窗口
+	void addFile(const QString &path);          //最近的文件，选中时打开
+	void popup();                               //显示在父窗口顶部的中间
+
+signals:
+	void windowSelected(QMdiSubWindow *window);
+	void fileSelected(const QString &fileName);
+
+protected:
+	bool eventFilter(QObject *watched, QEvent *event);  //输入框中的方向键移动选择
+
+private slots:
+	void filter(const QString &text);           //按新的查询重新排序
+	void activate();                            //切换到当前选中的候选项
+
+private:
+	struct Candidate
+	{
+		QString name;                           //文件名或窗口标题
+		QString path;
+		QString lowerName;                      //逐个字符转为小写，长度与原文相同
+		QString lowerPath;
+		quint64 mask;                           //名称和路径中出现的字符
+		QMdiSubWindow * window;                 //最近的文件为空
+	};
+
+	static QString lowerCase(const QString &text);  //逐个字符转小写，不改变长度
+	static quint64 charMask(const QString &lower);
+	static int match(const QString &query, const QString &lower, const QString &text);    //按子序列匹配的得分，不匹配时为-1
+	int score(const Candidate &candidate, const QString &query) const;
+
+	enum { MaxResults = 50 };                   //列表中最多显示的结果数
+
+	QVector<Candidate> candidates;
+	QVector<int> matches;                       //匹配上一次查询的候选项
+	QString lastQuery;
+	QLineEdit * edit;
+	QListWidget * list;
+};
+
+#endif // QUICKSWITCHER_H
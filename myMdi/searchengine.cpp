@@ -0,0 +1,191 @@
+﻿#include <QElapsedTimer>
+#include <QStringMatcher>
+#include "searchengine.h"
+#include "tracer.h"
+
+QRegularExpression SearchEngine::compile(const QString &pattern, const Options &options)
+{
+	//非正则模式下将模式转义为字面匹配
+	QString source = options.useRegex ? pattern : QRegularExpression::escape(pattern);
+
+	//让^和$匹配每一行的开头和结尾，与QTextDocument::find()按行查找的行为保持一致
+	QRegularExpression::PatternOptions patternOptions = QRegularExpression::MultilineOption;
+	if (!options.caseSensitive)
+	{
+		patternOptions |= QRegularExpression::CaseInsensitiveOption;
+	}
+	return QRegularExpression(source, patternOptions);
+}
+
+SearchEngine::ReplaceResult SearchEngine::replaceAll(const QString &text, const QString &pattern,
+	const QString &replacement, const Options &options)
+{
+	TRACE_SCOPE_CATEGORY("SearchEngine::replaceAll", "search");
+	ReplaceResult result;
+	QElapsedTimer timer;
+	timer.start();
+
+	if (pattern.isEmpty())
+	{
+		return result;
+	}
+
+	//输出只保存第一处匹配到最后一处匹配之间的文本
+	QString out;
+	int last = -1;
+
+	if (!options.useRegex)
+	{
+		//字面查找使用QStringMatcher，避免正则引擎的开销
+		QStringMatcher matcher(pattern, options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+		int pos = matcher.indexIn(text, 0);
+		if (pos >= 0)
+		{
+			result.start = pos;
+			last = pos;
+			out.reserve(text.size() - pos);
+		}
+		while (pos >= 0)
+		{
+			out.append(text.midRef(last, pos - last));
+			out.append(replacement);
+			last = pos + pattern.size();
+			++result.count;
+			pos = matcher.indexIn(text, last);
+		}
+	}
+	else
+	{
+		QRegularExpression re = compile(pattern, options);
+		if (!re.isValid())
+		{
+			result.error = re.errorString();
+			result.elapsed = timer.elapsed();
+			return result;
+		}
+
+		//替换模板只解析一次，之后每处匹配直接展开
+		QVector<ReplacementPart> parts = parseReplacement(replacement);
+		QRegularExpressionMatchIterator it = re.globalMatch(text);
+		while (it.hasNext())
+		{
+			QRegularExpressionMatch match = it.next();
+			if (last < 0)
+			{
+				result.start = match.capturedStart();
+				last = result.start;
+				out.reserve(text.size() - last);
+			}
+			out.append(text.midRef(last, match.capturedStart() - last));
+			appendExpanded(out, parts, match);
+			last = match.capturedEnd();
+			++result.count;
+		}
+	}
+
+	if (result.count > 0)
+	{
+		result.end = last;
+		result.text = out;
+	}
+	result.elapsed = timer.elapsed();
+	return result;
+}
+
+QVector<SearchEngine::ReplacementPart> SearchEngine::parseReplacement(const QString &replacement)
+{
+	QVector<ReplacementPart> parts;
+	QString literal;
+
+	//把当前累积的字面文本保存为一段
+	auto flushLiteral = [&]()
+	{
+		if (!literal.isEmpty())
+		{
+			ReplacementPart part;
+			part.literal = literal;
+			part.group = -1;
+			parts.append(part);
+			literal.clear();
+		}
+	};
+	auto addGroup = [&](int group, const QString &name)
+	{
+		flushLiteral();
+		ReplacementPart part;
+		part.group = group;
+		part.name = name;
+		parts.append(part);
+	};
+
+	for (int i = 0; i < replacement.size(); ++i)
+	{
+		QChar c = replacement.at(i);
+		QChar next = (i + 1 < replacement.size()) ? replacement.at(i + 1) : QChar();
+		if (c == QLatin1Char('\\') && !next.isNull())
+		{
+			//\1到\9引用捕获组，\n和\t为换行和制表符，其他字符原样输出
+			++i;
+			if (next.isDigit())
+				addGroup(next.digitValue(), QString());
+			else if (next == QLatin1Char('n'))
+				literal.append(QLatin1Char('\n'));
+			else if (next == QLatin1Char('t'))
+				literal.append(QLatin1Char('\t'));
+			else
+				literal.append(next);
+		}
+		else if (c == QLatin1Char('$') && next.isDigit())
+		{
+			//$0到$99引用捕获组
+			int group = next.digitValue();
+			++i;
+			if (i + 1 < replacement.size() && replacement.at(i + 1).isDigit())
+			{
+				group = group * 10 + replacement.at(i + 1).digitValue();
+				++i;
+			}
+			addGroup(group, QString());
+		}
+		else if (c == QLatin1Char('$') && next == QLatin1Char('{'))
+		{
+			//${name}引用命名捕获组
+			int close = replacement.indexOf(QLatin1Char('}'), i + 2);
+			if (close < 0)
+			{
+				literal.append(c);
+				continue;
+			}
+			QString name = replacement.mid(i + 2, close - i - 2);
+			bool isNumber = false;
+			int group = name.toInt(&isNumber);
+			addGroup(isNumber ? group : 0, isNumber ? QString() : name);
+			i = close;
+		}
+		else if (c == QLatin1Char('$') && next == QLatin1Char('$'))
+		{
+			literal.append(c);
+			++i;
+		}
+		else
+		{
+			literal.append(c);
+		}
+	}
+	flushLiteral();
+	return parts;
+}
+
+void SearchEngine::appendExpanded(QString &out, const QVector<ReplacementPart> &parts,
+	const QRegularExpressionMatch &match)
+{
+	for (const ReplacementPart &part : parts)
+	{
+		if (part.group < 0)
+			out.append(part.literal);
+		else if (!part.name.isEmpty())
+			out.append(match.capturedRef(part.name));
+		else
+			out.append(match.capturedRef(part.group));
+	}
+}
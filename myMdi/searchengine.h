@@ -0,0 +1,52 @@
+﻿#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+#include <QString>
+#include <QRegularExpression>
+#include <QVector>
+
+//查找替换引擎，只依赖纯文本，可以在工作线程中运行
+class SearchEngine
+{
+public:
+	//查找选项
+	struct Options
+	{
+		Options() : useRegex(false), caseSensitive(true) {}
+		bool useRegex;          //是否使用正则表达式
+		bool caseSensitive;     //是否区分大小写
+	};
+
+	//全部替换的结果，只包含从第一处匹配到最后一处匹配之间的区间，
+	//这样应用到文档时只需要修改这一段文本
+	struct ReplaceResult
+	{
+		ReplaceResult() : start(-1), end(-1), count(0), elapsed(0) {}
+		int start;              //被替换区间的起点
+		int end;                //被替换区间的终点
+		QString text;           //该区间替换后的文本
+		int count;              //替换的次数
+		qint64 elapsed;         //计算耗时（毫秒）
+		QString error;          //出错信息，为空表示成功
+	};
+
+	//根据选项生成正则表达式，非正则模式下对模式进行转义
+	static QRegularExpression compile(const QString &pattern, const Options &options);
+
+	//在text中一次性完成全部替换，正则模式下替换文本支持\1、$1、${name}形式的捕获组引用
+	static ReplaceResult replaceAll(const QString &text, const QString &pattern,
+		const QString &replacement, const Options &options);
+
+private:
+	//替换模板中的一段：字面文本或捕获组引用
+	struct ReplacementPart
+	{
+		QString literal;        //字面文本
+		int group;              //捕获组编号，-1表示字面文本
+		QString name;           //命名捕获组的名称
+	};
+	static QVector<ReplacementPart> parseReplacement(const QString &replacement);
+	static void appendExpanded(QString &out, const QVector<ReplacementPart> &parts,
+		const QRegularExpressionMatch &match);
+};
+
+#endif // SEARCHENGINE_H
@@ -0,0 +1,117 @@
+﻿#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include "singleinstance.h"
+#include "tracer.h"
+
+SingleInstance::SingleInstance(QObject *parent) :
+	QObject(parent),
+	server(new QLocalServer(this))
+{
+	//只允许同一个用户连接
+	server->setSocketOptions(QLocalServer::UserAccessOption);
+	connect(server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+QString SingleInstance::serverName()
+{
+	QByteArray user = qgetenv("USER");
+	if (user.isEmpty())
+		user = qgetenv("USERNAME");
+	return QString("myMdi-%1").arg(QString::fromLatin1(QCryptographicHash::hash(user, QCryptographicHash::Sha1).toHex().left(16)));
+}
+
+bool SingleInstance::listen()
+{
+	if (server->listen(serverName()))
+	{
+		return true;
+	}
+	//上一个实例崩溃后可能留下套接字文件，这时没有进程在监听，删除后再试一次。
+	//两个实例同时启动时另一个可能刚刚开始监听，能连上就说明名字有人在用，不能删除
+	if (server->serverError() == QAbstractSocket::AddressInUseError)
+	{
+		QLocalSocket socket;
+		socket.connectToServer(serverName());
+		if (socket.waitForConnected(500))
+		{
+			socket.abort();
+			return false;
+		}
+		QLocalServer::removeServer(serverName());
+		return server->listen(serverName());
+	}
+	return false;
+}
+
+bool SingleInstance::sendFiles(const QStringList &files, int timeout)
+{
+	TRACE_SCOPE_CATEGORY("SingleInstance::sendFiles", "ipc");
+	QLocalSocket socket;
+	socket.connectToServer(serverName());
+	if (!socket.waitForConnected(timeout))
+	{
+		return false;
+	}
+
+	QByteArray payload;
+	QDataStream out(&payload, QIODevice::WriteOnly);
+	out << files;
+	QByteArray message;
+	QDataStream header(&message, QIODevice::WriteOnly);
+	header << quint32(payload.size());
+	message += payload;
+	socket.write(message);
+	if (!socket.waitForBytesWritten(timeout))
+	{
+		return false;
+	}
+	//等到确认才退出，否则对方可能还没有读到消息
+	return socket.waitForReadyRead(timeout) && socket.read(1) == "1";
+}
+
+void SingleInstance::acceptConnection()
+{
+	while (QLocalSocket * socket = server->nextPendingConnection())
+	{
+		connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+		connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+		//连接时数据可能已经到了
+		if (socket->bytesAvailable() > 0)
+			readRequest(socket);
+	}
+}
+
+void SingleInstance::readRequest()
+{
+	QLocalSocket * socket = qobject_cast<QLocalSocket *>(sender());
+	if (socket)
+		readRequest(socket);
+}
+
+void SingleInstance::readRequest(QLocalSocket *socket)
+{
+	TRACE_SCOPE_CATEGORY("SingleInstance::readRequest", "ipc");
+	//消息没有到齐时留在套接字中，等下一次readyRead
+	if (socket->bytesAvailable() < qint64(sizeof(quint32)))
+	{
+		return;
+	}
+	quint32 size = 0;
+	QDataStream header(socket->peek(sizeof(quint32)));
+	header >> size;
+	if (socket->bytesAvailable() < qint64(sizeof(quint32)) + size)
+	{
+		return;
+	}
+	socket->read(sizeof(quint32));
+	QStringList files;
+	QDataStream in(socket->read(size));
+	in >> files;
+
+	//先确认，让发送方尽快退出，再打开文件
+	socket->write("1");
+	socket->flush();
+	emit filesReceived(files);
+}
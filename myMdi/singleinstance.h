@@ -0,0 +1,37 @@
+﻿#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+
+//单实例：第一个启动的编辑器在本地套接字上监听，之后启动的进程把要打开的文件
+//发给它然后立即退出，不必再创建窗口。消息是4字节长度加上QDataStream序列化的文件列表，
+//收到后先回一个字节的确认再打开文件，所以往返只需要几毫秒
+class SingleInstance : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit SingleInstance(QObject *parent = nullptr);
+
+	bool listen();                              //作为第一个实例开始监听，失败时返回false
+
+	//把文件交给正在运行的实例，成功收到确认时返回true；没有实例在运行时返回false
+	static bool sendFiles(const QStringList &files, int timeout = 1000);
+	static QString serverName();                //每个用户一个名称，不同用户的编辑器互不干扰
+
+signals:
+	void filesReceived(const QStringList &files);   //另一个进程要求打开文件，列表为空时只激活窗口
+
+private slots:
+	void acceptConnection();
+	void readRequest();
+
+private:
+	void readRequest(QLocalSocket *socket);
+	QLocalServer * server;
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,260 @@
+﻿#include <QTextDocument>
+#include <QTextBlock>
+#include <QTimer>
+#include <QHash>
+#include <QtConcurrent>
+#include "spellchecker.h"
+#include "tracer.h"
+#include "blockdata.h"
+
+bool SpellChecker::enabled = false;
+QSharedPointer<Dictionary> SpellChecker::sharedDictionary;
+
+SpellChecker::SpellChecker(QTextDocument *document) :
+	QObject(document),
+	doc(document),
+	batchRevision(0),
+	visibleFirst(0),
+	visibleLast(0),
+	sweepLine(0),
+	sweeping(true)
+{
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	connect(timer, SIGNAL(timeout()), this, SLOT(checkNext()));
+	watcher = new QFutureWatcher<QVector<Checked> >(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(batchFinished()));
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+	timer->start(0);
+}
+
+SpellChecker::~SpellChecker()
+{
+	watcher->waitForFinished();
+	//清除结果，之后重新启用时从头检查
+	for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+	{
+		BlockData * data = static_cast<BlockData *>(block.userData());
+		if (data)
+		{
+			data->spellChecked = false;
+			data->misspelled.clear();
+		}
+	}
+}
+
+bool SpellChecker::isEnabled()
+{
+	return enabled;
+}
+
+void SpellChecker::setEnabled(bool on)
+{
+	enabled = on;
+}
+
+QSharedPointer<Dictionary> SpellChecker::dictionary()
+{
+	return sharedDictionary;
+}
+
+void SpellChecker::setDictionary(QSharedPointer<Dictionary> dictionary)
+{
+	sharedDictionary = dictionary;
+}
+
+void SpellChecker::setVisibleLines(int first, int last)
+{
+	visibleFirst = first;
+	visibleLast = last;
+	if (!watcher->isRunning() && !timer->isActive())
+	{
+		timer->start(0);
+	}
+}
+
+void SpellChecker::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved);
+	//修改范围内的行重新检查，旧的下划线位置已经不对了
+	QTextBlock first = doc->findBlock(position);
+	int end = position + charsAdded;
+	int lines = 0;
+	for (QTextBlock block = first; block.isValid() && block.position() <= end; block = block.next(), ++lines)
+	{
+		BlockData * data = BlockData::get(block);
+		data->spellChecked = false;
+		data->misspelled.clear();
+	}
+
+	//小的修改记下位置优先检查，大段修改交给全文扫描
+	if (lines <= RecentLines)
+	{
+		recent.prepend(QTextCursor(doc));
+		recent.first().setPosition(position);
+		if (recent.size() > RecentEdits)
+			recent.removeLast();
+	}
+	else
+	{
+		sweeping = true;
+		sweepLine = qMin(sweepLine, first.blockNumber());
+	}
+
+	//正在输入时推迟检查
+	if (!watcher->isRunning())
+	{
+		timer->start(EditDelay);
+	}
+}
+
+bool SpellChecker::take(const QTextBlock &block, QVector<Line> &batch, int *chars)
+{
+	BlockData * data = static_cast<BlockData *>(block.userData());
+	if (data && data->spellChecked)
+	{
+		return false;
+	}
+	Line line;
+	line.number = block.blockNumber();
+	line.text = block.text();
+	*chars += line.text.size() + 1;
+	batch.append(line);
+	return *chars >= BatchChars;
+}
+
+void SpellChecker::checkNext()
+{
+	if (!dictionary() || watcher->isRunning())
+	{
+		return;
+	}
+
+	QVector<Line> batch;
+	int chars = 0;
+	bool full = false;
+
+	//可见的行
+	QTextBlock block = doc->findBlockByNumber(visibleFirst);
+	for (; !full && block.isValid() && block.blockNumber() <= visibleLast; block = block.next())
+		full = take(block, batch, &chars);
+
+	//最近修改处附近的行
+	for (int i = 0; !full && i < recent.size(); ++i)
+	{
+		int line = recent.at(i).blockNumber();
+		block = doc->findBlockByNumber(qMax(0, line - RecentLines));
+		for (; !full && block.isValid() && block.blockNumber() <= line + RecentLines; block = block.next())
+			full = take(block, batch, &chars);
+	}
+	if (!full)
+	{
+		recent.clear();
+	}
+
+	//从上次停下的地方继续扫描全文
+	if (!full && sweeping)
+	{
+		block = doc->findBlockByNumber(sweepLine);
+		int scanned = 0;
+		for (; !full && block.isValid() && scanned < ScanLines; block = block.next(), ++scanned)
+			full = take(block, batch, &chars);
+		sweepLine = block.isValid() ? block.blockNumber() : doc->blockCount();
+		if (!block.isValid())
+			sweeping = false;
+	}
+
+	//没有需要检查的行，继续扫描或者等待下一次修改
+	if (batch.isEmpty())
+	{
+		if (sweeping)
+			timer->start(0);
+		return;
+	}
+	batchRevision = doc->revision();
+	watcher->setFuture(QtConcurrent::run(&SpellChecker::check, dictionary(), batch));
+}
+
+QVector<SpellChecker::Checked> SpellChecker::check(QSharedPointer<Dictionary> dictionary, const QVector<Line> &lines)
+{
+	TRACE_SCOPE_CATEGORY("SpellChecker::check", "worker");
+	QVector<Checked> result;
+	result.reserve(lines.size());
+	for (const Line &line : lines)
+	{
+		Checked checked;
+		checked.number = line.number;
+		checked.hash = qHash(line.text);
+		checked.length = line.text.size();
+		const QString &text = line.text;
+		int length = text.size();
+		for (int pos = 0; pos < length; )
+		{
+			if (!text.at(pos).isLetterOrNumber() && text.at(pos) != QLatin1Char('_'))
+			{
+				++pos;
+				continue;
+			}
+			//取出由字母、数字、下划线和词中的撇号组成的一段
+			int start = pos;
+			bool skip = false;
+			int upper = 0;
+			while (pos < length)
+			{
+				QChar c = text.at(pos);
+				if (c == QLatin1Char('\'') && pos + 1 < length && text.at(pos + 1).isLetter() && pos > start)
+				{
+					++pos;
+					continue;
+				}
+				if (!c.isLetterOrNumber() && c != QLatin1Char('_'))
+					break;
+				//含数字、下划线或非拉丁字母的不检查
+				if (!c.isLetter() || c.unicode() > 0x24f)
+					skip = true;
+				if (c.isUpper())
+					++upper;
+				++pos;
+			}
+			//单个字母、全大写的缩写和驼峰命名的标识符不检查
+			int size = pos - start;
+			if (skip || size < 2 || upper > 1 || (upper == 1 && !text.at(start).isUpper()))
+				continue;
+			if (!dictionary->contains(text.mid(start, size)))
+			{
+				checked.misspelled.append(start);
+				checked.misspelled.append(size);
+			}
+		}
+		result.append(checked);
+	}
+	return result;
+}
+
+void SpellChecker::batchFinished()
+{
+	QVector<Checked> result = watcher->result();
+	int first = -1;
+	int last = -1;
+	for (const Checked &checked : result)
+	{
+		//检查期间文档被修改过时，插入或删除行后行号对应的可能是另一行，
+		//块的版本号也可能碰巧相同，所以比较文本本身，对不上的行留到下一批重新检查
+		QTextBlock block = doc->findBlockByNumber(checked.number);
+		if (!block.isValid())
+			continue;
+		if (doc->revision() != batchRevision &&
+			(block.length() != checked.length + 1 || qHash(block.text()) != checked.hash))
+			continue;
+		BlockData * data = BlockData::get(block);
+		data->spellChecked = true;
+		data->misspelled = checked.misspelled;
+		first = first < 0 ? checked.number : qMin(first, checked.number);
+		last = qMax(last, checked.number);
+	}
+	if (first >= 0)
+	{
+		emit linesChecked(first, last);
+	}
+	timer->start(0);
+}
@@ -0,0 +1,77 @@
+﻿#ifndef SPELLCHECKER_H
+#define SPELLCHECKER_H
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include <QTextCursor>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+#include "dictionary.h"
+
+class QTextDocument;
+class QTimer;
+
+//后台拼写检查：文档修改只把涉及的行标记为未检查，并记下修改的位置。
+//每次取一批未检查的行交给工作线程，依次优先取可见的行、最近修改处附近的行，
+//最后才从上次停下的地方继续扫描全文。结果保存在各行的BlockData中，由MdiChild绘制下划线
+class SpellChecker : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit SpellChecker(QTextDocument *document);
+	~SpellChecker();
+
+	static bool isEnabled();                    //是否启用拼写检查
+	static void setEnabled(bool enabled);
+	static QSharedPointer<Dictionary> dictionary();     //所有文档共用的词典
+	static void setDictionary(QSharedPointer<Dictionary> dictionary);
+
+	void setVisibleLines(int first, int last);  //当前可见的行，优先检查
+
+signals:
+	void linesChecked(int first, int last);     //这些行的检查结果已更新
+
+private slots:
+	void documentChanged(int position, int charsRemoved, int charsAdded);
+	void checkNext();                           //取出下一批未检查的行交给工作线程
+	void batchFinished();
+
+private:
+	enum
+	{
+		BatchChars = 32 * 1024,                 //每批最多的字符数
+		ScanLines = 20000,                      //每次最多扫描的行数，避免长时间占用界面线程
+		RecentEdits = 8,                        //记住的最近修改位置
+		RecentLines = 20,                       //最近修改处前后优先检查的行数
+		EditDelay = 300                         //停止输入多久后开始检查（毫秒）
+	};
+	struct Line
+	{
+		int number;
+		QString text;
+	};
+	struct Checked
+	{
+		int number;
+		uint hash;                              //检查的文本的散列值，用来确认结果仍然对应这一行
+		int length;
+		QVector<int> misspelled;                //拼错的单词，依次为起点和长度
+	};
+	static QVector<Checked> check(QSharedPointer<Dictionary> dictionary, const QVector<Line> &lines);
+	bool take(const QTextBlock &block, QVector<Line> &batch, int *chars);
+
+	QTextDocument * doc;
+	QTimer * timer;
+	QFutureWatcher<QVector<Checked> > * watcher;
+	int batchRevision;                          //交给工作线程时的文档版本
+	int visibleFirst, visibleLast;
+	QList<QTextCursor> recent;                  //最近修改的位置，随文档修改自动移动
+	int sweepLine;                              //全文扫描进行到的行
+	bool sweeping;                              //全文还有未检查的行
+
+	static bool enabled;
+	static QSharedPointer<Dictionary> sharedDictionary;
+};
+
+#endif // SPELLCHECKER_H
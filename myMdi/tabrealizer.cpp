@@ -0,0 +1,67 @@
+﻿#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSet>
+#include "tabrealizer.h"
+#include "mdichild.h"
+#include "tracer.h"
+
+TabRealizer::TabRealizer(QMdiArea *area, QObject *parent) :
+	QObject(parent),
+	area(area),
+	enabled(false)
+{
+	connect(area, SIGNAL(subWindowActivated(QMdiSubWindow *)), this, SLOT(windowActivated(QMdiSubWindow *)));
+}
+
+void TabRealizer::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	updateDormancy();
+}
+
+void TabRealizer::windowActivated(QMdiSubWindow *window)
+{
+	if (!window)
+	{
+		return;
+	}
+	recent.removeAll(QPointer<QMdiSubWindow>(window));
+	recent.removeAll(QPointer<QMdiSubWindow>());
+	recent.prepend(window);
+	if (recent.size() > KeepRealized)
+	{
+		recent.erase(recent.begin() + KeepRealized, recent.end());
+	}
+	if (enabled)
+	{
+		updateDormancy();
+	}
+}
+
+void TabRealizer::updateDormancy()
+{
+	TRACE_SCOPE_CATEGORY("TabRealizer::updateDormancy", "ui");
+	QSet<QMdiSubWindow *> keep;
+	for (const QPointer<QMdiSubWindow> &window : recent)
+	{
+		if (window)
+			keep.insert(window);
+	}
+	//先唤醒要显示的标签，再让其余的休眠
+	foreach(QMdiSubWindow * window, area->subWindowList())
+	{
+		MdiChild * child = qobject_cast<MdiChild *>(window->widget());
+		if (child && (!enabled || keep.contains(window)))
+			child->setDormant(false);
+	}
+	if (!enabled)
+	{
+		return;
+	}
+	foreach(QMdiSubWindow * window, area->subWindowList())
+	{
+		MdiChild * child = qobject_cast<MdiChild *>(window->widget());
+		if (child && !keep.contains(window))
+			child->setDormant(true);
+	}
+}
@@ -0,0 +1,36 @@
+﻿#ifndef TABREALIZER_H
+#define TABREALIZER_H
+#include <QObject>
+#include <QList>
+#include <QPointer>
+
+class QMdiArea;
+class QMdiSubWindow;
+
+//标签页模式下只让活动标签和最近使用的几个标签保持完整的编辑器状态，
+//其余标签的MdiChild休眠，主窗口改变大小时不再逐个重新布局文档。
+//切换回休眠的标签时按原来的布局唤醒，窗口宽度没有变化时不需要重新布局
+class TabRealizer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit TabRealizer(QMdiArea *area, QObject *parent = nullptr);
+
+	void setEnabled(bool enabled);              //进入标签页模式时启用，退出时唤醒全部
+	bool isEnabled() const { return enabled; }
+
+	enum { KeepRealized = 3 };                  //保持唤醒的标签数，包括活动标签
+
+private slots:
+	void windowActivated(QMdiSubWindow *window);
+
+private:
+	void updateDormancy();                      //最近使用的几个以外的标签休眠
+
+	QMdiArea * area;
+	QList<QPointer<QMdiSubWindow> > recent;     //按使用顺序，最近的在前
+	bool enabled;
+};
+
+#endif // TABREALIZER_H
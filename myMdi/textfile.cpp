@@ -0,0 +1,239 @@
+﻿#include <QTextCodec>
+#include "textfile.h"
+
+//识别格式时读取的字节数
+static const int DetectSize = 64 * 1024;
+
+TextFile::Format::Format() :
+	codec(QTextCodec::codecForLocale()->name()),
+	bom(false),
+#ifdef Q_OS_WIN
+	eol(CrLf)
+#else
+	eol(Lf)
+#endif
+{
+}
+
+QString TextFile::Format::description() const
+{
+	return QString("%1%2, %3").arg(QString::fromLatin1(codec)).arg(bom ? " BOM" : "")
+		.arg(eol == CrLf ? "CRLF" : eol == Cr ? "CR" : "LF");
+}
+
+TextFile::Format TextFile::detect(const QByteArray &head)
+{
+	Format format;
+	int skip = 0;
+	if (head.startsWith("\xef\xbb\xbf"))
+	{
+		format.codec = "UTF-8";
+		format.bom = true;
+		skip = 3;
+	}
+	else if (head.startsWith("\xff\xfe"))
+	{
+		format.codec = "UTF-16LE";
+		format.bom = true;
+		skip = 2;
+	}
+	else if (head.startsWith("\xfe\xff"))
+	{
+		format.codec = "UTF-16BE";
+		format.bom = true;
+		skip = 2;
+	}
+	else
+	{
+		//没有BOM时能按UTF-8解码就是UTF-8，末尾被截断的半个字符不算错误
+		QTextCodec::ConverterState state;
+		QTextCodec::codecForName("UTF-8")->toUnicode(head.constData(), head.size(), &state);
+		if (state.invalidChars == 0)
+			format.codec = "UTF-8";
+	}
+
+	//以第一个换行符为准，没有换行符的文件使用平台默认
+	QTextCodec * codec = QTextCodec::codecForName(format.codec);
+	QString text = codec->toUnicode(head.constData() + skip, head.size() - skip);
+	for (int i = 0; i < text.size(); ++i)
+	{
+		if (text.at(i) == QLatin1Char('\n'))
+		{
+			format.eol = Lf;
+			break;
+		}
+		if (text.at(i) == QLatin1Char('\r'))
+		{
+			//CR正好在末尾时无法判断，按CRLF处理
+			format.eol = i + 1 < text.size() && text.at(i + 1) != QLatin1Char('\n') ? Cr : CrLf;
+			break;
+		}
+	}
+	return format;
+}
+
+TextFile::Reader::Reader() :
+	decoder(nullptr)
+{
+}
+
+TextFile::Reader::~Reader()
+{
+	delete decoder;
+}
+
+bool TextFile::Reader::open(const QString &fileName, QString *error)
+{
+	file.setFileName(fileName);
+	if (!file.open(QFile::ReadOnly))
+	{
+		if (error)
+			*error = file.errorString();
+		return false;
+	}
+	fileFormat = detect(file.peek(DetectSize));
+	//BOM不作为内容
+	if (fileFormat.bom)
+	{
+		file.read(fileFormat.codec == "UTF-8" ? 3 : 2);
+	}
+	delete decoder;
+	decoder = QTextCodec::codecForName(fileFormat.codec)->makeDecoder(QTextCodec::IgnoreHeader);
+	pending.clear();
+	return true;
+}
+
+bool TextFile::Reader::atEnd() const
+{
+	return file.atEnd() && pending.isEmpty();
+}
+
+QString TextFile::Reader::read(qint64 maxBytes)
+{
+	QString text = pending;
+	pending.clear();
+	QByteArray data = file.read(qMax<qint64>(1, maxBytes));
+	text += decoder->toUnicode(data);
+
+	//这一块在最后一个换行处截断，剩下的留给下一块，这样CRLF不会被拆开
+	if (!file.atEnd())
+	{
+		int cut = text.lastIndexOf(QLatin1Char('\n')) + 1;
+		if (cut == 0 && fileFormat.eol == Cr)
+			cut = qMax(0, text.lastIndexOf(QLatin1Char('\r')));
+		if (cut > 0)
+		{
+			pending = text.mid(cut);
+			text.truncate(cut);
+		}
+		else
+		{
+			//没有换行的超长行整块交出，末尾的CR留到下一块
+			if (text.endsWith(QLatin1Char('\r')))
+			{
+				pending = QStringLiteral("\r");
+				text.chop(1);
+			}
+		}
+	}
+
+	//统一为'\n'，混用的换行符也一起转换
+	if (text.contains(QLatin1Char('\r')))
+	{
+		text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+		text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+	}
+	return text;
+}
+
+TextFile::Writer::Writer() :
+	encoder(nullptr)
+{
+}
+
+TextFile::Writer::~Writer()
+{
+	delete encoder;
+}
+
+bool TextFile::Writer::open(const QString &fileName, const Format &format, QString *error)
+{
+	fileFormat = format;
+	file.setFileName(fileName);
+	if (!file.open(QFile::WriteOnly))
+	{
+		if (error)
+			*error = file.errorString();
+		return false;
+	}
+	QTextCodec * codec = QTextCodec::codecForName(format.codec);
+	if (!codec)
+	{
+		codec = QTextCodec::codecForLocale();
+	}
+	delete encoder;
+	encoder = codec->makeEncoder(format.bom ? QTextCodec::DefaultConversion : QTextCodec::IgnoreHeader);
+	return true;
+}
+
+bool TextFile::Writer::write(const QString &text)
+{
+	if (fileFormat.eol == Lf)
+	{
+		return file.write(encoder->fromUnicode(text)) >= 0;
+	}
+	QString converted = text;
+	converted.replace(QLatin1Char('\n'), fileFormat.eol == CrLf ? QLatin1String("\r\n") : QLatin1String("\r"));
+	return file.write(encoder->fromUnicode(converted)) >= 0;
+}
+
+bool TextFile::Writer::commit(QString *error)
+{
+	if (!file.commit())
+	{
+		if (error)
+			*error = file.errorString();
+		return false;
+	}
+	return true;
+}
+
+void TextFile::Writer::cancel()
+{
+	file.cancelWriting();
+}
+
+bool TextFile::read(const QString &fileName, QString *text, Format *format, QString *error)
+{
+	Reader reader;
+	if (!reader.open(fileName, error))
+	{
+		return false;
+	}
+	text->clear();
+	while (!reader.atEnd())
+	{
+		*text += reader.read(1 << 30);
+	}
+	if (format)
+	{
+		*format = reader.format();
+	}
+	return true;
+}
+
+bool TextFile::write(const QString &fileName, const QString &text, const Format &format, QString *error)
+{
+	Writer writer;
+	if (!writer.open(fileName, format, error))
+	{
+		return false;
+	}
+	if (!writer.write(text))
+	{
+		if (error)
+			*error = QString::fromLocal8Bit("写入失败");
+		return false;
+	}
+	return writer.commit(error);
+}
@@ -0,0 +1,71 @@
+﻿#ifndef TEXTFILE_H
+#define TEXTFILE_H
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
+
+class QTextCodec;
+class QTextDecoder;
+class QTextEncoder;
+
+//文本文件的读写：识别编码（BOM、UTF-8或本地编码）和换行符，读入的文本统一以'\n'换行，
+//写回时还原为原来的编码、BOM和换行符。不依赖界面，编辑器、命令行批处理和工作线程共用。
+//Reader和Writer按块流式处理，不必把整个文件放进内存
+class TextFile
+{
+public:
+	enum Eol { Lf, CrLf, Cr };
+
+	//文件的格式
+	struct Format
+	{
+		Format();                               //新文件的格式：本地编码，平台的换行符
+		QByteArray codec;                       //编码名称
+		bool bom;                               //是否带BOM
+		Eol eol;                                //换行符
+		QString description() const;            //如"UTF-8 BOM, CRLF"，用于显示
+	};
+
+	//按块读取，每块都以完整的行结束
+	class Reader
+	{
+	public:
+		Reader();
+		~Reader();
+		bool open(const QString &fileName, QString *error);
+		QString read(qint64 maxBytes);          //读取约maxBytes字节，换行统一为'\n'
+		bool atEnd() const;
+		Format format() const { return fileFormat; }
+
+	private:
+		QFile file;
+		Format fileFormat;
+		QTextDecoder * decoder;
+		QString pending;                        //上一块中最后一个换行之后的部分
+	};
+
+	//写到临时文件，commit()时才替换目标文件，中途失败不会损坏原文件
+	class Writer
+	{
+	public:
+		Writer();
+		~Writer();
+		bool open(const QString &fileName, const Format &format, QString *error);
+		bool write(const QString &text);        //text以'\n'换行
+		bool commit(QString *error);
+		void cancel();                          //放弃写入，目标文件保持不变
+
+	private:
+		QSaveFile file;
+		Format fileFormat;
+		QTextEncoder * encoder;
+	};
+
+	static bool read(const QString &fileName, QString *text, Format *format, QString *error);
+	static bool write(const QString &fileName, const QString &text, const Format &format, QString *error);
+
+	static Format detect(const QByteArray &head);   //根据文件开头的内容识别格式
+};
+
+#endif // TEXTFILE_H
@@ -0,0 +1,173 @@
+﻿#include <algorithm>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include "threewaymerge.h"
+#include "tracer.h"
+
+namespace
+{
+	void appendLines(QString &out, const QVector<QStringRef> &lines, int start, int end)
+	{
+		for (int i = start; i < end; ++i)
+		{
+			out.append(lines.at(i));
+			out.append(QLatin1Char('\n'));
+		}
+	}
+
+	bool sameLines(const QVector<QStringRef> &a, int aStart, int aEnd,
+		const QVector<QStringRef> &b, int bStart, int bEnd)
+	{
+		if (aEnd - aStart != bEnd - bStart)
+			return false;
+		for (int i = 0; i < aEnd - aStart; ++i)
+		{
+			if (a.at(aStart + i) != b.at(bStart + i))
+				return false;
+		}
+		return true;
+	}
+}
+
+ThreeWayMerge::Result ThreeWayMerge::merge(const QString &base, const QString &ours, const QString &theirs)
+{
+	TRACE_SCOPE_CATEGORY("ThreeWayMerge::merge", "worker");
+	Result result;
+	QElapsedTimer timer;
+	timer.start();
+
+	QVector<QStringRef> lines[Merged];
+	lines[Base] = base.splitRef(QLatin1Char('\n'));
+	lines[Ours] = ours.splitRef(QLatin1Char('\n'));
+	lines[Theirs] = theirs.splitRef(QLatin1Char('\n'));
+
+	//两组差异互不相干，并行计算
+	QFuture<QVector<LineDiff::Hunk> > oursFuture = QtConcurrent::run(&LineDiff::diffLines, lines[Base], lines[Ours]);
+	QVector<LineDiff::Hunk> theirsHunks = LineDiff::diffLines(lines[Base], lines[Theirs]);
+	QVector<LineDiff::Hunk> oursHunks = oursFuture.result();
+
+	//按基础版本的位置扫描，重叠或相邻的差异归为一组
+	int delta[Merged] = { 0, 0, 0 };    //组之前各方相对基础版本多出的行数
+	int baseLine = 0;
+	int mergedLine = 0;
+	int i = 0, j = 0;
+	auto addRegion = [&](Region region)
+	{
+		region.start[Merged] = mergedLine;
+		switch (region.type)
+		{
+		case Region::Unchanged:
+			appendLines(result.merged, lines[Base], region.start[Base], region.end[Base]);
+			mergedLine += region.end[Base] - region.start[Base];
+			break;
+		case Region::OursOnly:
+		case Region::BothSame:
+			appendLines(result.merged, lines[Ours], region.start[Ours], region.end[Ours]);
+			mergedLine += region.end[Ours] - region.start[Ours];
+			break;
+		case Region::TheirsOnly:
+			appendLines(result.merged, lines[Theirs], region.start[Theirs], region.end[Theirs]);
+			mergedLine += region.end[Theirs] - region.start[Theirs];
+			break;
+		case Region::Conflict:
+			result.merged.append(QLatin1String("<<<<<<< ours\n"));
+			appendLines(result.merged, lines[Ours], region.start[Ours], region.end[Ours]);
+			result.merged.append(QLatin1String("||||||| base\n"));
+			appendLines(result.merged, lines[Base], region.start[Base], region.end[Base]);
+			result.merged.append(QLatin1String("=======\n"));
+			appendLines(result.merged, lines[Theirs], region.start[Theirs], region.end[Theirs]);
+			result.merged.append(QLatin1String(">>>>>>> theirs\n"));
+			mergedLine += 4 + (region.end[Ours] - region.start[Ours]) + (region.end[Base] - region.start[Base])
+				+ (region.end[Theirs] - region.start[Theirs]);
+			++result.conflictCount;
+			break;
+		}
+		region.end[Merged] = mergedLine;
+		result.regions.append(region);
+	};
+
+	while (i < oursHunks.size() || j < theirsHunks.size())
+	{
+		bool takeOurs = (j >= theirsHunks.size()) || (i < oursHunks.size() && oursHunks.at(i).oldStart <= theirsHunks.at(j).oldStart);
+		int low = takeOurs ? oursHunks.at(i).oldStart : theirsHunks.at(j).oldStart;
+		int high = low;
+		int oursGrowth = 0, theirsGrowth = 0;
+		bool hasOurs = false, hasTheirs = false;
+		for (;;)
+		{
+			if (i < oursHunks.size() && oursHunks.at(i).oldStart <= high)
+			{
+				const LineDiff::Hunk &hunk = oursHunks.at(i++);
+				high = qMax(high, hunk.oldEnd);
+				oursGrowth += (hunk.newEnd - hunk.newStart) - (hunk.oldEnd - hunk.oldStart);
+				hasOurs = true;
+			}
+			else if (j < theirsHunks.size() && theirsHunks.at(j).oldStart <= high)
+			{
+				const LineDiff::Hunk &hunk = theirsHunks.at(j++);
+				high = qMax(high, hunk.oldEnd);
+				theirsGrowth += (hunk.newEnd - hunk.newStart) - (hunk.oldEnd - hunk.oldStart);
+				hasTheirs = true;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		//组之前未修改的部分
+		if (baseLine < low)
+		{
+			Region unchanged;
+			for (int side = Base; side < Merged; ++side)
+			{
+				unchanged.start[side] = baseLine + delta[side];
+				unchanged.end[side] = low + delta[side];
+			}
+			addRegion(unchanged);
+		}
+
+		Region region;
+		region.start[Base] = low;
+		region.end[Base] = high;
+		region.start[Ours] = low + delta[Ours];
+		region.end[Ours] = high + delta[Ours] + oursGrowth;
+		region.start[Theirs] = low + delta[Theirs];
+		region.end[Theirs] = high + delta[Theirs] + theirsGrowth;
+		if (hasOurs && hasTheirs)
+		{
+			region.type = sameLines(lines[Ours], region.start[Ours], region.end[Ours],
+				lines[Theirs], region.start[Theirs], region.end[Theirs]) ? Region::BothSame : Region::Conflict;
+		}
+		else
+		{
+			region.type = hasOurs ? Region::OursOnly : Region::TheirsOnly;
+		}
+		addRegion(region);
+		delta[Ours] += oursGrowth;
+		delta[Theirs] += theirsGrowth;
+		baseLine = high;
+	}
+	if (baseLine < lines[Base].size())
+	{
+		Region unchanged;
+		for (int side = Base; side < Merged; ++side)
+		{
+			unchanged.start[side] = baseLine + delta[side];
+			unchanged.end[side] = lines[Base].size() + delta[side];
+		}
+		addRegion(unchanged);
+	}
+
+	//各方最后一行没有换行符，去掉多加的那一个
+	result.merged.chop(1);
+	result.elapsed = timer.elapsed();
+	return result;
+}
+
+int ThreeWayMerge::regionAt(const QVector<Region> &regions, Side side, int line)
+{
+	QVector<Region>::const_iterator it = std::upper_bound(regions.constBegin(), regions.constEnd(), line,
+		[side](int value, const Region &region) { return value < region.start[side]; });
+	return qMax(0, int(it - regions.constBegin()) - 1);
+}
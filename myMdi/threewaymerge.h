@@ -0,0 +1,51 @@
+﻿#ifndef THREEWAYMERGE_H
+#define THREEWAYMERGE_H
+#include <QString>
+#include <QVector>
+#include "linediff.h"
+
+//三方合并：分别比较基础版本与双方版本，按基础版本的位置归并两组差异，
+//只有一方修改的区域直接采用，双方修改不同的区域生成冲突标记。只依赖纯文本，可以在工作线程中运行
+class ThreeWayMerge
+{
+public:
+	enum Side { Base, Ours, Theirs, Merged, SideCount };
+
+	//合并结果中的一个区域，各方的行范围为[start, end)
+	struct Region
+	{
+		enum Type
+		{
+			Unchanged,          //双方都没有修改
+			OursOnly,           //只有我方修改
+			TheirsOnly,         //只有对方修改
+			BothSame,           //双方做了相同的修改
+			Conflict            //双方做了不同的修改
+		};
+		Region() : type(Unchanged)
+		{
+			for (int i = 0; i < SideCount; ++i)
+				start[i] = end[i] = 0;
+		}
+		Type type;
+		int start[SideCount];
+		int end[SideCount];
+	};
+
+	//合并的结果
+	struct Result
+	{
+		Result() : conflictCount(0), elapsed(0) {}
+		QVector<Region> regions;    //按位置排序，首尾相接覆盖全部内容
+		QString merged;             //合并后的文本，冲突处带有冲突标记
+		int conflictCount;
+		qint64 elapsed;             //计算耗时（毫秒）
+	};
+
+	static Result merge(const QString &base, const QString &ours, const QString &theirs);
+
+	//区域中找出包含side一侧第line行的那个，二分查找
+	static int regionAt(const QVector<Region> &regions, Side side, int line);
+};
+
+#endif // THREEWAYMERGE_H
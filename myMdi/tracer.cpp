@@ -0,0 +1,280 @@
+﻿#include <QElapsedTimer>
+#include <QMutex>
+#include <QList>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QTimer>
+#include <QStandardPaths>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "tracer.h"
+
+bool Tracer::enabled = false;
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char * name;
+		const char * category;
+		qint64 start;
+		qint64 duration;
+	};
+
+	//一个线程的事件缓冲区，只有所属线程写入。
+	//每个槽带一个序号，写入前后各改一次，读出时序号不一致或为奇数说明正在被覆盖，丢弃该事件
+	struct ThreadRing
+	{
+		enum { Capacity = 8192, MaxDepth = 64 };
+		struct Slot
+		{
+			QAtomicInteger<quint32> sequence;
+			TraceEvent event;
+		};
+
+		int tid;
+		QString threadName;
+		QAtomicInteger<quint64> head;           //已写入的事件总数
+		Slot entries[Capacity];
+
+		//尚未结束的操作，供卡顿时查看界面线程阻塞在哪里
+		QAtomicInt depth;
+		const char * openNames[MaxDepth];
+		qint64 openStarts[MaxDepth];
+	};
+
+	QMutex registryMutex;
+	QList<ThreadRing *> rings;                  //所有线程的缓冲区，线程结束后也保留，供导出
+	thread_local ThreadRing * currentRing = nullptr;
+
+	QElapsedTimer & clock()
+	{
+		static QElapsedTimer timer = []()
+		{
+			QElapsedTimer started;
+			started.start();
+			return started;
+		}();
+		return timer;
+	}
+
+	ThreadRing * ring()
+	{
+		if (!currentRing)
+		{
+			//原子变量的默认值都是0
+			currentRing = new ThreadRing;
+			QThread * thread = QThread::currentThread();
+			currentRing->threadName = qApp && thread == qApp->thread() ? QString("GUI") : thread->objectName();
+			QMutexLocker locker(&registryMutex);
+			currentRing->tid = rings.size() + 1;
+			if (currentRing->threadName.isEmpty())
+				currentRing->threadName = QString("Thread %1").arg(currentRing->tid);
+			rings.append(currentRing);
+		}
+		return currentRing;
+	}
+
+	QJsonObject completeEvent(const ThreadRing *ring, const char *name, const char *category, qint64 start, qint64 duration)
+	{
+		QJsonObject object;
+		object["name"] = QString::fromUtf8(name);
+		object["cat"] = QString::fromUtf8(category);
+		object["ph"] = "X";
+		object["ts"] = start;
+		object["dur"] = duration;
+		object["pid"] = 1;
+		object["tid"] = ring->tid;
+		return object;
+	}
+}
+
+void Tracer::setEnabled(bool on)
+{
+	clock();
+	enabled = on;
+}
+
+qint64 Tracer::now()
+{
+	return clock().nsecsElapsed() / 1000;
+}
+
+void Tracer::begin(const char *name)
+{
+	ThreadRing * r = ring();
+	int depth = r->depth.load();
+	if (depth < ThreadRing::MaxDepth)
+	{
+		r->openNames[depth] = name;
+		r->openStarts[depth] = now();
+	}
+	r->depth.storeRelease(depth + 1);
+}
+
+void Tracer::end(const char *name, const char *category, qint64 start)
+{
+	ThreadRing * r = ring();
+	r->depth.storeRelease(qMax(0, r->depth.load() - 1));
+
+	quint64 head = r->head.load();
+	ThreadRing::Slot &slot = r->entries[head % ThreadRing::Capacity];
+	quint32 sequence = quint32(head) * 2;
+	slot.sequence.storeRelease(sequence + 1);
+	slot.event.name = name;
+	slot.event.category = category;
+	slot.event.start = start;
+	slot.event.duration = now() - start;
+	slot.sequence.storeRelease(sequence + 2);
+	r->head.storeRelease(head + 1);
+}
+
+QByteArray Tracer::toJson(qint64 from, qint64 to, bool includeOpen)
+{
+	if (to < 0)
+	{
+		to = now();
+	}
+	QList<ThreadRing *> snapshot;
+	{
+		QMutexLocker locker(&registryMutex);
+		snapshot = rings;
+	}
+
+	QJsonArray events;
+	for (ThreadRing * r : snapshot)
+	{
+		//线程名称作为元数据事件
+		QJsonObject meta;
+		meta["name"] = "thread_name";
+		meta["ph"] = "M";
+		meta["pid"] = 1;
+		meta["tid"] = r->tid;
+		QJsonObject args;
+		args["name"] = r->threadName;
+		meta["args"] = args;
+		events.append(meta);
+
+		quint64 head = r->head.loadAcquire();
+		quint64 first = head > quint64(ThreadRing::Capacity) ? head - ThreadRing::Capacity : 0;
+		for (quint64 i = first; i < head; ++i)
+		{
+			const ThreadRing::Slot &slot = r->entries[i % ThreadRing::Capacity];
+			quint32 before = slot.sequence.loadAcquire();
+			TraceEvent event = slot.event;
+			quint32 after = slot.sequence.loadAcquire();
+			if (before != after || (before & 1) || before != quint32(i) * 2 + 2)
+				continue;
+			if (event.start + event.duration < from || event.start > to)
+				continue;
+			events.append(completeEvent(r, event.name, event.category, event.start, event.duration));
+		}
+
+		if (includeOpen)
+		{
+			int depth = qMin(int(r->depth.loadAcquire()), int(ThreadRing::MaxDepth));
+			for (int i = 0; i < depth; ++i)
+			{
+				QJsonObject object = completeEvent(r, r->openNames[i], "open", r->openStarts[i], to - r->openStarts[i]);
+				QJsonObject openArgs;
+				openArgs["unfinished"] = true;
+				object["args"] = openArgs;
+				events.append(object);
+			}
+		}
+	}
+
+	QJsonObject root;
+	root["traceEvents"] = events;
+	root["displayTimeUnit"] = "ms";
+	return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool Tracer::save(const QString &fileName, qint64 from, qint64 to, bool includeOpen)
+{
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly))
+	{
+		return false;
+	}
+	return file.write(toJson(from, to, includeOpen)) >= 0;
+}
+
+StallWatchdog::StallWatchdog(int thresholdMs, QObject *parent) :
+	QThread(parent),
+	threshold(thresholdMs)
+{
+	setObjectName("StallWatchdog");
+	lastBeat.store(Tracer::now());
+
+	//定时器属于界面线程，界面线程阻塞时心跳就会中断
+	QTimer * timer = new QTimer(this);
+	connect(timer, SIGNAL(timeout()), this, SLOT(heartbeat()));
+	timer->start(PollInterval / 2);
+}
+
+StallWatchdog::~StallWatchdog()
+{
+	requestInterruption();
+	wait();
+}
+
+void StallWatchdog::heartbeat()
+{
+	lastBeat.storeRelease(Tracer::now());
+}
+
+QString StallWatchdog::directory() const
+{
+	return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("traces");
+}
+
+QString StallWatchdog::snapshot(qint64 from, qint64 to, bool includeOpen)
+{
+	QDir().mkpath(directory());
+	QString fileName = QDir(directory()).filePath(
+		QString("stall-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz")));
+	return Tracer::save(fileName, from, to, includeOpen) ? fileName : QString();
+}
+
+void StallWatchdog::run()
+{
+	bool stalled = false;
+	bool saved = false;
+	qint64 stallStart = 0;
+	while (!isInterruptionRequested())
+	{
+		msleep(PollInterval);
+		qint64 beat = lastBeat.loadAcquire();
+		qint64 blocked = (Tracer::now() - beat) / 1000;
+		if (!stalled && blocked > threshold)
+		{
+			stalled = true;
+			saved = false;
+			stallStart = beat;
+		}
+		else if (stalled && !saved && blocked > threshold * HangFactor)
+		{
+			//长时间没有恢复，先保存一份，其中包含界面线程上尚未结束的操作
+			QString fileName = snapshot(stallStart - ContextBefore, Tracer::now(), true);
+			saved = true;
+			if (!fileName.isEmpty())
+				emit stallRecorded(fileName, blocked);
+		}
+		else if (stalled && blocked <= threshold)
+		{
+			//界面线程恢复了，卡顿期间的操作都已记录完整
+			stalled = false;
+			qint64 length = (beat - stallStart) / 1000;
+			if (!saved)
+			{
+				QString fileName = snapshot(stallStart - ContextBefore, beat, false);
+				if (!fileName.isEmpty())
+					emit stallRecorded(fileName, length);
+			}
+		}
+	}
+}
@@ -0,0 +1,91 @@
+﻿#ifndef TRACER_H
+#define TRACER_H
+#include <QThread>
+#include <QAtomicInteger>
+#include <QByteArray>
+
+//跟踪：在关键操作外用TRACE_SCOPE("名称")记录一段耗时。
+//每个线程把事件写进自己的环形缓冲区，写入不加锁，满了就覆盖最早的事件；
+//导出时收集所有线程的事件，生成Chrome Trace Event格式的JSON，可以在Perfetto中打开。
+//未开启时TRACE_SCOPE只检查一个标志
+class Tracer
+{
+public:
+	static bool isEnabled() { return enabled; }
+	static void setEnabled(bool enabled);
+
+	static qint64 now();                        //从程序启动开始的微秒数
+
+	static void begin(const char *name);        //进入一段操作，只记在本线程的未结束栈中
+	static void end(const char *name, const char *category, qint64 start);  //离开一段操作并记录完整的事件
+
+	//导出[from, to]之间（微秒）的事件；includeOpen为真时，仍未结束的操作也按到现在为止的耗时导出
+	static QByteArray toJson(qint64 from = 0, qint64 to = -1, bool includeOpen = false);
+	static bool save(const QString &fileName, qint64 from = 0, qint64 to = -1, bool includeOpen = false);
+
+private:
+	static bool enabled;
+};
+
+//在构造和析构之间记录一段操作，名称必须是字符串常量
+class TraceScope
+{
+public:
+	explicit TraceScope(const char *name, const char *category = "app") :
+		traceName(Tracer::isEnabled() ? name : nullptr),
+		traceCategory(category),
+		start(0)
+	{
+		if (traceName)
+		{
+			start = Tracer::now();
+			Tracer::begin(traceName);
+		}
+	}
+	~TraceScope()
+	{
+		if (traceName)
+			Tracer::end(traceName, traceCategory, start);
+	}
+
+private:
+	const char * traceName;
+	const char * traceCategory;
+	qint64 start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_CATEGORY(name, category) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
+
+//卡顿监视线程：界面线程定时发出心跳，心跳中断超过阈值时，
+//在界面线程恢复后把卡顿前后的跟踪保存到文件；一直没有恢复时也先保存一份，其中包含尚未结束的操作
+class StallWatchdog : public QThread
+{
+	Q_OBJECT
+
+public:
+	explicit StallWatchdog(int thresholdMs, QObject *parent = nullptr);
+	~StallWatchdog();
+
+	QString directory() const;                  //保存跟踪文件的目录
+
+public slots:
+	void heartbeat();                           //由界面线程中的定时器调用
+
+signals:
+	void stallRecorded(const QString &fileName, qint64 milliseconds);   //已保存一次卡顿的跟踪
+
+protected:
+	void run();
+
+private:
+	enum { PollInterval = 50, HangFactor = 10, ContextBefore = 2000000 };
+	QString snapshot(qint64 from, qint64 to, bool includeOpen);  //保存跟踪，返回文件名
+
+	int threshold;                              //阈值（毫秒）
+	QAtomicInteger<qint64> lastBeat;            //最近一次心跳的时间（微秒）
+};
+
+#endif // TRACER_H
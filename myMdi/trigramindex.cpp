@@ -0,0 +1,358 @@
+﻿#include <QTextDocument>
+#include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include "trigramindex.h"
+#include "tracer.h"
+#include "blockdata.h"
+
+bool TrigramIndex::enabled = true;
+
+//三个字符组合成一个键，统一做大小写折叠，这样区分和不区分大小写的查找都能使用同一份索引
+static inline quint64 trigramKey(QChar a, QChar b, QChar c)
+{
+	return (quint64(a.toCaseFolded().unicode()) << 32)
+		| (quint64(b.toCaseFolded().unicode()) << 16)
+		| quint64(c.toCaseFolded().unicode());
+}
+
+TrigramIndex::TrigramIndex(QTextDocument *document) :
+	QObject(document),
+	doc(document),
+	staleCount(0),
+	ready(false),
+	buildRevision(0)
+{
+	watcher = new QFutureWatcher<BuildResult>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(buildFinished()));
+
+	rebuildTimer = new QTimer(this);
+	rebuildTimer->setSingleShot(true);
+	rebuildTimer->setInterval(500);
+	connect(rebuildTimer, SIGNAL(timeout()), this, SLOT(rebuild()));
+
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+}
+
+TrigramIndex::~TrigramIndex()
+{
+	//等待工作线程结束，并断开各个块和本索引的关联
+	watcher->waitForFinished();
+	for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+	{
+		BlockData * data = static_cast<BlockData *>(block.userData());
+		if (data && data->trigramIndex == this)
+		{
+			data->trigramIndex = nullptr;
+		}
+	}
+}
+
+bool TrigramIndex::isEnabled()
+{
+	return enabled;
+}
+
+void TrigramIndex::setEnabled(bool on)
+{
+	enabled = on;
+}
+
+void TrigramIndex::rebuild()
+{
+	if (watcher->isRunning())
+	{
+		rebuildTimer->start();
+		return;
+	}
+	//文档不能跨线程访问，交给工作线程的是纯文本快照，行号即为块编号
+	ready = false;
+	buildRevision = doc->revision();
+	watcher->setFuture(QtConcurrent::run(&TrigramIndex::build, doc->toPlainText()));
+}
+
+TrigramIndex::BuildResult TrigramIndex::build(const QString &text)
+{
+	TRACE_SCOPE_CATEGORY("TrigramIndex::build", "worker");
+	BuildResult result;
+	const QChar * data = text.constData();
+	int lineStart = 0;
+	for (int i = 0; i <= text.size(); ++i)
+	{
+		if (i == text.size() || data[i] == QLatin1Char('\n'))
+		{
+			addTrigrams(data + lineStart, i - lineStart, result.lineCount, result.postings);
+			++result.lineCount;
+			lineStart = i + 1;
+		}
+	}
+	return result;
+}
+
+void TrigramIndex::addTrigrams(const QChar *text, int length, quint32 id, PostingMap &postings)
+{
+	for (int i = 0; i + 2 < length; ++i)
+	{
+		QVector<quint32> &list = postings[trigramKey(text[i], text[i + 1], text[i + 2])];
+		//编号单调递增，同一块中重复的三元组只记录一次，列表始终有序
+		if (list.isEmpty() || list.last() != id)
+		{
+			list.append(id);
+		}
+	}
+}
+
+void TrigramIndex::buildFinished()
+{
+	//建立期间文档被修改过，快照已经过期，稍后重新建立
+	if (doc->revision() != buildRevision)
+	{
+		rebuildTimer->start();
+		return;
+	}
+
+	BuildResult result = watcher->result();
+	postings.swap(result.postings);
+	blocks.clear();
+	blocks.reserve(result.lineCount);
+	for (QTextBlock block = doc->begin(); block.isValid(); block = block.next())
+	{
+		BlockData * data = BlockData::get(block);
+		data->trigramIndex = this;
+		data->trigramId = blocks.size();
+		blocks.append(block);
+	}
+	staleCount = 0;
+	ready = true;
+	emit indexReady(memoryUsage());
+}
+
+void TrigramIndex::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved);
+	//索引未就绪时由buildFinished()检测版本变化并重建
+	if (!ready)
+	{
+		return;
+	}
+
+	//只重新索引受影响的块，代价与修改的大小成正比
+	int end = position + charsAdded;
+	for (QTextBlock block = doc->findBlock(position); block.isValid() && block.position() <= end; block = block.next())
+	{
+		reindexBlock(block);
+	}
+
+	//失效的编号过多时在后台重建，回收倒排列表中的空间
+	if (staleCount > 100000 && staleCount > blocks.size() / 2)
+	{
+		rebuild();
+	}
+}
+
+void TrigramIndex::reindexBlock(QTextBlock block)
+{
+	//块的内容变了就换一个新编号，旧编号在倒排列表中作废，验证时会被跳过
+	BlockData * data = BlockData::get(block);
+	if (data->trigramIndex == this && data->trigramId < quint32(blocks.size()))
+	{
+		blocks[data->trigramId] = QTextBlock();
+		++staleCount;
+	}
+	data->trigramIndex = this;
+	data->trigramId = blocks.size();
+	blocks.append(block);
+
+	QString text = block.text();
+	addTrigrams(text.constData(), text.size(), data->trigramId, postings);
+}
+
+void TrigramIndex::blockRemoved(quint32 id)
+{
+	if (id < quint32(blocks.size()))
+	{
+		blocks[id] = QTextBlock();
+		++staleCount;
+	}
+}
+
+qint64 TrigramIndex::memoryUsage() const
+{
+	//倒排列表的容量加上哈希节点的开销，再加上编号表和每个块上的附加数据
+	qint64 bytes = 0;
+	for (PostingMap::const_iterator it = postings.constBegin(); it != postings.constEnd(); ++it)
+	{
+		bytes += it.value().capacity() * sizeof(quint32) + sizeof(quint64) + sizeof(QVector<quint32>) + 2 * sizeof(void *);
+	}
+	bytes += blocks.capacity() * sizeof(QTextBlock);
+	bytes += blocks.size() * sizeof(BlockData);
+	return bytes;
+}
+
+QStringList TrigramIndex::requiredLiterals(const QString &pattern, bool useRegex, bool *ok)
+{
+	QStringList literals;
+	*ok = false;
+
+	//匹配不能跨越文本块，否则只按块验证会漏掉结果
+	if (!useRegex)
+	{
+		if (pattern.contains(QLatin1Char('\n')) || pattern.contains(QChar::ParagraphSeparator))
+			return literals;
+		*ok = true;
+		if (pattern.size() >= 3)
+			literals.append(pattern);
+		return literals;
+	}
+
+	//简单正则：没有选择分支，也不含可能匹配换行的写法，
+	//取最外层中一定会出现的连续字面文本作为必需的子串
+	QString run;
+	int depth = 0;
+	auto flush = [&]()
+	{
+		if (run.size() >= 3 && depth == 0)
+			literals.append(run);
+		run.clear();
+	};
+
+	for (int i = 0; i < pattern.size(); ++i)
+	{
+		QChar c = pattern.at(i);
+		QChar literal;
+		if (c == QLatin1Char('|'))
+		{
+			return QStringList();
+		}
+		else if (c == QLatin1Char('\\'))
+		{
+			if (i + 1 >= pattern.size())
+				return QStringList();
+			QChar e = pattern.at(++i);
+			if (e == QLatin1Char('d') || e == QLatin1Char('w') || e == QLatin1Char('b') || e == QLatin1Char('B'))
+			{
+				flush();
+				continue;
+			}
+			//\n、\s、\x、反向引用等都按复杂正则处理
+			if (e.isLetterOrNumber())
+				return QStringList();
+			literal = e;
+		}
+		else if (c == QLatin1Char('['))
+		{
+			//取反的字符集可能匹配换行
+			if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('^'))
+				return QStringList();
+			flush();
+			for (++i; i < pattern.size() && pattern.at(i) != QLatin1Char(']'); ++i)
+			{
+				if (pattern.at(i) == QLatin1Char('\\'))
+					++i;
+			}
+			continue;
+		}
+		else if (c == QLatin1Char('('))
+		{
+			flush();
+			++depth;
+			continue;
+		}
+		else if (c == QLatin1Char(')'))
+		{
+			flush();
+			--depth;
+			continue;
+		}
+		else if (c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$'))
+		{
+			flush();
+			continue;
+		}
+		else if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('{') || c == QLatin1Char('+'))
+		{
+			//量词作用于前一个字符：+表示至少出现一次，其余都可能不出现
+			if (c != QLatin1Char('+') && !run.isEmpty())
+				run.chop(1);
+			flush();
+			if (c == QLatin1Char('{'))
+			{
+				while (i < pattern.size() && pattern.at(i) != QLatin1Char('}'))
+					++i;
+			}
+			//跳过惰性和占有量词的后缀
+			if (i + 1 < pattern.size() && (pattern.at(i + 1) == QLatin1Char('?') || pattern.at(i + 1) == QLatin1Char('+')))
+				++i;
+			continue;
+		}
+		else
+		{
+			literal = c;
+		}
+		if (depth == 0)
+			run.append(literal);
+	}
+	flush();
+	*ok = true;
+	return literals;
+}
+
+bool TrigramIndex::candidateBlocks(const QString &pattern, const SearchEngine::Options &options,
+	QVector<QTextBlock> *result) const
+{
+	result->clear();
+	if (!ready)
+	{
+		return false;
+	}
+	bool ok = false;
+	QStringList literals = requiredLiterals(pattern, options.useRegex, &ok);
+	if (!ok || literals.isEmpty())
+	{
+		return false;
+	}
+
+	//取出所有必需三元组的倒排列表，任何一个不存在就说明没有匹配
+	QVector<const QVector<quint32> *> lists;
+	for (const QString &literal : literals)
+	{
+		for (int i = 0; i + 2 < literal.size(); ++i)
+		{
+			PostingMap::const_iterator it = postings.constFind(trigramKey(literal.at(i), literal.at(i + 1), literal.at(i + 2)));
+			if (it == postings.constEnd())
+			{
+				return true;
+			}
+			lists.append(&it.value());
+		}
+	}
+
+	//从最短的列表开始求交集，在较长的列表中二分查找
+	std::sort(lists.begin(), lists.end(), [](const QVector<quint32> *a, const QVector<quint32> *b)
+	{
+		return a->size() < b->size();
+	});
+	QVector<quint32> ids = *lists.first();
+	for (int i = 1; i < lists.size() && !ids.isEmpty(); ++i)
+	{
+		const QVector<quint32> &other = *lists.at(i);
+		QVector<quint32> kept;
+		for (quint32 id : ids)
+		{
+			if (std::binary_search(other.constBegin(), other.constEnd(), id))
+				kept.append(id);
+		}
+		ids.swap(kept);
+	}
+
+	for (quint32 id : ids)
+	{
+		if (id < quint32(blocks.size()) && blocks.at(id).isValid())
+			result->append(blocks.at(id));
+	}
+	std::sort(result->begin(), result->end(), [](const QTextBlock &a, const QTextBlock &b)
+	{
+		return a.position() < b.position();
+	});
+	return true;
+}
@@ -0,0 +1,74 @@
+﻿#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QTextBlock>
+#include <QFutureWatcher>
+#include "searchengine.h"
+
+class QTextDocument;
+class QTimer;
+
+//文档的三元组倒排索引：记录每个三字符组合出现在哪些文本块中，
+//查找时先用索引缩小候选块的范围，再在候选块中逐一验证
+class TrigramIndex : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit TrigramIndex(QTextDocument *document);
+	~TrigramIndex();
+
+	//小于这个字符数的文档直接扫描已经足够快，不建立索引
+	enum { MinimumDocumentSize = 256 * 1024 };
+
+	static bool isEnabled();                    //是否启用搜索索引
+	static void setEnabled(bool enabled);       //设置是否启用搜索索引
+
+	bool isReady() const { return ready; }      //索引是否可用
+	qint64 memoryUsage() const;                 //索引占用的内存（字节）
+
+	//返回可能包含匹配的文本块（按位置排序），返回false表示该查询无法用索引缩小范围
+	bool candidateBlocks(const QString &pattern, const SearchEngine::Options &options,
+		QVector<QTextBlock> *result) const;
+
+	void blockRemoved(quint32 id);              //文本块被删除时由BlockData调用
+
+public slots:
+	void rebuild();                             //在工作线程中重新建立索引
+
+signals:
+	void indexReady(qint64 bytes);              //索引建立完成，给出占用的内存
+
+private slots:
+	void buildFinished();                       //工作线程建立索引完成
+	void documentChanged(int position, int charsRemoved, int charsAdded);    //文档内容改变
+
+private:
+	typedef QHash<quint64, QVector<quint32> > PostingMap;
+	struct BuildResult
+	{
+		BuildResult() : lineCount(0) {}
+		PostingMap postings;
+		int lineCount;
+	};
+
+	static BuildResult build(const QString &text);
+	static void addTrigrams(const QChar *text, int length, quint32 id, PostingMap &postings);
+	static QStringList requiredLiterals(const QString &pattern, bool useRegex, bool *ok);
+	void reindexBlock(QTextBlock block);
+
+	QTextDocument * doc;
+	PostingMap postings;                        //三元组到块编号的有序列表
+	QVector<QTextBlock> blocks;                 //块编号到文本块，失效的编号对应无效块
+	int staleCount;                             //已失效的编号数量，过多时重建索引
+	bool ready;
+	int buildRevision;                          //开始建立索引时的文档版本
+	QFutureWatcher<BuildResult> * watcher;
+	QTimer * rebuildTimer;                      //建立期间文档被修改时延迟重建
+
+	static bool enabled;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,86 @@
+﻿#include <QTimer>
+#include <QStringList>
+#include "uistateaggregator.h"
+#include "tracer.h"
+
+UiStateAggregator::UiStateAggregator(QObject *parent) :
+	QObject(parent),
+	dirty(0)
+{
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	timer->setInterval(FrameInterval);
+	connect(timer, SIGNAL(timeout()), this, SLOT(flush()));
+	clearCounts();
+}
+
+int UiStateAggregator::index(Part part)
+{
+	int i = 0;
+	while ((1 << i) != part)
+		++i;
+	return i;
+}
+
+void UiStateAggregator::mark(int parts)
+{
+	for (int i = 0; i < PartCount; ++i)
+	{
+		if (parts & (1 << i))
+			++requests[i];
+	}
+	dirty |= parts;
+	//第一次标记时开始计时，之后的标记都在同一次更新中处理
+	if (!timer->isActive())
+	{
+		timer->start();
+	}
+}
+
+void UiStateAggregator::flush()
+{
+	timer->stop();
+	if (!dirty)
+	{
+		return;
+	}
+	TRACE_SCOPE_CATEGORY("UiStateAggregator::flush", "ui");
+	int parts = dirty;
+	dirty = 0;
+	for (int i = 0; i < PartCount; ++i)
+	{
+		if (parts & (1 << i))
+			++updates[i];
+	}
+	emit updateRequested(parts);
+}
+
+qint64 UiStateAggregator::requestCount(Part part) const
+{
+	return requests[index(part)];
+}
+
+qint64 UiStateAggregator::updateCount(Part part) const
+{
+	return updates[index(part)];
+}
+
+QString UiStateAggregator::summary() const
+{
+	static const char * const names[PartCount] = { "行号列号", "文档统计", "菜单", "剪切复制", "撤销恢复" };
+	QStringList parts;
+	for (int i = 0; i < PartCount; ++i)
+	{
+		parts << QString::fromLocal8Bit("%1 %2/%3").arg(QString::fromLocal8Bit(names[i])).arg(updates[i]).arg(requests[i]);
+	}
+	return parts.join(QString::fromLocal8Bit("，"));
+}
+
+void UiStateAggregator::clearCounts()
+{
+	for (int i = 0; i < PartCount; ++i)
+	{
+		requests[i] = 0;
+		updates[i] = 0;
+	}
+}
@@ -0,0 +1,53 @@
+﻿#ifndef UISTATEAGGREGATOR_H
+#define UISTATEAGGREGATOR_H
+#include <QObject>
+
+class QTimer;
+
+//界面状态的合并更新：光标移动、选区改变、窗口激活等信号只把对应的部分标记为需要更新，
+//每帧（约16毫秒）最多发出一次updateRequested，一次处理这段时间内积累的全部部分。
+//记录每个部分收到的请求数和实际更新数，两者之差就是被合并掉的更新
+class UiStateAggregator : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum Part
+	{
+		CursorPosition = 0x01,                  //状态栏中的行号和列号
+		Statistics = 0x02,                      //状态栏中的文档统计
+		Menus = 0x04,                           //全部菜单动作是否可用
+		Clipboard = 0x08,                       //剪切和复制是否可用
+		UndoRedo = 0x10                         //撤销和恢复是否可用
+	};
+	enum { PartCount = 5, FrameInterval = 16 };
+
+	explicit UiStateAggregator(QObject *parent = nullptr);
+
+	void mark(int parts);                       //标记需要更新的部分，在下一帧更新
+	qint64 requestCount(Part part) const;       //收到的请求数
+	qint64 updateCount(Part part) const;        //实际的更新次数
+	QString summary() const;                    //各部分的请求数和更新数，用于显示
+	void clearCounts();
+
+public slots:
+	void markCursorPosition() { mark(CursorPosition); }
+	void markStatistics() { mark(Statistics); }
+	void markMenus() { mark(Menus); }
+	void markClipboard() { mark(Clipboard); }
+	void markUndoRedo() { mark(UndoRedo); }
+	void flush();                               //立即更新积累的部分
+
+signals:
+	void updateRequested(int parts);            //接收者按parts更新界面
+
+private:
+	static int index(Part part);
+
+	QTimer * timer;
+	int dirty;                                  //等待更新的部分
+	qint64 requests[PartCount];
+	qint64 updates[PartCount];
+};
+
+#endif // UISTATEAGGREGATOR_H
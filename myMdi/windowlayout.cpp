@@ -0,0 +1,275 @@
+﻿#include <algorithm>
+#include <QEvent>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QRegion>
+#include <QStyle>
+#include <QTimer>
+#include <QtMath>
+#include "windowlayout.h"
+#include "mdichild.h"
+#include "tracer.h"
+
+//把从start开始的length等分为parts份，每份不小于minimum，放不下时超出视口由滚动条显示
+static void split(int start, int length, int parts, int index, int minimum, int *begin, int *size)
+{
+	if (length / parts >= minimum)
+	{
+		*begin = start + length * index / parts;
+		*size = start + length * (index + 1) / parts - *begin;
+	}
+	else
+	{
+		*begin = start + minimum * index;
+		*size = minimum;
+	}
+}
+
+static int regionArea(const QRegion &region)
+{
+	int area = 0;
+	for (const QRect &rect : region)
+	{
+		area += rect.width() * rect.height();
+	}
+	return area;
+}
+
+WindowLayout::WindowLayout(QMdiArea *area, QObject *parent) :
+	QObject(parent),
+	area(area)
+{
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	timer->setInterval(0);
+	connect(timer, SIGNAL(timeout()), this, SLOT(updateVisibility()));
+	connect(area, SIGNAL(subWindowActivated(QMdiSubWindow *)), this, SLOT(windowActivated(QMdiSubWindow *)));
+}
+
+QVector<QRect> WindowLayout::geometries(Mode mode, const QRect &area, int count, int titleHeight)
+{
+	QVector<QRect> rects;
+	rects.reserve(count);
+	if (count <= 0)
+	{
+		return rects;
+	}
+	int x, y, width, height;
+	switch (mode)
+	{
+	case Grid:
+	{
+		int columns = qBound(1, qCeil(qSqrt(count)), qMax(1, area.width() / MinimumWidth));
+		int rows = (count + columns - 1) / columns;
+		for (int i = 0; i < count; ++i)
+		{
+			split(area.left(), area.width(), columns, i % columns, MinimumWidth, &x, &width);
+			split(area.top(), area.height(), rows, i / columns, MinimumHeight, &y, &height);
+			rects.append(QRect(x, y, width, height));
+		}
+		break;
+	}
+	case Columns:
+		for (int i = 0; i < count; ++i)
+		{
+			split(area.left(), area.width(), count, i, MinimumWidth, &x, &width);
+			rects.append(QRect(x, area.top(), width, area.height()));
+		}
+		break;
+	case MasterStack:
+	{
+		if (count == 1)
+		{
+			rects.append(area);
+			break;
+		}
+		int masterWidth = area.width() / 2;
+		rects.append(QRect(area.left(), area.top(), masterWidth, area.height()));
+		for (int i = 1; i < count; ++i)
+		{
+			split(area.top(), area.height(), count - 1, i - 1, MinimumHeight, &y, &height);
+			rects.append(QRect(area.left() + masterWidth, y, area.width() - masterWidth, height));
+		}
+		break;
+	}
+	case Cascade:
+	{
+		//每次错开一个标题栏的高度，到底部后从顶端重新开始，同时向右再错开一格
+		QSize size(qMax<int>(MinimumWidth, area.width() * 2 / 3), qMax<int>(MinimumHeight, area.height() * 2 / 3));
+		int step = qMax(1, titleHeight);
+		int perColumn = qMax(1, (area.height() - size.height()) / step + 1);
+		for (int i = 0; i < count; ++i)
+		{
+			int row = i % perColumn;
+			rects.append(QRect(QPoint(area.left() + (row + i / perColumn) * step, area.top() + row * step), size));
+		}
+		break;
+	}
+	}
+	return rects;
+}
+
+void WindowLayout::arrange(Mode mode)
+{
+	TRACE_SCOPE_CATEGORY("WindowLayout::arrange", "ui");
+	stopWatching();
+	deferred.clear();
+
+	//层叠保持原来的上下次序，平铺时活动窗口排在最前面
+	QList<QMdiSubWindow *> windows;
+	foreach(QMdiSubWindow * window, area->subWindowList(mode == Cascade ? QMdiArea::StackingOrder : QMdiArea::ActivationHistoryOrder))
+	{
+		if (window->isVisible() && !window->isMinimized())
+			windows.append(window);
+	}
+	if (windows.isEmpty())
+	{
+		return;
+	}
+	if (mode != Cascade)
+	{
+		std::reverse(windows.begin(), windows.end());
+	}
+	int titleHeight = area->style()->pixelMetric(QStyle::PM_TitleBarHeight, nullptr, windows.first());
+	QVector<QRect> rects = geometries(mode, area->viewport()->rect(), windows.size(), titleHeight);
+
+	//排列期间文档都休眠，改变大小时不重新布局，整个区域最后只重绘一次
+	area->setUpdatesEnabled(false);
+	for (int i = 0; i < windows.size(); ++i)
+	{
+		QMdiSubWindow * window = windows.at(i);
+		MdiChild * child = qobject_cast<MdiChild *>(window->widget());
+		if (child)
+		{
+			child->setDormant(true);
+			deferred.append(window);
+		}
+		if (window->isMaximized())
+			window->showNormal();
+		window->setGeometry(rects.at(i));
+	}
+	area->setUpdatesEnabled(true);
+
+	//窗口移动、改变大小或者上下次序变化时重新检查哪些文档露了出来
+	foreach(QMdiSubWindow * window, area->subWindowList())
+	{
+		window->installEventFilter(this);
+	}
+	area->viewport()->installEventFilter(this);
+	updateVisibility();
+}
+
+bool WindowLayout::eventFilter(QObject *watched, QEvent *event)
+{
+	switch (event->type())
+	{
+	case QEvent::Move:
+	case QEvent::Resize:
+	case QEvent::Show:
+	case QEvent::Hide:
+	case QEvent::ZOrderChange:
+		scheduleUpdate();
+		break;
+	default:
+		break;
+	}
+	return QObject::eventFilter(watched, event);
+}
+
+void WindowLayout::scheduleUpdate()
+{
+	if (!timer->isActive())
+	{
+		timer->start();
+	}
+}
+
+void WindowLayout::updateVisibility()
+{
+	TRACE_SCOPE_CATEGORY("WindowLayout::updateVisibility", "ui");
+	deferred.removeAll(QPointer<QMdiSubWindow>());
+	//标签页模式下由TabRealizer决定哪些文档休眠
+	if (deferred.isEmpty() || area->viewMode() == QMdiArea::TabbedView)
+	{
+		deferred.clear();
+		stopWatching();
+		return;
+	}
+
+	//从最上面的窗口开始，累积已经挡住的区域。露出任何部分的文档都要唤醒，
+	//否则露出的部分显示的是按原来宽度换行的文本；大部分可见的先唤醒，其余的留到下一轮
+	QList<QMdiSubWindow *> windows = area->subWindowList(QMdiArea::StackingOrder);
+	QList<QMdiSubWindow *> mostlyVisible;
+	QList<QMdiSubWindow *> partlyVisible;
+	QRegion viewport(area->viewport()->rect());
+	QRegion covered;
+	for (int i = windows.size() - 1; i >= 0; --i)
+	{
+		QMdiSubWindow * window = windows.at(i);
+		if (!window->isVisible())
+		{
+			continue;
+		}
+		if (deferred.contains(window) && window->widget())
+		{
+			QRect content = window->widget()->geometry().translated(window->pos());
+			QRegion exposed = viewport.intersected(content).subtracted(covered);
+			if (regionArea(exposed) * VisibleFraction >= content.width() * content.height())
+				mostlyVisible.append(window);
+			else if (!exposed.isEmpty())
+				partlyVisible.append(window);
+		}
+		covered += window->geometry();
+	}
+	for (QMdiSubWindow * window : mostlyVisible)
+	{
+		wake(window);
+	}
+	if (mostlyVisible.isEmpty())
+	{
+		for (QMdiSubWindow * window : partlyVisible)
+			wake(window);
+	}
+	else if (!partlyVisible.isEmpty())
+	{
+		scheduleUpdate();
+	}
+	if (deferred.isEmpty())
+	{
+		stopWatching();
+	}
+}
+
+void WindowLayout::windowActivated(QMdiSubWindow *window)
+{
+	if (!window || deferred.isEmpty())
+	{
+		return;
+	}
+	//激活的窗口在最上面，立即唤醒；新建的窗口也需要监视，移开时可能露出下面的文档
+	window->installEventFilter(this);
+	if (deferred.contains(window))
+	{
+		wake(window);
+	}
+	scheduleUpdate();
+}
+
+void WindowLayout::wake(QMdiSubWindow *window)
+{
+	deferred.removeAll(QPointer<QMdiSubWindow>(window));
+	MdiChild * child = qobject_cast<MdiChild *>(window->widget());
+	if (child)
+	{
+		child->setDormant(false);
+	}
+}
+
+void WindowLayout::stopWatching()
+{
+	foreach(QMdiSubWindow * window, area->subWindowList())
+	{
+		window->removeEventFilter(this);
+	}
+	area->viewport()->removeEventFilter(this);
+}
@@ -0,0 +1,60 @@
+﻿#ifndef WINDOWLAYOUT_H
+#define WINDOWLAYOUT_H
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QRect>
+#include <QVector>
+
+class QMdiArea;
+class QMdiSubWindow;
+class QTimer;
+
+//子窗口的排列：先一次算好全部窗口的位置，排列期间让文档休眠，
+//每个文档只在最后可见时按最终大小重新布局一次。
+//移出视口或者完全被其他窗口挡住的文档继续休眠，滚动、移动或者激活后露出时再唤醒
+class WindowLayout : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum Mode
+	{
+		Grid,                                   //网格平铺
+		Columns,                                //按列平铺
+		MasterStack,                            //活动窗口在左，其余在右侧堆叠
+		Cascade                                 //层叠
+	};
+
+	explicit WindowLayout(QMdiArea *area, QObject *parent = nullptr);
+
+	void arrange(Mode mode);
+
+	//计算count个窗口在area中的位置，平铺时按激活顺序，层叠时按堆叠顺序
+	static QVector<QRect> geometries(Mode mode, const QRect &area, int count, int titleHeight);
+
+	enum
+	{
+		MinimumWidth = 240,                     //平铺时窗口的最小大小，窗口太多时视口可以滚动
+		MinimumHeight = 160,
+		VisibleFraction = 4                     //露出的部分超过文档的四分之一时优先唤醒
+	};
+
+protected:
+	bool eventFilter(QObject *watched, QEvent *event);
+
+private slots:
+	void scheduleUpdate();
+	void updateVisibility();                    //唤醒已经露出来的文档
+	void windowActivated(QMdiSubWindow *window);
+
+private:
+	void wake(QMdiSubWindow *window);
+	void stopWatching();
+
+	QMdiArea * area;
+	QList<QPointer<QMdiSubWindow> > deferred;   //排列后仍在休眠的子窗口
+	QTimer * timer;
+};
+
+#endif // WINDOWLAYOUT_H
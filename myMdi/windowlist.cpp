@@ -0,0 +1,118 @@
+﻿#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QMenu>
+#include <QActionGroup>
+#include <QEvent>
+#include "windowlist.h"
+#include "mdichild.h"
+#include "tracer.h"
+
+WindowList::WindowList(QMdiArea *area, QMenu *menu, QObject *parent) :
+	QObject(parent),
+	area(area),
+	menu(menu),
+	firstStale(-1)
+{
+	group = new QActionGroup(this);
+	group->setExclusive(true);
+	connect(group, SIGNAL(triggered(QAction *)), this, SLOT(actionTriggered(QAction *)));
+	connect(area, SIGNAL(subWindowActivated(QMdiSubWindow *)), this, SLOT(windowActivated(QMdiSubWindow *)));
+	connect(menu, SIGNAL(aboutToShow()), this, SLOT(renumber()));
+
+	//几百个窗口时超出屏幕的部分可以滚动
+	menu->setStyleSheet("QMenu { menu-scrollable: 1; }");
+}
+
+void WindowList::add(QMdiSubWindow *window)
+{
+	TRACE_SCOPE_CATEGORY("WindowList::add", "ui");
+	QAction * action = new QAction(group);
+	action->setCheckable(true);
+	menu->addAction(action);
+	actions.insert(window, action);
+	windowOf.insert(action, window);
+	windows.append(window);
+	updateText(windows.size() - 1);
+	action->setChecked(window == area->activeSubWindow());
+
+	//比较视图等的标题直接设置在部件上
+	window->widget()->installEventFilter(this);
+	connect(window, SIGNAL(destroyed(QObject *)), this, SLOT(windowDestroyed(QObject *)));
+}
+
+void WindowList::updateText(int index)
+{
+	QMdiSubWindow * window = windows.at(index);
+	MdiChild * child = qobject_cast<MdiChild *>(window->widget());
+	//比较视图等不是MdiChild的子窗口显示其标题
+	QString name = child ? child->userFriendlyCurrentFile() : window->widget()->windowTitle();
+	//前9个窗口的编号作为快捷键
+	QString text = index < 9 ? QString::fromLocal8Bit("&%1 %2").arg(index + 1).arg(name)
+		: QString::fromLocal8Bit("%1 %2").arg(index + 1).arg(name);
+	actions.value(window)->setText(text);
+}
+
+bool WindowList::eventFilter(QObject *watched, QEvent *event)
+{
+	if (event->type() == QEvent::WindowTitleChange)
+	{
+		QWidget * widget = qobject_cast<QWidget *>(watched);
+		int index = widget ? windows.indexOf(qobject_cast<QMdiSubWindow *>(widget->parentWidget())) : -1;
+		//编号需要更新时菜单显示前会一起设置
+		if (index >= 0 && (firstStale < 0 || index < firstStale))
+			updateText(index);
+	}
+	return QObject::eventFilter(watched, event);
+}
+
+void WindowList::windowActivated(QMdiSubWindow *window)
+{
+	if (QAction * action = actions.value(window))
+	{
+		action->setChecked(true);
+	}
+	else if (QAction * checked = group->checkedAction())
+	{
+		//互斥的动作组不能直接取消选中
+		group->setExclusive(false);
+		checked->setChecked(false);
+		group->setExclusive(true);
+	}
+}
+
+void WindowList::windowDestroyed(QObject *window)
+{
+	//窗口已经在析构，只能用指针查找
+	QAction * action = actions.take(window);
+	if (!action)
+	{
+		return;
+	}
+	windowOf.remove(action);
+	int index = windows.indexOf(static_cast<QMdiSubWindow *>(window));
+	windows.removeAt(index);
+	firstStale = firstStale < 0 ? index : qMin(firstStale, index);
+	delete action;
+}
+
+void WindowList::actionTriggered(QAction *action)
+{
+	if (QMdiSubWindow * window = windowOf.value(action))
+	{
+		area->setActiveSubWindow(window);
+	}
+}
+
+void WindowList::renumber()
+{
+	if (firstStale < 0)
+	{
+		return;
+	}
+	TRACE_SCOPE_CATEGORY("WindowList::renumber", "ui");
+	for (int i = firstStale; i < windows.size(); ++i)
+	{
+		updateText(i);
+	}
+	firstStale = -1;
+}
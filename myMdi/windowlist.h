@@ -0,0 +1,49 @@
+﻿#ifndef WINDOWLIST_H
+#define WINDOWLIST_H
+#include <QObject>
+#include <QList>
+#include <QHash>
+
+class QMdiArea;
+class QMdiSubWindow;
+class QMenu;
+class QAction;
+class QActionGroup;
+
+//窗口菜单中的窗口列表：每个子窗口对应一个一直保留的动作，
+//在子窗口添加、关闭、改名和激活时只修改对应的动作，不在菜单显示前重建整个列表。
+//窗口关闭后后面的编号要前移，这一步推迟到菜单显示前，从第一个受影响的位置开始。
+//窗口很多时菜单可以滚动
+class WindowList : public QObject
+{
+	Q_OBJECT
+
+public:
+	//窗口动作追加在menu的末尾
+	WindowList(QMdiArea *area, QMenu *menu, QObject *parent = nullptr);
+
+	void add(QMdiSubWindow *window);            //添加子窗口之后调用
+	int count() const { return windows.size(); }
+
+protected:
+	bool eventFilter(QObject *watched, QEvent *event);  //子窗口标题改变时更新动作
+
+private slots:
+	void windowActivated(QMdiSubWindow *window);
+	void windowDestroyed(QObject *window);
+	void actionTriggered(QAction *action);
+	void renumber();                            //菜单显示前更新关闭窗口之后的编号
+
+private:
+	void updateText(int index);                 //设置第index个动作的编号和名称
+
+	QMdiArea * area;
+	QMenu * menu;
+	QActionGroup * group;                       //互斥选中，只有活动窗口被选中
+	QList<QMdiSubWindow *> windows;             //按添加的顺序
+	QHash<QObject *, QAction *> actions;        //子窗口对应的动作
+	QHash<QAction *, QMdiSubWindow *> windowOf; //动作对应的子窗口
+	int firstStale;                             //从这个位置开始编号需要更新，-1表示都是最新的
+};
+
+#endif // WINDOWLIST_H
@@ -0,0 +1,499 @@
+﻿#include <algorithm>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QtConcurrent>
+#include "wordindex.h"
+#include "tracer.h"
+
+WordIndex::WordIndex(QObject *parent) :
+	QObject(parent),
+	storedWords(0),
+	running(false)
+{
+}
+
+WordIndex::~WordIndex()
+{
+	{
+		QMutexLocker locker(&queueMutex);
+		queue.clear();
+	}
+	worker.waitForFinished();
+}
+
+void WordIndex::addDocument(QTextDocument *document)
+{
+	blockCounts.insert(document, document->blockCount());
+	connect(document, SIGNAL(contentsChange(int, int, int)), this, SLOT(documentChanged(int, int, int)));
+	connect(document, SIGNAL(destroyed(QObject *)), this, SLOT(documentDestroyed(QObject *)));
+
+	Job job;
+	job.document = document;
+	job.text = document->toPlainText();
+	enqueue(job);
+}
+
+void WordIndex::removeDocument(QTextDocument *document)
+{
+	if (!blockCounts.contains(document))
+	{
+		return;
+	}
+	disconnect(document, nullptr, this, nullptr);
+	documentDestroyed(document);
+}
+
+void WordIndex::documentDestroyed(QObject *document)
+{
+	//排在之前的修改仍会先被处理，之后才移出
+	blockCounts.remove(static_cast<QTextDocument *>(document));
+	Job job;
+	job.document = document;
+	job.remove = true;
+	enqueue(job);
+}
+
+void WordIndex::readmitDocuments()
+{
+	QList<const void *> pending;
+	{
+		QMutexLocker locker(&queueMutex);
+		pending.swap(readmitQueue);
+	}
+	//取全文之后的修改排在这个任务之后，所以全文与之后的增量修改是衔接的
+	for (QHash<QTextDocument *, int>::const_iterator it = blockCounts.constBegin(); it != blockCounts.constEnd(); ++it)
+	{
+		if (!pending.contains(it.key()))
+			continue;
+		Job job;
+		job.document = it.key();
+		job.text = it.key()->toPlainText();
+		job.reload = true;
+		enqueue(job);
+	}
+}
+
+void WordIndex::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved);
+	QTextDocument * document = qobject_cast<QTextDocument *>(sender());
+	if (!document || !blockCounts.contains(document))
+	{
+		return;
+	}
+
+	//被删除的文本已经不在了，用修改前后的行数算出被替换了多少行
+	QTextBlock first = document->findBlock(position);
+	QTextBlock last = document->findBlock(position + charsAdded);
+	if (!first.isValid())
+		first = document->lastBlock();
+	if (!last.isValid())
+		last = document->lastBlock();
+	int newCount = document->blockCount();
+	int changedLines = last.blockNumber() - first.blockNumber() + 1;
+
+	Job job;
+	job.document = document;
+	job.firstLine = first.blockNumber();
+	job.removedLines = changedLines - (newCount - blockCounts.value(document));
+	blockCounts.insert(document, newCount);
+	if (changedLines == newCount)
+	{
+		job.text = document->toPlainText();
+	}
+	else
+	{
+		for (QTextBlock block = first; block.isValid(); block = block.next())
+		{
+			job.text += block.text();
+			if (block == last)
+				break;
+			job.text += QLatin1Char('\n');
+		}
+	}
+	enqueue(job);
+}
+
+void WordIndex::enqueue(const Job &job)
+{
+	QMutexLocker locker(&queueMutex);
+	queue.append(job);
+	if (!running)
+	{
+		running = true;
+		worker = QtConcurrent::run(this, &WordIndex::processQueue);
+	}
+}
+
+void WordIndex::processQueue()
+{
+	forever
+	{
+		Job job;
+		{
+			QMutexLocker locker(&queueMutex);
+			if (queue.isEmpty())
+			{
+				running = false;
+				return;
+			}
+			job = queue.takeFirst();
+		}
+		apply(job);
+	}
+}
+
+void WordIndex::apply(const Job &job)
+{
+	TRACE_SCOPE_CATEGORY("WordIndex::apply", "worker");
+	if (job.remove)
+	{
+		QWriteLocker locker(&lock);
+		evicted.remove(job.document);
+		if (documents.contains(job.document))
+		{
+			Document &document = documents[job.document];
+			releaseLines(document, 0, document.lines.size());
+			documents.remove(job.document);
+			flush();
+		}
+		return;
+	}
+
+	QVector<QStringRef> lines = job.text.splitRef(QLatin1Char('\n'));
+	//被移出的文档只需统计每行的单词数，在锁外切分
+	bool isEvicted;
+	{
+		QReadLocker locker(&lock);
+		isEvicted = !job.reload && evicted.contains(job.document);
+	}
+	if (isEvicted)
+	{
+		QVector<int> counts = countWords(lines, 0, lines.size());
+		QWriteLocker locker(&lock);
+		updateEvicted(job.document, job.firstLine, job.removedLines, counts);
+		return;
+	}
+
+	int first = 0;
+	{
+		QWriteLocker locker(&lock);
+		if (job.reload)
+		{
+			evicted.remove(job.document);
+		}
+		Document &document = documents[job.document];
+		first = qBound(0, job.firstLine, document.lines.size());
+		int removed = qBound(0, job.removedLines, document.lines.size() - first);
+		releaseLines(document, first, removed);
+		document.lines.remove(first, removed);
+		document.lines.insert(first, lines.size(), QVector<int>());
+	}
+
+	//大段文本分批处理，每批之间释放锁，补全查询不必等待整个文档
+	//新单词攒到一定数量或者整个任务结束时才并入有序表，避免每批都归并整个单词表
+	const int BatchLines = 1024;
+	QVector<QStringRef> words;
+	for (int batch = 0; batch < lines.size(); batch += BatchLines)
+	{
+		bool wasEvicted = false;
+		{
+			QWriteLocker locker(&lock);
+			if (!documents.contains(job.document))
+			{
+				wasEvicted = evicted.contains(job.document);
+			}
+			else
+			{
+				Document &document = documents[job.document];
+				int end = qMin(lines.size(), batch + BatchLines);
+				for (int i = batch; i < end; ++i)
+				{
+					QVector<int> ids;
+					splitWords(lines.at(i), &words);
+					for (const QStringRef &word : words)
+					{
+						int id = intern(word.toString());
+						if (id >= 0)
+							ids.append(id);
+					}
+					document.stored += ids.size();
+					storedWords += ids.size();
+					document.lines[first + i] = ids;
+				}
+				if (fresh.size() + dead.size() >= FlushThreshold)
+					flush();
+				if (storedWords > MaxStoredWords)
+					evict();
+				continue;
+			}
+		}
+		//处理过程中文档本身被移出，剩下的行只统计单词数
+		if (wasEvicted)
+		{
+			QVector<int> counts = countWords(lines, batch, lines.size());
+			QWriteLocker locker(&lock);
+			updateEvicted(job.document, first + batch, counts.size(), counts);
+		}
+		break;
+	}
+	QWriteLocker locker(&lock);
+	flush();
+}
+
+void WordIndex::splitWords(const QStringRef &line, QVector<QStringRef> *words)
+{
+	words->clear();
+	int length = line.size();
+	for (int pos = 0; pos < length; )
+	{
+		if (!isWordChar(line.at(pos)))
+		{
+			++pos;
+			continue;
+		}
+		int start = pos;
+		while (pos < length && isWordChar(line.at(pos)))
+			++pos;
+		//以数字开头的不算单词
+		if (line.at(start).isDigit() || pos - start < MinWordLength || pos - start > MaxWordLength)
+			continue;
+		words->append(line.mid(start, pos - start));
+	}
+}
+
+QVector<int> WordIndex::countWords(const QVector<QStringRef> &lines, int from, int to)
+{
+	QVector<int> counts;
+	counts.reserve(to - from);
+	QVector<QStringRef> words;
+	for (int i = from; i < to; ++i)
+	{
+		splitWords(lines.at(i), &words);
+		counts.append(words.size());
+	}
+	return counts;
+}
+
+void WordIndex::updateEvicted(const void *document, int first, int removed, const QVector<int> &counts)
+{
+	Evicted &state = evicted[document];
+	first = qBound(0, first, state.lineWords.size());
+	removed = qBound(0, removed, state.lineWords.size() - first);
+	for (int i = first; i < first + removed; ++i)
+	{
+		state.words -= state.lineWords.at(i);
+	}
+	state.lineWords.remove(first, removed);
+	state.lineWords.insert(first, counts.size(), 0);
+	for (int i = 0; i < counts.size(); ++i)
+	{
+		state.lineWords[first + i] = counts.at(i);
+		state.words += counts.at(i);
+	}
+
+	//留出一半的余量，避免同一个文档反复移出和收录
+	if (!state.requested && storedWords + state.words <= MaxStoredWords / 2)
+	{
+		state.requested = true;
+		{
+			QMutexLocker locker(&queueMutex);
+			readmitQueue.append(document);
+		}
+		QMetaObject::invokeMethod(this, "readmitDocuments", Qt::QueuedConnection);
+	}
+}
+
+void WordIndex::releaseLines(Document &document, int first, int count)
+{
+	for (int i = first; i < first + count; ++i)
+	{
+		const QVector<int> &words = document.lines.at(i);
+		for (int id : words)
+		{
+			if (--entries[id].count == 0)
+				dead.append(id);
+		}
+		document.stored -= words.size();
+		storedWords -= words.size();
+	}
+}
+
+int WordIndex::intern(const QString &word)
+{
+	QHash<QString, int>::const_iterator it = ids.constFind(word);
+	if (it != ids.constEnd())
+	{
+		++entries[it.value()].count;
+		return it.value();
+	}
+
+	//单词数达到上限后不再收录新词
+	int id;
+	if (!freeEntries.isEmpty())
+	{
+		id = freeEntries.takeLast();
+	}
+	else if (entries.size() < MaxWords)
+	{
+		id = entries.size();
+		entries.append(Entry());
+	}
+	else
+	{
+		return -1;
+	}
+	Entry &entry = entries[id];
+	entry.text = word;
+	entry.key = word.toLower();
+	entry.count = 1;
+	ids.insert(word, id);
+	fresh.append(id);
+	return id;
+}
+
+bool WordIndex::keyLess(int a, int b) const
+{
+	const Entry &x = entries.at(a);
+	const Entry &y = entries.at(b);
+	return x.key < y.key || (x.key == y.key && x.text < y.text);
+}
+
+void WordIndex::flush()
+{
+	//先清除次数降为0的单词，再把新单词排序后与有序表归并
+	bool removed = false;
+	for (int id : dead)
+	{
+		Entry &entry = entries[id];
+		if (entry.count != 0)
+			continue;
+		ids.remove(entry.text);
+		entry = Entry();
+		freeEntries.append(id);
+		removed = true;
+	}
+	dead.clear();
+	if (removed)
+	{
+		sorted.erase(std::remove_if(sorted.begin(), sorted.end(), [this](int id)
+		{
+			return entries.at(id).count < 0;
+		}), sorted.end());
+	}
+
+	fresh.erase(std::remove_if(fresh.begin(), fresh.end(), [this](int id)
+	{
+		return entries.at(id).count < 0;
+	}), fresh.end());
+	if (fresh.isEmpty())
+	{
+		return;
+	}
+	auto less = [this](int a, int b) { return keyLess(a, b); };
+	std::sort(fresh.begin(), fresh.end(), less);
+	int middle = sorted.size();
+	sorted += fresh;
+	std::inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end(), less);
+	fresh.clear();
+}
+
+void WordIndex::evict()
+{
+	while (storedWords > MaxStoredWords && !documents.isEmpty())
+	{
+		QHash<const void *, Document>::iterator largest = documents.begin();
+		for (QHash<const void *, Document>::iterator it = documents.begin(); it != documents.end(); ++it)
+		{
+			if (it.value().stored > largest.value().stored)
+				largest = it;
+		}
+		Evicted &state = evicted[largest.key()];
+		state = Evicted();
+		state.lineWords.reserve(largest.value().lines.size());
+		for (const QVector<int> &words : largest.value().lines)
+			state.lineWords.append(words.size());
+		state.words = largest.value().stored;
+		releaseLines(largest.value(), 0, largest.value().lines.size());
+		documents.erase(largest);
+	}
+	flush();
+}
+
+QStringList WordIndex::complete(const QString &prefix, int limit, bool fuzzy) const
+{
+	QStringList result;
+	if (prefix.isEmpty() || limit <= 0)
+	{
+		return result;
+	}
+	QString key = prefix.toLower();
+	QReadLocker locker(&lock);
+	auto byCount = [this](int a, int b)
+	{
+		return entries.at(a).count > entries.at(b).count;
+	};
+	auto keyBelow = [this](int id, const QString &value)
+	{
+		return entries.at(id).key < value;
+	};
+
+	//前缀相同的单词在有序表中是连续的一段
+	QVector<int> matches;
+	QVector<int>::const_iterator it = std::lower_bound(sorted.begin(), sorted.end(), key, keyBelow);
+	for (; it != sorted.end() && entries.at(*it).key.startsWith(key); ++it)
+	{
+		//次数降为0的单词要等到下次归并时才从有序表中清除
+		if (entries.at(*it).count > 0 && entries.at(*it).text != prefix)
+			matches.append(*it);
+	}
+	int taken = qMin(limit, matches.size());
+	std::partial_sort(matches.begin(), matches.begin() + taken, matches.end(), byCount);
+	matches.resize(taken);
+
+	if (fuzzy && taken < limit && key.size() > 1)
+	{
+		QVector<int> others;
+		it = std::lower_bound(sorted.begin(), sorted.end(), key.left(1), keyBelow);
+		for (; it != sorted.end() && entries.at(*it).key.at(0) == key.at(0); ++it)
+		{
+			const QString &candidate = entries.at(*it).key;
+			if (entries.at(*it).count <= 0 || candidate.startsWith(key))
+				continue;
+			int matched = 1;
+			for (int i = 1; i < candidate.size() && matched < key.size(); ++i)
+			{
+				if (candidate.at(i) == key.at(matched))
+					++matched;
+			}
+			if (matched == key.size())
+				others.append(*it);
+		}
+		int more = qMin(limit - taken, others.size());
+		std::partial_sort(others.begin(), others.begin() + more, others.end(), byCount);
+		matches += others.mid(0, more);
+	}
+
+	for (int id : matches)
+		result.append(entries.at(id).text);
+	return result;
+}
+
+int WordIndex::wordCount() const
+{
+	QReadLocker locker(&lock);
+	return ids.size();
+}
+
+qint64 WordIndex::memoryUsage() const
+{
+	QReadLocker locker(&lock);
+	qint64 bytes = entries.capacity() * qint64(sizeof(Entry)) + sorted.capacity() * qint64(sizeof(int));
+	//每个单词的原文和小写形式，以及散列表中的一份拷贝（隐式共享）
+	for (const Entry &entry : entries)
+		bytes += entry.count < 0 ? 0 : 2 * (entry.text.size() * 2 + 24) + 16;
+	for (const Document &document : documents)
+		bytes += document.lines.capacity() * qint64(sizeof(QVector<int>));
+	bytes += storedWords * qint64(sizeof(int));
+	return bytes;
+}
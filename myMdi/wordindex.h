@@ -0,0 +1,118 @@
+﻿#ifndef WORDINDEX_H
+#define WORDINDEX_H
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QFuture>
+
+class QTextDocument;
+
+//单词补全索引：由所有打开的文档共享。
+//各个单词只保存一份，按小写形式排好序，并记录在所有文档中出现的次数，
+//前缀查询用二分查找定位，模糊查询只扫描首字母相同的一段。
+//文档的修改在界面线程中只取出改动的几行文本，切分单词和更新计数都在工作线程中进行。
+//每个文档按行记录单词编号，以便删除行时扣除计数；总量超出上限时移出最大的文档，
+//移出的文档只按行记录单词数，缩小到上限的一半以下时重新收录
+class WordIndex : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit WordIndex(QObject *parent = nullptr);
+	~WordIndex();
+
+	enum
+	{
+		MinWordLength = 3,                      //更短的单词不值得补全
+		MaxWordLength = 64,
+		MaxWords = 500000,                      //不同单词的数量上限
+		MaxStoredWords = 16 * 1024 * 1024,      //各文档按行记录的单词总数上限
+		FlushThreshold = 64 * 1024              //未归并的新单词和待清除的单词超过这个数时提前归并
+	};
+
+	void addDocument(QTextDocument *document);  //开始索引一个文档，文档销毁时自动移出
+	void removeDocument(QTextDocument *document);
+
+	//以prefix开头（不区分大小写）的单词，按出现次数从多到少排列；
+	//fuzzy为真且数量不足时，再补充首字母相同、按顺序包含prefix各个字符的单词
+	QStringList complete(const QString &prefix, int limit, bool fuzzy = true) const;
+	int wordCount() const;                      //不同单词的数量
+	qint64 memoryUsage() const;                 //估计占用的内存
+
+	static bool isWordChar(QChar c) { return c.isLetterOrNumber() || c == QLatin1Char('_'); }
+
+private slots:
+	void documentChanged(int position, int charsRemoved, int charsAdded);
+	void documentDestroyed(QObject *document);
+	void readmitDocuments();                    //重新收录已经缩小的文档
+
+private:
+	//一次修改：从第firstLine行起的removedLines行被替换为text中的各行
+	struct Job
+	{
+		Job() : document(nullptr), firstLine(0), removedLines(0), remove(false), reload(false) {}
+		const void * document;
+		int firstLine;
+		int removedLines;
+		QString text;
+		bool remove;                            //文档已关闭，移出索引
+		bool reload;                            //重新收录被移出的文档，text为全文
+	};
+	struct Entry
+	{
+		Entry() : count(-1) {}
+		QString text;
+		QString key;                            //小写形式，用于排序和查找
+		int count;                              //出现次数，-1表示空闲的编号
+	};
+	struct Document
+	{
+		Document() : stored(0) {}
+		QVector<QVector<int> > lines;           //每行的单词编号
+		qint64 stored;                          //按行记录的单词数
+	};
+	//被移出的文档：不再记录单词，只记录每行的单词数，用于判断何时可以重新收录
+	struct Evicted
+	{
+		Evicted() : words(0), requested(false) {}
+		QVector<int> lineWords;
+		qint64 words;
+		bool requested;                         //已经请求界面线程重新收录
+	};
+
+	void enqueue(const Job &job);
+	void processQueue();                        //在工作线程中依次处理修改
+	void apply(const Job &job);
+	void releaseLines(Document &document, int first, int count);
+	int intern(const QString &word);
+	void updateEvicted(const void *document, int first, int removed, const QVector<int> &counts);
+	static void splitWords(const QStringRef &line, QVector<QStringRef> *words);
+	static QVector<int> countWords(const QVector<QStringRef> &lines, int from, int to);
+	void flush();                               //把新单词并入有序表，清除不再出现的单词
+	void evict();                               //超出上限时移出记录单词最多的文档
+	bool keyLess(int a, int b) const;
+
+	mutable QReadWriteLock lock;                //保护以下单词和文档数据
+	QVector<Entry> entries;
+	QVector<int> freeEntries;
+	QHash<QString, int> ids;
+	QVector<int> sorted;                        //按小写形式排序的单词编号
+	QVector<int> fresh;                         //还未并入有序表的新单词
+	QVector<int> dead;                          //次数降为0、可能需要清除的单词
+	QHash<const void *, Document> documents;
+	QHash<const void *, Evicted> evicted;       //因超出上限而移出的文档
+	qint64 storedWords;
+
+	QMutex queueMutex;                          //保护修改队列
+	QList<Job> queue;
+	QList<const void *> readmitQueue;           //等待界面线程取出全文重新收录的文档
+	bool running;
+	QFuture<void> worker;
+
+	QHash<QTextDocument *, int> blockCounts;    //界面线程记录的各文档行数，用于算出被替换的行数
+};
+
+#endif // WORDINDEX_H
@@ -0,0 +1,24 @@
+# 编辑器的QtTest基准测试，与主程序共用myMdi.pri中的源文件，只是不含main.cpp。
+# 运行：tst_editorbenchmark -platform offscreen -o -,csv
+# 语料大小由环境变量MYMDI_BENCHMARK_SIZE指定，默认为1M
+
+TEMPLATE = app
+TARGET = tst_editorbenchmark
+QT += core gui widgets concurrent network testlib
+CONFIG += console testcase
+CONFIG -= app_bundle
+DEFINES += _UNICODE QT_WIDGETS_LIB QT_CONCURRENT_LIB QT_NETWORK_LIB
+
+MYMDI = $$PWD/../../myMdi
+include($$MYMDI/myMdi.pri)
+
+# myMdi.pri中的路径相对于myMdi.pro，这里改为相对于主程序目录
+HEADERS = $$replace(HEADERS, ^\\./, $$MYMDI/)
+SOURCES = $$replace(SOURCES, ^\\./, $$MYMDI/)
+SOURCES -= $$MYMDI/main.cpp
+FORMS = $$replace(FORMS, ^\\./, $$MYMDI/)
+RESOURCES = $$MYMDI/mymdi.qrc
+INCLUDEPATH += $$MYMDI
+win32: LIBS += -lshell32
+
+SOURCES += tst_editorbenchmark.cpp
@@ -0,0 +1,211 @@
+﻿#include <QtTest>
+#include <QApplication>
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include "benchmark.h"
+#include "mdichild.h"
+
+//编辑器的QtTest基准测试，语料与 --benchmark 生成的相同，每种字符集和行长各一行数据。
+//QBENCHMARK的结果按QtTest的格式输出，例如 -o -,csv 或 -o result.xml,xml；
+//Qt 5.12的QtTest还没有JSON格式，需要JSON时仍用主程序的 --benchmark
+class EditorBenchmark : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void load_data() { corpusData(); }
+	void load();
+	void save_data() { corpusData(); }
+	void save();
+	void scroll_data() { corpusData(); }
+	void scroll();
+	void type_data() { corpusData(); }
+	void type();
+	void paste_data() { corpusData(); }
+	void paste();
+	void search_data() { corpusData(); }
+	void search();
+	void count_data() { corpusData(); }
+	void count();
+
+private:
+	void corpusData();                          //每份语料一行数据
+	MdiChild * openCorpus(const QString &fileName);
+	static void moveToMiddle(MdiChild *child);
+
+	QTemporaryDir dir;
+	QStringList names;
+	QStringList files;
+	QList<int> charsets;
+};
+
+void EditorBenchmark::initTestCase()
+{
+	QVERIFY(dir.isValid());
+	QByteArray size = qgetenv("MYMDI_BENCHMARK_SIZE");
+	qint64 bytes = Benchmark::parseSize(size.isEmpty() ? QString("1M") : QString::fromLatin1(size));
+	QVERIFY(bytes > 0);
+	for (int charset = Benchmark::Ascii; charset <= Benchmark::Cjk; ++charset)
+	{
+		for (int longLines = 0; longLines < 2; ++longLines)
+		{
+			QString name = QString("%1-%2-%3").arg(bytes).arg(charset == Benchmark::Ascii ? "ascii" : charset == Benchmark::Utf8 ? "utf8" : "cjk")
+				.arg(longLines ? "long" : "short");
+			QString fileName = QDir(dir.path()).filePath(name + ".txt");
+			QVERIFY(Benchmark::generate(fileName, bytes, longLines, Benchmark::Charset(charset)));
+			names.append(name);
+			files.append(fileName);
+			charsets.append(charset);
+		}
+	}
+}
+
+void EditorBenchmark::corpusData()
+{
+	QTest::addColumn<QString>("fileName");
+	QTest::addColumn<int>("charset");
+	for (int i = 0; i < files.size(); ++i)
+	{
+		QTest::newRow(names.at(i).toLatin1().constData()) << files.at(i) << charsets.at(i);
+	}
+}
+
+MdiChild * EditorBenchmark::openCorpus(const QString &fileName)
+{
+	MdiChild * child = new MdiChild;
+	child->resize(1000, 600);
+	child->show();
+	if (!child->loadFile(fileName))
+	{
+		delete child;
+		return nullptr;
+	}
+	QApplication::processEvents();
+	return child;
+}
+
+void EditorBenchmark::moveToMiddle(MdiChild *child)
+{
+	QTextCursor cursor = child->textCursor();
+	cursor.setPosition(child->document()->characterCount() / 2);
+	child->setTextCursor(cursor);
+}
+
+void EditorBenchmark::load()
+{
+	QFETCH(QString, fileName);
+	QBENCHMARK
+	{
+		MdiChild child;
+		QVERIFY(child.loadFile(fileName));
+		//直接销毁，不经过关闭时的保存提示
+		child.document()->setModified(false);
+	}
+}
+
+void EditorBenchmark::save()
+{
+	QFETCH(QString, fileName);
+	QScopedPointer<MdiChild> child(openCorpus(fileName));
+	QVERIFY(child);
+	QString saved = QDir(dir.path()).filePath("saved.txt");
+	QBENCHMARK
+	{
+		QVERIFY(child->saveFile(saved));
+	}
+	QFile::remove(saved);
+}
+
+void EditorBenchmark::scroll()
+{
+	//逐页滚动并立即重绘
+	QFETCH(QString, fileName);
+	QScopedPointer<MdiChild> child(openCorpus(fileName));
+	QVERIFY(child);
+	QScrollBar * bar = child->verticalScrollBar();
+	QBENCHMARK
+	{
+		bar->setValue(0);
+		for (int i = 0; i < 50; ++i)
+		{
+			bar->setValue(bar->value() + bar->pageStep());
+			child->viewport()->repaint();
+		}
+	}
+}
+
+void EditorBenchmark::type()
+{
+	//在文档中间连续输入，每个字符都重绘，之后撤销
+	QFETCH(QString, fileName);
+	QScopedPointer<MdiChild> child(openCorpus(fileName));
+	QVERIFY(child);
+	QBENCHMARK
+	{
+		moveToMiddle(child.data());
+		for (int i = 0; i < 200; ++i)
+		{
+			QChar c = QChar('a' + i % 26);
+			QKeyEvent press(QEvent::KeyPress, Qt::Key_A + i % 26, Qt::NoModifier, QString(c));
+			QApplication::sendEvent(child.data(), &press);
+			child->viewport()->repaint();
+		}
+		child->undo();
+	}
+	child->document()->setModified(false);
+}
+
+void EditorBenchmark::paste()
+{
+	//粘贴1MB文本再撤销，不超过分块粘贴的大小，整个过程是同步的
+	QFETCH(QString, fileName);
+	QScopedPointer<MdiChild> child(openCorpus(fileName));
+	QVERIFY(child);
+	QString clip;
+	clip.reserve(1024 * 1024);
+	while (clip.size() < 1024 * 1024)
+		clip += QString::fromUtf8(u8"pasted text 粘贴的文本\n");
+	QApplication::clipboard()->setText(clip);
+	QBENCHMARK
+	{
+		moveToMiddle(child.data());
+		child->paste();
+		child->undo();
+	}
+	child->document()->setModified(false);
+}
+
+void EditorBenchmark::search()
+{
+	//从头查找末尾的标记
+	QFETCH(QString, fileName);
+	QScopedPointer<MdiChild> child(openCorpus(fileName));
+	QVERIFY(child);
+	SearchEngine::Options options;
+	QBENCHMARK
+	{
+		child->moveCursor(QTextCursor::Start);
+		QVERIFY(child->findNext("NEEDLE", options));
+	}
+}
+
+void EditorBenchmark::count()
+{
+	//统计常见单词
+	QFETCH(QString, fileName);
+	QFETCH(int, charset);
+	QScopedPointer<MdiChild> child(openCorpus(fileName));
+	QVERIFY(child);
+	QString pattern = charset == Benchmark::Cjk ? QString::fromUtf8(u8"文档") : QString("the");
+	SearchEngine::Options options;
+	QBENCHMARK
+	{
+		QVERIFY(child->countMatches(pattern, options) >= 0);
+	}
+}
+
+QTEST_MAIN(EditorBenchmark)
+#include "tst_editorbenchmark.moc"
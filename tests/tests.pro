@@ -0,0 +1,3 @@
+# 测试子项目：在这个目录运行 qmake && make check
+TEMPLATE = subdirs
+SUBDIRS = benchmark